@@ -0,0 +1,446 @@
+/*
+ * UNIJACK - Batch engine
+ * Implementation
+ */
+
+#include "batch.h"
+#include "instrument.h"
+
+// ============================================================================
+// VECTOR KERNELS
+// ============================================================================
+// Lanes are 32-bit integers; true is -1 and false is 0 in every mask.
+// Kernels are written once against these helpers and compiled for AVX2,
+// SSE2 or plain C depending on what the compiler targets.
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+#define BATCH_VECTOR_WIDTH 8
+typedef __m256i BatchVec;
+
+static inline BatchVec vec_load(const int32_t* p) { return _mm256_load_si256((const __m256i*)p); }
+static inline void vec_store(int32_t* p, BatchVec v) { _mm256_store_si256((__m256i*)p, v); }
+static inline BatchVec vec_set1(int32_t x) { return _mm256_set1_epi32(x); }
+static inline BatchVec vec_add(BatchVec a, BatchVec b) { return _mm256_add_epi32(a, b); }
+static inline BatchVec vec_sub(BatchVec a, BatchVec b) { return _mm256_sub_epi32(a, b); }
+static inline BatchVec vec_and(BatchVec a, BatchVec b) { return _mm256_and_si256(a, b); }
+static inline BatchVec vec_or(BatchVec a, BatchVec b) { return _mm256_or_si256(a, b); }
+static inline BatchVec vec_andnot(BatchVec a, BatchVec b) { return _mm256_andnot_si256(a, b); }
+static inline BatchVec vec_cmpeq(BatchVec a, BatchVec b) { return _mm256_cmpeq_epi32(a, b); }
+static inline BatchVec vec_cmpgt(BatchVec a, BatchVec b) { return _mm256_cmpgt_epi32(a, b); }
+static inline int vec_mask_bits(BatchVec m) { return _mm256_movemask_ps(_mm256_castsi256_ps(m)); }
+
+static const char* KERNEL_NAME = "avx2";
+
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+
+#define BATCH_VECTOR_WIDTH 4
+typedef __m128i BatchVec;
+
+static inline BatchVec vec_load(const int32_t* p) { return _mm_load_si128((const __m128i*)p); }
+static inline void vec_store(int32_t* p, BatchVec v) { _mm_store_si128((__m128i*)p, v); }
+static inline BatchVec vec_set1(int32_t x) { return _mm_set1_epi32(x); }
+static inline BatchVec vec_add(BatchVec a, BatchVec b) { return _mm_add_epi32(a, b); }
+static inline BatchVec vec_sub(BatchVec a, BatchVec b) { return _mm_sub_epi32(a, b); }
+static inline BatchVec vec_and(BatchVec a, BatchVec b) { return _mm_and_si128(a, b); }
+static inline BatchVec vec_or(BatchVec a, BatchVec b) { return _mm_or_si128(a, b); }
+static inline BatchVec vec_andnot(BatchVec a, BatchVec b) { return _mm_andnot_si128(a, b); }
+static inline BatchVec vec_cmpeq(BatchVec a, BatchVec b) { return _mm_cmpeq_epi32(a, b); }
+static inline BatchVec vec_cmpgt(BatchVec a, BatchVec b) { return _mm_cmpgt_epi32(a, b); }
+static inline int vec_mask_bits(BatchVec m) { return _mm_movemask_ps(_mm_castsi128_ps(m)); }
+
+static const char* KERNEL_NAME = "sse2";
+
+#else
+
+#define BATCH_VECTOR_WIDTH 1
+typedef int32_t BatchVec;
+
+static inline BatchVec vec_load(const int32_t* p) { return *p; }
+static inline void vec_store(int32_t* p, BatchVec v) { *p = v; }
+static inline BatchVec vec_set1(int32_t x) { return x; }
+static inline BatchVec vec_add(BatchVec a, BatchVec b) { return a + b; }
+static inline BatchVec vec_sub(BatchVec a, BatchVec b) { return a - b; }
+static inline BatchVec vec_and(BatchVec a, BatchVec b) { return a & b; }
+static inline BatchVec vec_or(BatchVec a, BatchVec b) { return a | b; }
+static inline BatchVec vec_andnot(BatchVec a, BatchVec b) { return ~a & b; }
+static inline BatchVec vec_cmpeq(BatchVec a, BatchVec b) { return -(a == b); }
+static inline BatchVec vec_cmpgt(BatchVec a, BatchVec b) { return -(a > b); }
+static inline int vec_mask_bits(BatchVec m) { return m & 1; }
+
+static const char* KERNEL_NAME = "scalar";
+
+#endif
+
+const char* batch_kernel_name(void) {
+    return KERNEL_NAME;
+}
+
+static inline BatchVec vec_score(BatchVec hard, BatchVec ace) {
+    // Same rule as score_from_hand: one ace counts 11 if that does not bust
+    BatchVec soft = vec_andnot(vec_cmpgt(hard, vec_set1(TARGET_SCORE - SOFT_ACE_BONUS)), ace);
+    return vec_add(hard, vec_and(soft, vec_set1(SOFT_ACE_BONUS)));
+}
+
+static inline BatchVec vec_blackjack(BatchVec hard, BatchVec ace, BatchVec count) {
+    BatchVec two_cards = vec_cmpeq(count, vec_set1(2));
+    BatchVec eleven = vec_cmpeq(hard, vec_set1(TARGET_SCORE - SOFT_ACE_BONUS));
+    return vec_and(vec_and(two_cards, eleven), ace);
+}
+
+static inline BatchVec vec_hits(BatchVec running, BatchVec hard, BatchVec ace, int hit_below) {
+    // Hit while not bust and scoring below the threshold
+    BatchVec bust = vec_cmpgt(hard, vec_set1(TARGET_SCORE));
+    BatchVec below = vec_cmpgt(vec_set1(hit_below), vec_score(hard, ace));
+    return vec_andnot(bust, vec_and(running, below));
+}
+
+static void tally_outcomes(BatchEngine* engine, int seat) {
+    // Vector form of compare_hands, with the player as hand1:
+    //   bust      player busted, whatever the dealer has
+    //   blackjack player blackjack, dealer none
+    //   push      both blackjacks, or equal scores with no bust or blackjack
+    //   win       dealer busted or scored less, no blackjack on either side
+    //   loose     anything else
+    const int32_t* hard = &engine->hard_totals[seat * engine->lane_stride];
+    const int32_t* aces = &engine->ace_masks[seat * engine->lane_stride];
+    const int32_t* counts = &engine->card_counts[seat * engine->lane_stride];
+    int32_t* tallies = engine->tallies;
+    int stride = engine->lane_stride;
+    BatchVec wager = vec_set1(engine->wager);
+    BatchVec bonus = vec_set1(engine->blackjack_bonus);
+    
+    for (int i = 0; i < stride; i += BATCH_VECTOR_WIDTH) {
+        BatchVec running = vec_load(&engine->running_masks[i]);
+        BatchVec p_hard = vec_load(&hard[i]);
+        BatchVec p_ace = vec_load(&aces[i]);
+        BatchVec d_hard = vec_load(&engine->dealer_hard_totals[i]);
+        BatchVec d_ace = vec_load(&engine->dealer_ace_masks[i]);
+        
+        BatchVec p_score = vec_score(p_hard, p_ace);
+        BatchVec d_score = vec_score(d_hard, d_ace);
+        BatchVec p_bust = vec_cmpgt(p_hard, vec_set1(TARGET_SCORE));
+        BatchVec d_bust = vec_cmpgt(d_hard, vec_set1(TARGET_SCORE));
+        BatchVec p_blackjack = vec_blackjack(p_hard, p_ace, vec_load(&counts[i]));
+        BatchVec d_blackjack = vec_blackjack(d_hard, d_ace, vec_load(&engine->dealer_card_counts[i]));
+        
+        BatchVec no_blackjack = vec_andnot(vec_or(p_blackjack, d_blackjack), running);
+        BatchVec standing = vec_andnot(p_bust, no_blackjack);
+        BatchVec scores_equal = vec_andnot(d_bust, vec_cmpeq(p_score, d_score));
+        BatchVec player_higher = vec_or(d_bust, vec_cmpgt(p_score, d_score));
+        
+        BatchVec bust = vec_and(p_bust, running);
+        BatchVec blackjack = vec_and(vec_andnot(d_blackjack, p_blackjack), running);
+        BatchVec push = vec_or(vec_and(vec_and(p_blackjack, d_blackjack), running),
+                               vec_and(standing, scores_equal));
+        BatchVec win = vec_and(standing, player_higher);
+        BatchVec loose = vec_andnot(vec_or(vec_or(bust, blackjack), vec_or(push, win)), running);
+        
+        // Masks are -1, so subtracting them counts
+        vec_store(&tallies[BUST * stride + i], vec_sub(vec_load(&tallies[BUST * stride + i]), bust));
+        vec_store(&tallies[LOOSE * stride + i], vec_sub(vec_load(&tallies[LOOSE * stride + i]), loose));
+        vec_store(&tallies[PUSH * stride + i], vec_sub(vec_load(&tallies[PUSH * stride + i]), push));
+        vec_store(&tallies[WIN * stride + i], vec_sub(vec_load(&tallies[WIN * stride + i]), win));
+        vec_store(&tallies[BLACKJACK * stride + i],
+                  vec_sub(vec_load(&tallies[BLACKJACK * stride + i]), blackjack));
+        
+        // Every hand wagers the minimum, so its net follows from its outcome
+        BatchVec gains = vec_add(vec_and(win, wager), vec_and(blackjack, bonus));
+        BatchVec net = vec_sub(gains, vec_and(vec_or(bust, loose), wager));
+        vec_store(&engine->round_nets[i], vec_add(vec_load(&engine->round_nets[i]), net));
+    }
+}
+
+// ============================================================================
+// LANE OPERATIONS
+// ============================================================================
+static void flush_lane_tallies(BatchEngine* engine, int lane) {
+    int32_t* tallies = engine->tallies;
+    int stride = engine->lane_stride;
+    GameStats* stats = &engine->lane_stats[lane];
+    
+    long long bust = tallies[BUST * stride + lane];
+    long long loose = tallies[LOOSE * stride + lane];
+    long long push = tallies[PUSH * stride + lane];
+    long long win = tallies[WIN * stride + lane];
+    long long blackjack = tallies[BLACKJACK * stride + lane];
+    long long hands = bust + loose + push + win + blackjack;
+    
+    // Every hand wagers the minimum, so payouts follow from the tallies
+    stats->round_count += tallies[BATCH_ROUND_TALLY * stride + lane];
+    stats->hand_count += hands;
+    stats->bust_count += bust;
+    stats->loose_count += loose;
+    stats->push_count += push;
+    stats->win_count += win;
+    stats->blackjack_count += blackjack;
+    stats->total_wagered += hands * engine->wager;
+    stats->total_paid += push * engine->wager + win * 2LL * engine->wager +
+                         blackjack * (long long)(engine->wager + engine->blackjack_bonus);
+    
+    // The nets are exact integer sums, so the block of rounds since the
+    // last flush merges in without the per-round updates
+    RoundMoments block;
+    init_round_moments(&block);
+    block.round_count = tallies[BATCH_ROUND_TALLY * stride + lane];
+    if (block.round_count > 0) {
+        double n = (double)block.round_count;
+        double sum = (double)engine->net_sums[lane];
+        block.net_mean = sum / n;
+        block.wagered_mean = (double)hands * engine->wager / n;
+        block.net_m2 = (double)engine->net_sums[engine->lane_count + lane] - sum * block.net_mean;
+        merge_round_moments(&engine->lane_moments[lane], &block);
+    }
+    engine->net_sums[lane] = 0;
+    engine->net_sums[engine->lane_count + lane] = 0;
+    
+    for (int row = 0; row < BATCH_TALLY_COUNT; row++) {
+        tallies[row * stride + lane] = 0;
+    }
+}
+
+static inline Card draw_lane_shoe_card(Shoe* shoe) {
+    // draw_card for a regular shoe, inlined; an empty shoe or one keeping
+    // running counts takes the full path. Lanes only read the rank, so
+    // hole cards need no visibility bit.
+    if (shoe->current_index >= shoe->total_cards || shoe->counting_system_count > 0) {
+        return draw_card(shoe, 0);
+    }
+    INSTR_EVENT(INSTR_EVENT_DRAW);
+    Card card = shoe->cards[shoe->current_index++];
+    shoe->round_dealt_count++;
+    if (shoe->current_index >= shoe->cut_card_index) {
+        shoe->cut_card_reached = 1;
+    }
+    shoe->remaining_counts[CARD_RANK(card)]--;
+    return card;
+}
+
+static inline Card draw_lane_machine_card(Shoe* shoe) {
+    // draw_from_machine inlined the same way, for a machine with cards left
+    if (shoe->machine_count == 0 || shoe->counting_system_count > 0) {
+        return draw_card(shoe, 0);
+    }
+    INSTR_EVENT(INSTR_EVENT_DRAW);
+    
+    // Both positions stay below twice the ring size, so a subtraction
+    // replaces the modulo
+    int total = shoe->total_cards;
+    int last = shoe->machine_start + shoe->machine_count - 1;
+    int pick = (int)rng_bounded(&shoe->rng, (uint32_t)shoe->machine_count);
+    pick = shoe->machine_start + (shoe->antithetic ? shoe->machine_count - 1 - pick : pick);
+    last -= last >= total ? total : 0;
+    pick -= pick >= total ? total : 0;
+    Card card = shoe->cards[pick];
+    shoe->cards[pick] = shoe->cards[last];
+    shoe->cards[last] = card;
+    
+    shoe->machine_count--;
+    shoe->current_index++;
+    shoe->round_dealt_count++;
+    shoe->remaining_counts[CARD_RANK(card)]--;
+    return card;
+}
+
+static void clear_batch_hands(BatchEngine* engine) {
+    // Hands are cleared on every lane, dealing only touches running ones
+    size_t player_bytes = (size_t)engine->seat_count * engine->lane_stride * sizeof(int32_t);
+    size_t dealer_bytes = (size_t)engine->lane_stride * sizeof(int32_t);
+    memset(engine->hard_totals, 0, player_bytes);
+    memset(engine->ace_masks, 0, player_bytes);
+    memset(engine->card_counts, 0, player_bytes);
+    memset(engine->dealer_hard_totals, 0, dealer_bytes);
+    memset(engine->dealer_ace_masks, 0, dealer_bytes);
+    memset(engine->dealer_card_counts, 0, dealer_bytes);
+}
+
+static int finish_batch_round(BatchEngine* engine) {
+    int32_t* rounds = &engine->tallies[BATCH_ROUND_TALLY * engine->lane_stride];
+    for (int i = 0; i < engine->lane_stride; i += BATCH_VECTOR_WIDTH) {
+        vec_store(&rounds[i], vec_sub(vec_load(&rounds[i]), vec_load(&engine->running_masks[i])));
+    }
+    
+    int finished = 0;
+    for (int lane = 0; lane < engine->lane_count; lane++) {
+        if (!engine->running_masks[lane]) {
+            continue;
+        }
+        collect_discards(&engine->shoes[lane]);
+        long long net = engine->round_nets[lane];
+        engine->net_sums[lane] += net;
+        engine->net_sums[engine->lane_count + lane] += net * net;
+        engine->lane_moments[lane].histogram[get_net_histogram_bin(net, engine->wager)]++;
+        engine->round_nets[lane] = 0;
+        if (--engine->rounds_left[lane] == 0) {
+            engine->running_masks[lane] = 0;
+            engine->lane_states[lane] = BATCH_LANE_DONE;
+            finished++;
+        }
+    }
+    
+    if (++engine->rounds_since_flush >= BATCH_FLUSH_ROUNDS) {
+        for (int lane = 0; lane < engine->lane_count; lane++) {
+            flush_lane_tallies(engine, lane);
+        }
+        engine->rounds_since_flush = 0;
+    }
+    return finished;
+}
+
+// ============================================================================
+// RULESET KERNELS
+// ============================================================================
+// batch_kernel.h generates the round once per ruleset shape below, with
+// that shape's rules folded in. Any other ruleset plays the generic round,
+// which reads the same rules from engine->ruleset.
+
+// Regular shoe, no hole card (basic, european)
+#define KERNEL_SUFFIX shoe
+#define KERNEL_AUTO_SHUFFLING 0
+#define KERNEL_HOLE_CARD 0
+#define KERNEL_PEEK 0
+#include "batch_kernel.h"
+
+// Shuffling machine, hole card with peek (american)
+#define KERNEL_SUFFIX machine_peek
+#define KERNEL_AUTO_SHUFFLING 1
+#define KERNEL_HOLE_CARD 1
+#define KERNEL_PEEK 1
+#include "batch_kernel.h"
+
+#define KERNEL_SUFFIX generic
+#define KERNEL_AUTO_SHUFFLING (engine->ruleset.auto_shuffling_shoe)
+#define KERNEL_HOLE_CARD (engine->ruleset.dealer_receives_hole_card)
+#define KERNEL_PEEK (engine->ruleset.dealer_receives_hole_card && \
+                     engine->ruleset.dealer_reveals_blackjack_hand)
+#include "batch_kernel.h"
+
+// Batch variant structure - a generated round and the rules it was built for
+typedef struct {
+    const char* name;
+    int auto_shuffling;
+    int hole_card;
+    int peek;
+    int (*play_round)(BatchEngine* engine);
+} BatchVariant;
+
+// The generic round comes last and plays whatever the others do not
+static const BatchVariant BATCH_VARIANTS[] = {
+    {"shoe", 0, 0, 0, play_batch_round_shoe},
+    {"machine_peek", 1, 1, 1, play_batch_round_machine_peek},
+    {"generic", 0, 0, 0, play_batch_round_generic},
+};
+#define BATCH_VARIANT_COUNT ((int)(sizeof(BATCH_VARIANTS) / sizeof(BATCH_VARIANTS[0])))
+
+static int find_batch_variant(const Ruleset* ruleset) {
+    int auto_shuffling = ruleset->auto_shuffling_shoe != 0;
+    int hole_card = ruleset->dealer_receives_hole_card != 0;
+    int peek = hole_card && ruleset->dealer_reveals_blackjack_hand;
+    for (int i = 0; i < BATCH_VARIANT_COUNT - 1; i++) {
+        const BatchVariant* variant = &BATCH_VARIANTS[i];
+        if (variant->auto_shuffling == auto_shuffling && variant->hole_card == hole_card &&
+            variant->peek == peek) {
+            return i;
+        }
+    }
+    return BATCH_VARIANT_COUNT - 1;
+}
+
+// ============================================================================
+// BATCH OPERATIONS
+// ============================================================================
+int init_batch_engine(BatchEngine* engine, const Ruleset* ruleset, int lane_count,
+                      int seat_count, int hit_below) {
+    memset(engine, 0, sizeof(*engine));
+    if (lane_count <= 0 || lane_count > BATCH_MAX_TABLES) {
+        return 0;
+    }
+    
+    engine->ruleset = *ruleset;
+    engine->lane_count = lane_count;
+    engine->lane_stride = (lane_count + BATCH_LANE_ALIGN - 1) / BATCH_LANE_ALIGN * BATCH_LANE_ALIGN;
+    engine->seat_count = safe_max(1, safe_min(seat_count, ruleset->maximum_player_count));
+    engine->hit_below = hit_below;
+    engine->wager = ruleset->minimum_wager;
+    engine->blackjack_bonus = get_blackjack_payout(ruleset, engine->wager);
+    engine->variant = find_batch_variant(ruleset);
+    
+    // Players, dealer and mask rows, then the tallies and round nets
+    int row_count = engine->seat_count * 3 + 3 + 2 + BATCH_TALLY_COUNT + 1;
+    size_t lane_bytes = (size_t)row_count * engine->lane_stride * sizeof(int32_t);
+    engine->lane_memory = aligned_alloc(BATCH_LANE_ALIGN * sizeof(int32_t), lane_bytes);
+    engine->lane_states = calloc(lane_count, sizeof(int8_t));
+    engine->rounds_left = calloc(lane_count, sizeof(long long));
+    engine->lane_stats = calloc(lane_count, sizeof(GameStats));
+    engine->lane_moments = calloc(lane_count, sizeof(RoundMoments));
+    engine->net_sums = calloc(2 * lane_count, sizeof(long long));
+    engine->shoes = malloc(lane_count * sizeof(Shoe));
+    if (!engine->lane_memory || !engine->lane_states || !engine->rounds_left ||
+        !engine->lane_stats || !engine->lane_moments || !engine->net_sums ||
+        !engine->shoes) {
+        free_batch_engine(engine);
+        return 0;
+    }
+    memset(engine->lane_memory, 0, lane_bytes);
+    
+    int stride = engine->lane_stride;
+    int player_rows = engine->seat_count * stride;
+    engine->hard_totals = engine->lane_memory;
+    engine->ace_masks = engine->hard_totals + player_rows;
+    engine->card_counts = engine->ace_masks + player_rows;
+    engine->dealer_hard_totals = engine->card_counts + player_rows;
+    engine->dealer_ace_masks = engine->dealer_hard_totals + stride;
+    engine->dealer_card_counts = engine->dealer_ace_masks + stride;
+    engine->running_masks = engine->dealer_card_counts + stride;
+    engine->acting_masks = engine->running_masks + stride;
+    engine->tallies = engine->acting_masks + stride;
+    engine->round_nets = engine->tallies + BATCH_TALLY_COUNT * stride;
+    return 1;
+}
+
+void free_batch_engine(BatchEngine* engine) {
+    free(engine->lane_memory);
+    free(engine->lane_states);
+    free(engine->rounds_left);
+    free(engine->lane_stats);
+    free(engine->lane_moments);
+    free(engine->net_sums);
+    free(engine->shoes);
+    memset(engine, 0, sizeof(*engine));
+}
+
+void load_batch_lane(BatchEngine* engine, int lane, const Rng* rng, int antithetic,
+                     long long round_count) {
+    // Same shoe a scalar table starts a simulation chunk with
+    init_ruleset_shoe(&engine->shoes[lane], &engine->ruleset, 0);
+    engine->shoes[lane].antithetic = antithetic;
+    restart_shoe(&engine->shoes[lane], rng);
+    
+    flush_lane_tallies(engine, lane);
+    init_game_stats(&engine->lane_stats[lane]);
+    init_round_moments(&engine->lane_moments[lane]);
+    engine->rounds_left[lane] = round_count;
+    engine->lane_states[lane] = round_count > 0 ? BATCH_LANE_RUNNING : BATCH_LANE_DONE;
+    engine->running_masks[lane] = round_count > 0 ? -1 : 0;
+}
+
+int take_batch_lane_stats(BatchEngine* engine, int lane, GameStats* stats, RoundMoments* moments) {
+    if (engine->lane_states[lane] != BATCH_LANE_DONE) {
+        return 0;
+    }
+    flush_lane_tallies(engine, lane);
+    *stats = engine->lane_stats[lane];
+    *moments = engine->lane_moments[lane];
+    engine->lane_states[lane] = BATCH_LANE_IDLE;
+    return 1;
+}
+
+int play_batch_round(BatchEngine* engine) {
+    return BATCH_VARIANTS[engine->variant].play_round(engine);
+}
+
+const char* batch_variant_name(const Ruleset* ruleset) {
+    return BATCH_VARIANTS[find_batch_variant(ruleset)].name;
+}
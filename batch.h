@@ -0,0 +1,81 @@
+/*
+ * UNIJACK - Batch engine
+ * Plays many tables in lockstep with their hands kept in structure-of-arrays
+ * form, so scoring, hit decisions and outcomes run as SIMD kernels over
+ * every table at once instead of branching table by table.
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "blackjack.h"
+
+// Tables played side by side by one engine
+#define BATCH_DEFAULT_TABLES 256
+#define BATCH_MAX_TABLES 4096
+
+// Lane arrays are padded to this many entries (the widest vector, AVX2)
+// and aligned to match, so every kernel runs on whole vectors
+#define BATCH_LANE_ALIGN 8
+
+// Outcome tallies are 32-bit per lane and folded into GameStats at least
+// this often, well before they could overflow
+#define BATCH_FLUSH_ROUNDS (1 << 20)
+
+// Batch lane states
+#define BATCH_LANE_IDLE 0
+#define BATCH_LANE_RUNNING 1
+#define BATCH_LANE_DONE 2
+
+// Rows of the per-lane tally block: one per outcome, then rounds played
+#define BATCH_ROUND_TALLY (BLACKJACK + 1)
+#define BATCH_TALLY_COUNT (BATCH_ROUND_TALLY + 1)
+
+// Batch engine structure
+// Every lane is one table with its own shoe. The hand of seat s at lane l
+// is stored at [s * lane_stride + l] of the player arrays, the dealer's at
+// [l]. Masks hold -1 for true and 0 for false, like SIMD compare results.
+// Seats always wager the table minimum and decide with a single rule, hit
+// while the hand scores below hit_below, which covers every threshold
+// policy of the scalar simulator. Chip counts are not tracked.
+typedef struct {
+    Ruleset ruleset;
+    int lane_count;
+    int lane_stride;            // lane_count rounded up to BATCH_LANE_ALIGN
+    int seat_count;
+    int hit_below;
+    int wager;
+    int blackjack_bonus;        // Winnings on a blackjack, as pay_gains computes them
+    int variant;                // Ruleset kernel that plays the rounds
+    int32_t* lane_memory;       // Backing store of every array below
+    int32_t* hard_totals;       // seat_count rows
+    int32_t* ace_masks;
+    int32_t* card_counts;
+    int32_t* dealer_hard_totals;
+    int32_t* dealer_ace_masks;
+    int32_t* dealer_card_counts;
+    int32_t* running_masks;     // Lanes playing this round
+    int32_t* acting_masks;      // Running lanes whose seats act, not ended by a dealer peek
+    int32_t* tallies;           // BATCH_TALLY_COUNT rows
+    int32_t* round_nets;        // Chips won this round over the lane's seats
+    int8_t* lane_states;
+    long long* rounds_left;
+    long long rounds_since_flush;
+    GameStats* lane_stats;
+    RoundMoments* lane_moments;
+    long long* net_sums;        // Per lane since the last flush, nets then squared nets
+    Shoe* shoes;
+} BatchEngine;
+
+// Function declarations - Batch operations
+int init_batch_engine(BatchEngine* engine, const Ruleset* ruleset, int lane_count,
+                      int seat_count, int hit_below);
+void free_batch_engine(BatchEngine* engine);
+void load_batch_lane(BatchEngine* engine, int lane, const Rng* rng, int antithetic,
+                     long long round_count);
+int play_batch_round(BatchEngine* engine);
+int take_batch_lane_stats(BatchEngine* engine, int lane, GameStats* stats, RoundMoments* moments);
+const char* batch_kernel_name(void);
+const char* batch_variant_name(const Ruleset* ruleset);
+
+#endif // BATCH_H
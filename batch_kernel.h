@@ -0,0 +1,142 @@
+/*
+ * UNIJACK - Batch round kernel
+ * Template of one ruleset variant of the batch round. batch.c includes it
+ * once per variant after defining:
+ *   KERNEL_SUFFIX          appended to the name of every generated function
+ *   KERNEL_AUTO_SHUFFLING  the lanes deal from a shuffling machine
+ *   KERNEL_HOLE_CARD       the dealer takes a hole card
+ *   KERNEL_PEEK            the dealer checks the hole card for a blackjack
+ * Constants fold the rules into the code and drop the branches they rule
+ * out; the generic variant defines them over engine->ruleset instead.
+ */
+
+// No include guard, every inclusion generates one variant
+#define KERNEL_JOIN(name, suffix) name##_##suffix
+#define KERNEL_EXPAND(name, suffix) KERNEL_JOIN(name, suffix)
+#define KERNEL_FN(name) KERNEL_EXPAND(name, KERNEL_SUFFIX)
+
+static inline void KERNEL_FN(deal_to_lane)(BatchEngine* engine, int lane, int32_t* hard,
+                                           int32_t* aces, int32_t* counts, int idx) {
+    Shoe* shoe = &engine->shoes[lane];
+    Card card = KERNEL_AUTO_SHUFFLING ? draw_lane_machine_card(shoe) : draw_lane_shoe_card(shoe);
+    hard[idx] += RANK_VALUES[CARD_RANK(card)];
+    aces[idx] |= -(CARD_RANK(card) == 0);
+    counts[idx]++;
+}
+
+static void KERNEL_FN(deal_batch_cards)(BatchEngine* engine) {
+    // Per lane, cards come out in the order deal_initial_cards uses
+    int stride = engine->lane_stride;
+    int32_t* hard = engine->hard_totals;
+    int32_t* aces = engine->ace_masks;
+    int32_t* counts = engine->card_counts;
+    
+    for (int lane = 0; lane < engine->lane_count; lane++) {
+        if (!engine->running_masks[lane]) {
+            continue;
+        }
+        for (int seat = 0; seat < engine->seat_count; seat++) {
+            KERNEL_FN(deal_to_lane)(engine, lane, hard, aces, counts, seat * stride + lane);
+        }
+        KERNEL_FN(deal_to_lane)(engine, lane, engine->dealer_hard_totals, engine->dealer_ace_masks,
+                                engine->dealer_card_counts, lane);
+        for (int seat = 0; seat < engine->seat_count; seat++) {
+            KERNEL_FN(deal_to_lane)(engine, lane, hard, aces, counts, seat * stride + lane);
+        }
+        if (KERNEL_HOLE_CARD) {
+            KERNEL_FN(deal_to_lane)(engine, lane, engine->dealer_hard_totals, engine->dealer_ace_masks,
+                                    engine->dealer_card_counts, lane);
+        }
+    }
+}
+
+static void KERNEL_FN(peek_batch_dealer)(BatchEngine* engine) {
+    // A revealed dealer blackjack ends the round before the seats act,
+    // as in play_new_round
+    if (!KERNEL_PEEK) {
+        memcpy(engine->acting_masks, engine->running_masks, engine->lane_stride * sizeof(int32_t));
+        return;
+    }
+    for (int i = 0; i < engine->lane_stride; i += BATCH_VECTOR_WIDTH) {
+        BatchVec d_blackjack = vec_blackjack(vec_load(&engine->dealer_hard_totals[i]),
+                                             vec_load(&engine->dealer_ace_masks[i]),
+                                             vec_load(&engine->dealer_card_counts[i]));
+        vec_store(&engine->acting_masks[i], vec_andnot(d_blackjack, vec_load(&engine->running_masks[i])));
+    }
+}
+
+static void KERNEL_FN(play_batch_seat)(BatchEngine* engine, int seat) {
+    int32_t* hard = &engine->hard_totals[seat * engine->lane_stride];
+    int32_t* aces = &engine->ace_masks[seat * engine->lane_stride];
+    int32_t* counts = &engine->card_counts[seat * engine->lane_stride];
+    
+    // Each pass gives one card to every lane still hitting; a lane's seats
+    // play one after the other, so its own draw order matches the scalar game
+    int hitting = 1;
+    while (hitting) {
+        hitting = 0;
+        for (int i = 0; i < engine->lane_stride; i += BATCH_VECTOR_WIDTH) {
+            BatchVec hits = vec_hits(vec_load(&engine->acting_masks[i]), vec_load(&hard[i]),
+                                     vec_load(&aces[i]), engine->hit_below);
+            int bits = vec_mask_bits(hits);
+            while (bits) {
+                int lane = i + __builtin_ctz(bits);
+                KERNEL_FN(deal_to_lane)(engine, lane, hard, aces, counts, lane);
+                bits &= bits - 1;
+                hitting = 1;
+            }
+        }
+    }
+}
+
+static void KERNEL_FN(play_batch_dealer)(BatchEngine* engine) {
+    if (!KERNEL_HOLE_CARD) {
+        for (int lane = 0; lane < engine->lane_count; lane++) {
+            if (engine->running_masks[lane]) {
+                KERNEL_FN(deal_to_lane)(engine, lane, engine->dealer_hard_totals,
+                                        engine->dealer_ace_masks, engine->dealer_card_counts, lane);
+            }
+        }
+    }
+    
+    // The dealer hits below MINIMUM_DEALER_SCORE, exactly like a seat would
+    int hitting = 1;
+    while (hitting) {
+        hitting = 0;
+        for (int i = 0; i < engine->lane_stride; i += BATCH_VECTOR_WIDTH) {
+            BatchVec hits = vec_hits(vec_load(&engine->running_masks[i]),
+                                     vec_load(&engine->dealer_hard_totals[i]),
+                                     vec_load(&engine->dealer_ace_masks[i]), MINIMUM_DEALER_SCORE);
+            int bits = vec_mask_bits(hits);
+            while (bits) {
+                int lane = i + __builtin_ctz(bits);
+                KERNEL_FN(deal_to_lane)(engine, lane, engine->dealer_hard_totals,
+                                        engine->dealer_ace_masks, engine->dealer_card_counts, lane);
+                bits &= bits - 1;
+                hitting = 1;
+            }
+        }
+    }
+}
+
+static int KERNEL_FN(play_batch_round)(BatchEngine* engine) {
+    clear_batch_hands(engine);
+    KERNEL_FN(deal_batch_cards)(engine);
+    KERNEL_FN(peek_batch_dealer)(engine);
+    for (int seat = 0; seat < engine->seat_count; seat++) {
+        KERNEL_FN(play_batch_seat)(engine, seat);
+    }
+    KERNEL_FN(play_batch_dealer)(engine);
+    for (int seat = 0; seat < engine->seat_count; seat++) {
+        tally_outcomes(engine, seat);
+    }
+    return finish_batch_round(engine);
+}
+
+#undef KERNEL_FN
+#undef KERNEL_EXPAND
+#undef KERNEL_JOIN
+#undef KERNEL_SUFFIX
+#undef KERNEL_AUTO_SHUFFLING
+#undef KERNEL_HOLE_CARD
+#undef KERNEL_PEEK
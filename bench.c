@@ -0,0 +1,462 @@
+/*
+ * UNIJACK - Benchmark suite
+ * Times the engine's hot operations and whole headless rounds, and writes
+ * the results as text, JSON or CSV so builds can be compared.
+ */
+
+#include "sim.h"
+
+#define BENCH_HAND_COUNT 1024
+#define BENCH_MAX_REPETITIONS 100
+#define BENCH_MAX_NAME_LEN 64
+#define BENCH_BATCH_TABLES 256
+
+// Output formats
+#define BENCH_FORMAT_TEXT 0
+#define BENCH_FORMAT_JSON 1
+#define BENCH_FORMAT_CSV 2
+
+// Benchmark state - everything a case may need, set up before it is timed
+typedef struct {
+    Shoe shoe;
+    Hand hands[BENCH_HAND_COUNT];
+    Hand dealer_hands[BENCH_HAND_COUNT];
+    Table table;
+    Game game;
+    BatchEngine batch;
+    Rng rng;
+    long long sink;             // Keeps results alive so no work is optimized away
+} BenchState;
+
+// Benchmark case - setup is untimed, run performs op_count operations
+typedef struct {
+    const char* name;
+    const char* unit;
+    long long op_count;
+    int (*setup)(BenchState* state, int param);
+    void (*run)(BenchState* state, long long op_count);
+    void (*teardown)(BenchState* state);
+    int param;
+} BenchCase;
+
+// Benchmark result - nanoseconds per operation over the timed repetitions
+typedef struct {
+    const BenchCase* bench;
+    long long op_count;
+    double ns_min;
+    double ns_median;
+    double ns_mean;
+    double ops_per_sec;
+} BenchResult;
+
+// ============================================================================
+// SHOE CASES
+// ============================================================================
+static int setup_shoe(BenchState* state, int auto_shuffling) {
+    init_shoe(&state->shoe, MAX_DECKS, auto_shuffling, 1);
+    if (auto_shuffling) {
+        state->shoe.return_delay = 1;
+    } else {
+        place_cut_card(&state->shoe, 0.75);
+    }
+    return 1;
+}
+
+static void run_shuffle_shoe(BenchState* state, long long op_count) {
+    for (long long i = 0; i < op_count; i++) {
+        shuffle_shoe(&state->shoe);
+    }
+    state->sink += state->shoe.cards[0];
+}
+
+static void run_draw_card(BenchState* state, long long op_count) {
+    // Rounds of ten cards, so discards and reshuffles happen as in play
+    long long sink = 0;
+    for (long long i = 0; i < op_count; i++) {
+        sink += draw_card(&state->shoe, 1);
+        if (i % 10 == 9) {
+            collect_discards(&state->shoe);
+        }
+    }
+    collect_discards(&state->shoe);
+    state->sink += sink;
+}
+
+// ============================================================================
+// HAND CASES
+// ============================================================================
+static void deal_bench_hand(BenchState* state, Hand* hand, int card_count) {
+    init_hand(hand);
+    for (int i = 0; i < card_count; i++) {
+        int rank = (int)rng_bounded(&state->rng, NUM_RANKS);
+        add_card_to_hand(hand, MAKE_CARD((int)rng_bounded(&state->rng, NUM_SUITS), rank));
+    }
+}
+
+static int setup_hands(BenchState* state, int card_count) {
+    rng_seed(&state->rng, 1);
+    for (int i = 0; i < BENCH_HAND_COUNT; i++) {
+        deal_bench_hand(state, &state->hands[i], card_count);
+        // Dealer hands are drawn to at least 17, like real ones
+        init_hand(&state->dealer_hands[i]);
+        while (score_from_hand(&state->dealer_hands[i]) < MINIMUM_DEALER_SCORE) {
+            int rank = (int)rng_bounded(&state->rng, NUM_RANKS);
+            add_card_to_hand(&state->dealer_hands[i], MAKE_CARD(0, rank));
+        }
+    }
+    return 1;
+}
+
+static void run_score_from_hand(BenchState* state, long long op_count) {
+    long long sink = 0;
+    for (long long i = 0; i < op_count; i++) {
+        sink += score_from_hand(&state->hands[i & (BENCH_HAND_COUNT - 1)]);
+    }
+    state->sink += sink;
+}
+
+static void run_compare_hands(BenchState* state, long long op_count) {
+    long long sink = 0;
+    for (long long i = 0; i < op_count; i++) {
+        int outcome_player, outcome_dealer;
+        int idx = (int)(i & (BENCH_HAND_COUNT - 1));
+        compare_hands(&state->hands[idx], &state->dealer_hands[idx], &outcome_player, &outcome_dealer);
+        sink += outcome_player;
+    }
+    state->sink += sink;
+}
+
+// ============================================================================
+// ROUND CASES
+// ============================================================================
+static int init_bench_ruleset(Ruleset* ruleset, int ruleset_idx) {
+    static const char* const RULESET_NAMES[] = {"basic", "european", "american"};
+    return init_ruleset_by_name(ruleset, RULESET_NAMES[ruleset_idx]);
+}
+
+static int setup_round(BenchState* state, int ruleset_idx) {
+    Ruleset ruleset;
+    init_bench_ruleset(&ruleset, ruleset_idx);
+    init_table(&state->table, &ruleset, 1);
+    init_player(&state->table.players[0], "Bench", SIM_STARTING_CHIPS);
+    state->table.player_count = 1;
+    init_game(&state->game, &ruleset);
+    state->game.policy = find_sim_policy("mimic");
+    return 1;
+}
+
+static void run_round(BenchState* state, long long op_count) {
+    Player* player = &state->table.players[0];
+    for (long long i = 0; i < op_count; i++) {
+        if (player->chip_count < state->game.ruleset.minimum_wager) {
+            player->chip_count = SIM_STARTING_CHIPS;
+        }
+        play_new_round(&state->game, &state->table);
+    }
+    state->sink += state->game.stats.total_paid;
+}
+
+static int setup_batch_round(BenchState* state, int ruleset_idx) {
+    Ruleset ruleset;
+    init_bench_ruleset(&ruleset, ruleset_idx);
+    if (!init_batch_engine(&state->batch, &ruleset, BENCH_BATCH_TABLES, 1,
+                           sim_policy_hit_below(find_sim_policy("mimic")))) {
+        return 0;
+    }
+    Rng master;
+    rng_seed(&master, 1);
+    for (int lane = 0; lane < BENCH_BATCH_TABLES; lane++) {
+        Rng rng;
+        rng_split(&master, &rng);
+        load_batch_lane(&state->batch, lane, &rng, 0, 1LL << 40);
+    }
+    return 1;
+}
+
+static void run_batch_round(BenchState* state, long long op_count) {
+    // One batch round is a round on every table
+    for (long long i = 0; i < op_count; i += BENCH_BATCH_TABLES) {
+        play_batch_round(&state->batch);
+    }
+    state->sink += state->batch.tallies[0];
+}
+
+static void teardown_batch_round(BenchState* state) {
+    free_batch_engine(&state->batch);
+}
+
+// ============================================================================
+// BENCHMARK CASES
+// ============================================================================
+static const BenchCase BENCH_CASES[] = {
+    {"shuffle_shoe",         "shuffle", 2000,     setup_shoe,  run_shuffle_shoe,    NULL, 0},
+    {"draw_card/shoe",       "card",    4000000,  setup_shoe,  run_draw_card,       NULL, 0},
+    {"draw_card/machine",    "card",    4000000,  setup_shoe,  run_draw_card,       NULL, 1},
+    {"score_from_hand/2",    "hand",    20000000, setup_hands, run_score_from_hand, NULL, 2},
+    {"score_from_hand/3",    "hand",    20000000, setup_hands, run_score_from_hand, NULL, 3},
+    {"score_from_hand/5",    "hand",    20000000, setup_hands, run_score_from_hand, NULL, 5},
+    {"score_from_hand/8",    "hand",    20000000, setup_hands, run_score_from_hand, NULL, 8},
+    {"compare_hands",        "hand",    20000000, setup_hands, run_compare_hands,   NULL, 2},
+    {"round/basic",          "round",   500000,   setup_round, run_round,           NULL, 0},
+    {"round/european",       "round",   500000,   setup_round, run_round,           NULL, 1},
+    {"round/american",       "round",   500000,   setup_round, run_round,           NULL, 2},
+    {"batch_round/basic",    "round",   2000000,  setup_batch_round, run_batch_round, teardown_batch_round, 0},
+    {"batch_round/european", "round",   2000000,  setup_batch_round, run_batch_round, teardown_batch_round, 1},
+    {"batch_round/american", "round",   2000000,  setup_batch_round, run_batch_round, teardown_batch_round, 2},
+};
+
+#define BENCH_CASE_COUNT ((int)(sizeof(BENCH_CASES) / sizeof(BENCH_CASES[0])))
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static int run_bench_case(const BenchCase* bench, double scale, int warmup_count,
+                          int repetition_count, BenchState* state, BenchResult* result) {
+    if (!bench->setup(state, bench->param)) {
+        return 0;
+    }
+    
+    long long op_count = (long long)(bench->op_count * scale);
+    if (op_count < 1) {
+        op_count = 1;
+    }
+    for (int i = 0; i < warmup_count; i++) {
+        bench->run(state, op_count);
+    }
+    
+    double samples[BENCH_MAX_REPETITIONS];
+    double total = 0.0;
+    for (int i = 0; i < repetition_count; i++) {
+        double start = sim_clock_seconds();
+        bench->run(state, op_count);
+        samples[i] = (sim_clock_seconds() - start) * 1e9 / (double)op_count;
+        total += samples[i];
+    }
+    if (bench->teardown) {
+        bench->teardown(state);
+    }
+    
+    qsort(samples, repetition_count, sizeof(double), compare_doubles);
+    result->bench = bench;
+    result->op_count = op_count;
+    result->ns_min = samples[0];
+    result->ns_median = repetition_count % 2
+        ? samples[repetition_count / 2]
+        : 0.5 * (samples[repetition_count / 2 - 1] + samples[repetition_count / 2]);
+    result->ns_mean = total / repetition_count;
+    result->ops_per_sec = result->ns_median > 0.0 ? 1e9 / result->ns_median : 0.0;
+    return 1;
+}
+
+// ============================================================================
+// REPORTS
+// ============================================================================
+static void write_text_report(FILE* stream, const BenchResult* results, int result_count) {
+    fprintf(stream, "%-22s %12s %12s %12s %16s\n", "benchmark", "min ns/op", "median", "mean", "ops/sec");
+    for (int i = 0; i < result_count; i++) {
+        const BenchResult* r = &results[i];
+        char rate[BENCH_MAX_NAME_LEN];
+        snprintf(rate, sizeof(rate), "%.0f %ss", r->ops_per_sec, r->bench->unit);
+        fprintf(stream, "%-22s %12.2f %12.2f %12.2f %16s\n",
+                r->bench->name, r->ns_min, r->ns_median, r->ns_mean, rate);
+    }
+}
+
+static void write_json_report(FILE* stream, const BenchResult* results, int result_count,
+                              int warmup_count, int repetition_count) {
+    fprintf(stream, "{\n");
+    fprintf(stream, "  \"compiler\": \"%s\",\n", __VERSION__);
+    fprintf(stream, "  \"batch_kernels\": \"%s\",\n", batch_kernel_name());
+    fprintf(stream, "  \"warmup\": %d,\n", warmup_count);
+    fprintf(stream, "  \"repetitions\": %d,\n", repetition_count);
+    fprintf(stream, "  \"results\": [\n");
+    for (int i = 0; i < result_count; i++) {
+        const BenchResult* r = &results[i];
+        fprintf(stream,
+                "    {\"name\": \"%s\", \"unit\": \"%s\", \"ops\": %lld, \"ns_min\": %.3f, "
+                "\"ns_median\": %.3f, \"ns_mean\": %.3f, \"ops_per_sec\": %.1f}%s\n",
+                r->bench->name, r->bench->unit, r->op_count, r->ns_min, r->ns_median,
+                r->ns_mean, r->ops_per_sec, i + 1 < result_count ? "," : "");
+    }
+    fprintf(stream, "  ]\n}\n");
+}
+
+static void write_csv_report(FILE* stream, const BenchResult* results, int result_count) {
+    fprintf(stream, "name,unit,ops,ns_min,ns_median,ns_mean,ops_per_sec\n");
+    for (int i = 0; i < result_count; i++) {
+        const BenchResult* r = &results[i];
+        fprintf(stream, "%s,%s,%lld,%.3f,%.3f,%.3f,%.1f\n", r->bench->name, r->bench->unit,
+                r->op_count, r->ns_min, r->ns_median, r->ns_mean, r->ops_per_sec);
+    }
+}
+
+static int compare_with_baseline(const char* path, const BenchResult* results, int result_count,
+                                 double max_regression) {
+    // Baselines are CSV reports from an earlier run; medians are compared
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Cannot open baseline \"%s\"\n", path);
+        return -1;
+    }
+    
+    int regression_count = 0;
+    char line[MAX_STRING_LEN * 2];
+    printf("\n%-22s %12s %12s %9s\n", "benchmark", "baseline", "now", "change");
+    while (fgets(line, sizeof(line), file)) {
+        char name[BENCH_MAX_NAME_LEN];
+        double ns_min, ns_median;
+        if (sscanf(line, "%63[^,],%*[^,],%*[^,],%lf,%lf", name, &ns_min, &ns_median) != 3) {
+            continue;  // Header or malformed line
+        }
+        for (int i = 0; i < result_count; i++) {
+            if (strcmp(results[i].bench->name, name) != 0 || ns_median <= 0.0) {
+                continue;
+            }
+            double change = 100.0 * (results[i].ns_median - ns_median) / ns_median;
+            int regressed = change > max_regression;
+            printf("%-22s %12.2f %12.2f %+8.1f%%%s\n", name, ns_median, results[i].ns_median,
+                   change, regressed ? "  REGRESSION" : "");
+            regression_count += regressed;
+        }
+    }
+    fclose(file);
+    return regression_count;
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --filter TEXT      only run benchmarks whose name contains TEXT\n"
+        "  --warmup N         untimed runs before measuring (default: 1)\n"
+        "  --repetitions N    timed runs per benchmark (default: 5)\n"
+        "  --scale X          multiply every operation count by X (default: 1)\n"
+        "  --format NAME      text, json or csv (default: text)\n"
+        "  --output FILE      write the report to FILE instead of stdout\n"
+        "  --baseline FILE    compare medians with an earlier csv report\n"
+        "  --max-regression P fail when a median is more than P%% slower (default: 10)\n"
+        "  --list             list benchmark names\n",
+        program);
+}
+
+int main(int argc, char** argv) {
+#ifdef UNIVAC
+    init_bss();
+#endif
+    
+    const char* filter = NULL;
+    const char* output_path = NULL;
+    const char* baseline_path = NULL;
+    int warmup_count = 1;
+    int repetition_count = 5;
+    double scale = 1.0;
+    double max_regression = 10.0;
+    int format = BENCH_FORMAT_TEXT;
+    
+    for (int i = 1; i < argc; i++) {
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        
+        if (strcmp(argv[i], "--filter") == 0 && value) {
+            filter = value;
+            i++;
+        } else if (strcmp(argv[i], "--warmup") == 0 && value) {
+            warmup_count = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--repetitions") == 0 && value) {
+            repetition_count = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--scale") == 0 && value) {
+            scale = atof(value);
+            i++;
+        } else if (strcmp(argv[i], "--format") == 0 && value) {
+            if (strcmp(value, "text") == 0) {
+                format = BENCH_FORMAT_TEXT;
+            } else if (strcmp(value, "json") == 0) {
+                format = BENCH_FORMAT_JSON;
+            } else if (strcmp(value, "csv") == 0) {
+                format = BENCH_FORMAT_CSV;
+            } else {
+                fprintf(stderr, "Unknown format \"%s\"\n", value);
+                return 1;
+            }
+            i++;
+        } else if (strcmp(argv[i], "--output") == 0 && value) {
+            output_path = value;
+            i++;
+        } else if (strcmp(argv[i], "--baseline") == 0 && value) {
+            baseline_path = value;
+            i++;
+        } else if (strcmp(argv[i], "--max-regression") == 0 && value) {
+            max_regression = atof(value);
+            i++;
+        } else if (strcmp(argv[i], "--list") == 0) {
+            for (int j = 0; j < BENCH_CASE_COUNT; j++) {
+                printf("%s\n", BENCH_CASES[j].name);
+            }
+            return 0;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (warmup_count < 0 || repetition_count <= 0 || repetition_count > BENCH_MAX_REPETITIONS ||
+        scale <= 0.0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    BenchState* state = calloc(1, sizeof(BenchState));
+    BenchResult results[BENCH_CASE_COUNT];
+    int result_count = 0;
+    if (!state) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    
+    set_verbosity(VERBOSITY_SILENT);
+    for (int i = 0; i < BENCH_CASE_COUNT; i++) {
+        if (filter && !strstr(BENCH_CASES[i].name, filter)) {
+            continue;
+        }
+        fprintf(stderr, "Running %s...\n", BENCH_CASES[i].name);
+        if (run_bench_case(&BENCH_CASES[i], scale, warmup_count, repetition_count,
+                           state, &results[result_count])) {
+            result_count++;
+        } else {
+            fprintf(stderr, "Setup of %s failed, skipped\n", BENCH_CASES[i].name);
+        }
+    }
+    set_verbosity(VERBOSITY_FULL);
+    
+    FILE* output = output_path ? fopen(output_path, "w") : stdout;
+    if (!output) {
+        fprintf(stderr, "Cannot write \"%s\"\n", output_path);
+        free(state);
+        return 1;
+    }
+    if (format == BENCH_FORMAT_JSON) {
+        write_json_report(output, results, result_count, warmup_count, repetition_count);
+    } else if (format == BENCH_FORMAT_CSV) {
+        write_csv_report(output, results, result_count);
+    } else {
+        write_text_report(output, results, result_count);
+    }
+    if (output != stdout) {
+        fclose(output);
+    }
+    
+    int status = 0;
+    if (baseline_path) {
+        int regression_count = compare_with_baseline(baseline_path, results, result_count, max_regression);
+        status = regression_count != 0;
+    }
+    
+    fprintf(stderr, "(checksum %lld)\n", state->sink);
+    free(state);
+    return status;
+}
@@ -5,13 +5,29 @@
  */
 
 #include "blackjack.h"
+#include "instrument.h"
 
-// Suit and rank names
-static const char* SUIT_NAMES[NUM_SUITS] = {"Spade", "Heart", "Diamond", "Club"};
-static const char* RANK_NAMES[NUM_RANKS] = {
-    "Ace", "2", "3", "4", "5", "6", "7", "8", "9", "10", "Jack", "Queen", "King"
+#ifdef UNIVAC
+#include <unistd.h>
+#endif
+
+// Card names indexed by the rank and suit bits of a card
+#define SUIT_CARD_NAMES(suit) \
+    "Ace of " suit "s", "2 of " suit "s", "3 of " suit "s", "4 of " suit "s", \
+    "5 of " suit "s", "6 of " suit "s", "7 of " suit "s", "8 of " suit "s", \
+    "9 of " suit "s", "10 of " suit "s", "Jack of " suit "s", "Queen of " suit "s", \
+    "King of " suit "s", NULL, NULL, NULL
+
+static const char* CARD_NAMES[CARD_FACE_COUNT] = {
+    SUIT_CARD_NAMES("Spade"),
+    SUIT_CARD_NAMES("Heart"),
+    SUIT_CARD_NAMES("Diamond"),
+    SUIT_CARD_NAMES("Club")
 };
 
+// Hard value of each rank (aces count as 1, see SOFT_ACE_BONUS)
+const uint8_t RANK_VALUES[NUM_RANKS] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 10, 10, 10};
+
 // BSS initialization for UNIVAC
 #ifdef UNIVAC
 Card g_deck_template[MAX_CARDS_IN_DECK];
@@ -25,83 +41,27 @@ void init_bss(void) {
 }
 #endif
 
-// ============================================================================
-// MAIN ENTRY POINT
-// ============================================================================
-int main(void) {
-#ifndef UNIVAC
-    console_setup();
-#endif
-
-#ifdef UNIVAC
-    init_bss();
-#endif
-    
-    // Seed random number generator
-    srand((unsigned int)time(NULL));
-    
-    // Default to American ruleset
-    Ruleset ruleset;
-    init_american_ruleset(&ruleset);
-    
-    // Default player
-    Table table;
-    init_table(&table, &ruleset);
-    
-    // Get player name
-    char player_name[MAX_NAME_LEN];
-    printf("Enter player name: ");
-    if (fgets(player_name, sizeof(player_name), stdin)) {
-        size_t len = strlen(player_name);
-        if (len > 0 && player_name[len - 1] == '\n') {
-            player_name[len - 1] = '\0';
-        }
-    }
-    if (strlen(player_name) == 0) {
-        SAFE_STRCPY(player_name, "Player", sizeof(player_name));
-    }
-    
-    // Initialize player
-    init_player(&table.players[0], player_name, 100);
-    table.player_count = 1;
-    
-    // Create and run game
-    Game game;
-    init_game(&game, &ruleset);
-    run_game(&game, &table);
-    
-    return 0;
-}
-
 // ============================================================================
 // CARD OPERATIONS
 // ============================================================================
 void init_card(Card* card, int suit, int rank) {
-    card->suit = suit;
-    card->rank = rank;
-    card->visible = 0;
+    *card = MAKE_CARD(suit, rank);
 }
 
-void get_card_name(const Card* card, char* buffer, size_t buffer_size) {
-    if (card->visible) {
-        snprintf(buffer, buffer_size, "%s of %ss", 
-                RANK_NAMES[card->rank], SUIT_NAMES[card->suit]);
-    } else {
-        snprintf(buffer, buffer_size, "<hidden>");
-    }
+const char* card_name(Card card) {
+    return CARD_IS_VISIBLE(card) ? CARD_NAMES[card & CARD_FACE_MASK] : "<hidden>";
 }
 
-void get_card_values(const Card* card, int* values, int* value_count) {
-    if (card->rank == 0) {  // Ace
-        values[0] = 1;
-        values[1] = 11;
+void get_card_name(Card card, char* buffer, size_t buffer_size) {
+    snprintf(buffer, buffer_size, "%s", card_name(card));
+}
+
+void get_card_values(Card card, int* values, int* value_count) {
+    values[0] = RANK_VALUES[CARD_RANK(card)];
+    *value_count = 1;
+    if (CARD_RANK(card) == 0) {  // Ace
+        values[1] = values[0] + SOFT_ACE_BONUS;
         *value_count = 2;
-    } else if (card->rank >= 10) {  // Jack, Queen, King
-        values[0] = 10;
-        *value_count = 1;
-    } else {  // 2-10
-        values[0] = card->rank + 1;
-        *value_count = 1;
     }
 }
 
@@ -121,10 +81,15 @@ void create_deck(Card* deck) {
 // ============================================================================
 // SHOE OPERATIONS
 // ============================================================================
-void init_shoe(Shoe* shoe, int deck_count, int auto_shuffling) {
+void init_shoe(Shoe* shoe, int deck_count, int auto_shuffling, uint64_t seed) {
+    rng_seed(&shoe->rng, seed);
     shoe->auto_shuffling = auto_shuffling;
     shoe->total_cards = deck_count * MAX_CARDS_IN_DECK;
-    shoe->current_index = 0;
+    shoe->return_delay = 0;
+    shoe->cut_card_index = shoe->total_cards;
+    shoe->counting_system_count = 0;
+    shoe->antithetic = 0;
+    reload_shoe(shoe);
     
     // Create multiple decks
     Card single_deck[MAX_CARDS_IN_DECK];
@@ -134,66 +99,273 @@ void init_shoe(Shoe* shoe, int deck_count, int auto_shuffling) {
         for (int card = 0; card < MAX_CARDS_IN_DECK; card++) {
             int idx = deck * MAX_CARDS_IN_DECK + card;
             shoe->cards[idx] = single_deck[card];
-            shoe->cards[idx].visible = 0;
         }
     }
     
     shuffle_shoe(shoe);
 }
 
-void shuffle_shoe(Shoe* shoe) {
+static inline int pick_from_shoe(Shoe* shoe, int bound) {
+    // An antithetic shoe turns every pick u into 1 - u, so it pairs with the
+    // shoe that draws the same stream as is
+    int pick = (int)rng_bounded(&shoe->rng, (uint32_t)bound);
+    return shoe->antithetic ? bound - 1 - pick : pick;
+}
+
+static void shuffle_cards(Shoe* shoe, Card* cards, int count) {
+    INSTR_EVENT(INSTR_EVENT_SHUFFLE);
     // Fisher-Yates shuffle
-    for (int i = shoe->total_cards - 1; i > 0; i--) {
-        int j = rand() % (i + 1);
-        Card temp = shoe->cards[i];
-        shoe->cards[i] = shoe->cards[j];
-        shoe->cards[j] = temp;
+    for (int i = count - 1; i > 0; i--) {
+        int j = pick_from_shoe(shoe, i + 1);
+        Card temp = cards[i];
+        cards[i] = cards[j];
+        cards[j] = temp;
     }
 }
 
+void shuffle_shoe(Shoe* shoe) {
+    shuffle_cards(shoe, shoe->cards, shoe->total_cards);
+}
+
 void reload_shoe(Shoe* shoe) {
+    // Cards in the shoe are always face down, only drawn copies are turned
+    INSTR_EVENT(INSTR_EVENT_RELOAD);
     shoe->current_index = 0;
-    // Reset all cards to face down
-    for (int i = 0; i < shoe->total_cards; i++) {
-        shoe->cards[i].visible = 0;
+    shoe->cut_card_reached = 0;
+    shoe->machine_start = 0;
+    shoe->machine_count = shoe->total_cards;
+    shoe->round_dealt_count = 0;
+    shoe->pending_round_count = 0;
+    
+    int decks = shoe->total_cards / MAX_CARDS_IN_DECK;
+    for (int rank = 0; rank < NUM_RANKS; rank++) {
+        shoe->remaining_counts[rank] = NUM_SUITS * decks;
+    }
+    for (int i = 0; i < shoe->counting_system_count; i++) {
+        shoe->running_counts[i] = shoe->initial_running_counts[i];
     }
 }
 
-Card* draw_card(Shoe* shoe, int visible) {
-    if (shoe->auto_shuffling) {
-        shuffle_shoe(shoe);
+void restart_shoe(Shoe* shoe, const Rng* rng) {
+    // Continue from a given random stream with every card back in the shoe
+    shoe->rng = *rng;
+    reload_shoe(shoe);
+    shuffle_shoe(shoe);
+}
+
+static void count_card_out(Shoe* shoe, Card card) {
+    int rank = CARD_RANK(card);
+    shoe->remaining_counts[rank]--;
+    for (int i = 0; i < shoe->counting_system_count; i++) {
+        shoe->running_counts[i] += shoe->count_weights[i][rank];
+    }
+}
+
+static void count_card_back(Shoe* shoe, Card card) {
+    int rank = CARD_RANK(card);
+    shoe->remaining_counts[rank]++;
+    for (int i = 0; i < shoe->counting_system_count; i++) {
+        shoe->running_counts[i] -= shoe->count_weights[i][rank];
+    }
+}
+
+static void return_oldest_discards(Shoe* shoe) {
+    // The oldest dealt cards sit just before machine_start in the ring
+    int count = shoe->pending_cards[0];
+    for (int i = 1; i <= count; i++) {
+        count_card_back(shoe, shoe->cards[(shoe->machine_start - i + shoe->total_cards) % shoe->total_cards]);
     }
+    shoe->machine_start = (shoe->machine_start - count + shoe->total_cards) % shoe->total_cards;
+    shoe->machine_count += count;
+    shoe->current_index -= count;
     
-    if (shoe->current_index >= shoe->total_cards) {
-        reload_shoe(shoe);
+    shoe->pending_round_count--;
+    for (int i = 0; i < shoe->pending_round_count; i++) {
+        shoe->pending_cards[i] = shoe->pending_cards[i + 1];
+    }
+}
+
+static Card draw_from_machine(Shoe* shoe) {
+    while (shoe->machine_count == 0 && shoe->pending_round_count > 0) {
+        return_oldest_discards(shoe);
+    }
+    if (shoe->machine_count == 0) {
+        reload_shoe(shoe);  // Every card is on the table, start over
     }
     
-    Card* card = &shoe->cards[shoe->current_index];
-    card->visible = visible;
-    shoe->current_index++;
+    // Pick any card left in the machine and move it to the end of the
+    // machine's part of the ring, where it becomes the newest dealt card
+    int last = (shoe->machine_start + shoe->machine_count - 1) % shoe->total_cards;
+    int pick = (shoe->machine_start + pick_from_shoe(shoe, shoe->machine_count))
+               % shoe->total_cards;
+    Card card = shoe->cards[pick];
+    shoe->cards[pick] = shoe->cards[last];
+    shoe->cards[last] = card;
     
+    shoe->machine_count--;
+    shoe->current_index++;
+    shoe->round_dealt_count++;
     return card;
 }
 
+static void reshuffle_discard_tray(Shoe* shoe) {
+    // The shoe ran dry mid-round: the cards on the table stay out, moved to
+    // the front, and the discard tray is shuffled in behind them
+    int in_play = shoe->round_dealt_count;
+    if (in_play >= shoe->total_cards) {
+        in_play = 0;  // Every card is on the table, start over
+    }
+    
+    Card table_cards[MAX_CARDS_IN_SHOE];
+    int tray_count = shoe->total_cards - in_play;
+    memcpy(table_cards, &shoe->cards[tray_count], in_play * sizeof(Card));
+    memmove(&shoe->cards[in_play], &shoe->cards[0], tray_count * sizeof(Card));
+    memcpy(shoe->cards, table_cards, in_play * sizeof(Card));
+    
+    reload_shoe(shoe);
+    for (int i = 0; i < in_play; i++) {
+        count_card_out(shoe, shoe->cards[i]);
+    }
+    shoe->current_index = in_play;
+    shoe->round_dealt_count = in_play;
+    shuffle_cards(shoe, &shoe->cards[in_play], tray_count);
+}
+
+Card draw_card(Shoe* shoe, int visible) {
+    Card card;
+    INSTR_EVENT(INSTR_EVENT_DRAW);
+    
+    if (shoe->auto_shuffling) {
+        card = draw_from_machine(shoe);
+    } else {
+        if (shoe->current_index >= shoe->total_cards) {
+            reshuffle_discard_tray(shoe);
+        }
+        card = shoe->cards[shoe->current_index];
+        shoe->current_index++;
+        shoe->round_dealt_count++;
+        if (shoe->current_index >= shoe->cut_card_index) {
+            shoe->cut_card_reached = 1;
+        }
+    }
+    count_card_out(shoe, card);
+    
+    return visible ? (Card)(card | CARD_VISIBLE_BIT) : card;
+}
+
+void init_ruleset_shoe(Shoe* shoe, const Ruleset* ruleset, uint64_t seed) {
+    init_shoe(shoe, ruleset->deck_count_in_shoe, ruleset->auto_shuffling_shoe, seed);
+    shoe->return_delay = safe_max(0, safe_min(ruleset->machine_return_delay, MAX_MACHINE_RETURN_DELAY));
+    place_cut_card(shoe, ruleset->cut_card_penetration);
+}
+
+void place_cut_card(Shoe* shoe, double penetration) {
+    int index = (int)(shoe->total_cards * penetration);
+    shoe->cut_card_index = safe_max(0, safe_min(index, shoe->total_cards));
+}
+
+int collect_discards(Shoe* shoe) {
+    if (!shoe->auto_shuffling) {
+        // The round is over, its cards join the discard tray
+        shoe->round_dealt_count = 0;
+        if (shoe->cut_card_reached) {
+            reload_shoe(shoe);
+            shuffle_shoe(shoe);
+            return 1;
+        }
+        return 0;
+    }
+    
+    // Queue this round's cards, then feed back the rounds whose delay is over
+    shoe->pending_cards[shoe->pending_round_count++] = shoe->round_dealt_count;
+    shoe->round_dealt_count = 0;
+    while (shoe->pending_round_count > shoe->return_delay) {
+        return_oldest_discards(shoe);
+    }
+    return 0;
+}
+
+int get_cards_remaining(const Shoe* shoe) {
+    return shoe->auto_shuffling ? shoe->machine_count : shoe->total_cards - shoe->current_index;
+}
+
+// ============================================================================
+// COUNTING OPERATIONS
+// ============================================================================
+// Weights by rank:                      A   2   3   4   5   6   7   8   9  10   J   Q   K
+const CountingSystem HI_LO_COUNT =    {"hi-lo",    {-1,  1,  1,  1,  1,  1,  0,  0,  0, -1, -1, -1, -1}, 0, 0};
+const CountingSystem KO_COUNT =       {"ko",       {-1,  1,  1,  1,  1,  1,  1,  0,  0, -1, -1, -1, -1}, 4, -4};
+const CountingSystem OMEGA_II_COUNT = {"omega-ii", { 0,  1,  1,  2,  2,  2,  1,  0, -1, -2, -2, -2, -2}, 0, 0};
+
+const CountingSystem* find_counting_system(const char* name) {
+    static const CountingSystem* const SYSTEMS[] = {&HI_LO_COUNT, &KO_COUNT, &OMEGA_II_COUNT};
+    for (size_t i = 0; i < sizeof(SYSTEMS) / sizeof(SYSTEMS[0]); i++) {
+        if (strcmp(SYSTEMS[i]->name, name) == 0) {
+            return SYSTEMS[i];
+        }
+    }
+    return NULL;
+}
+
+int add_counting_system(Shoe* shoe, const CountingSystem* system) {
+    if (shoe->counting_system_count >= MAX_COUNTING_SYSTEMS) {
+        return -1;  // No room left
+    }
+    
+    // Weights are copied so draw_card never follows a pointer
+    int idx = shoe->counting_system_count++;
+    int decks = shoe->total_cards / MAX_CARDS_IN_DECK;
+    memcpy(shoe->count_weights[idx], system->weights, sizeof(shoe->count_weights[idx]));
+    shoe->initial_running_counts[idx] = system->initial_count + system->initial_count_per_deck * decks;
+    
+    // Start from the cards already out of the shoe
+    int running = shoe->initial_running_counts[idx];
+    for (int rank = 0; rank < NUM_RANKS; rank++) {
+        running += system->weights[rank] * (NUM_SUITS * decks - shoe->remaining_counts[rank]);
+    }
+    shoe->running_counts[idx] = running;
+    return idx;
+}
+
+int get_running_count(const Shoe* shoe, int system_idx) {
+    return shoe->running_counts[system_idx];
+}
+
+double get_true_count(const Shoe* shoe, int system_idx) {
+    // Running count per deck left in the shoe
+    int remaining = get_cards_remaining(shoe);
+    if (remaining <= 0) {
+        return 0.0;
+    }
+    return (double)shoe->running_counts[system_idx] * MAX_CARDS_IN_DECK / remaining;
+}
+
 // ============================================================================
 // HAND OPERATIONS
 // ============================================================================
 void init_hand(Hand* hand) {
     hand->card_count = 0;
     hand->wager = 0;
+    hand->outcome = 0;
+    hand->flags = 0;
+    hand->payout = 0;
+    hand->hard_total = 0;
+    hand->has_ace = 0;
     memset(hand->cards, 0, sizeof(hand->cards));
 }
 
-void add_card_to_hand(Hand* hand, Card* card) {
+void add_card_to_hand(Hand* hand, Card card) {
     if (hand->card_count < MAX_CARDS_IN_HAND) {
-        hand->cards[hand->card_count] = *card;
+        hand->cards[hand->card_count] = card;
         hand->card_count++;
+        hand->hard_total += RANK_VALUES[CARD_RANK(card)];
+        hand->has_ace |= (CARD_RANK(card) == 0);
     }
 }
 
 void reveal_all_cards(Hand* hand) {
     for (int i = 0; i < hand->card_count; i++) {
-        hand->cards[i].visible = 1;
+        hand->cards[i] |= CARD_VISIBLE_BIT;
     }
 }
 
@@ -201,64 +373,30 @@ int get_hand_score(const Hand* hand) {
     return score_from_hand(hand);
 }
 
+int hand_is_bust(const Hand* hand) {
+    return hand->hard_total > TARGET_SCORE;
+}
+
+int hand_is_soft(const Hand* hand) {
+    return hand->has_ace && hand->hard_total + SOFT_ACE_BONUS <= TARGET_SCORE;
+}
+
+int hand_is_blackjack(const Hand* hand) {
+    return hand->card_count == 2 && hand->has_ace && hand->hard_total == TARGET_SCORE - SOFT_ACE_BONUS &&
+           !(hand->flags & HAND_SPLIT);
+}
+
 // ============================================================================
 // SCORE OPERATIONS
 // ============================================================================
 int score_from_hand(const Hand* hand) {
-    int scores[100];
-    int score_count = 0;
-    scores[0] = 0;
-    score_count = 1;
-    
-    // Calculate all possible scores
-    for (int i = 0; i < hand->card_count; i++) {
-        int values[2];
-        int value_count;
-        get_card_values(&hand->cards[i], values, &value_count);
-        
-        int new_score_count = 0;
-        int new_scores[100];
-        
-        for (int s = 0; s < score_count; s++) {
-            for (int v = 0; v < value_count; v++) {
-                int new_score = scores[s] + values[v];
-                // Add unique scores only
-                int exists = 0;
-                for (int n = 0; n < new_score_count; n++) {
-                    if (new_scores[n] == new_score) {
-                        exists = 1;
-                        break;
-                    }
-                }
-                if (!exists && new_score_count < 100) {
-                    new_scores[new_score_count++] = new_score;
-                }
-            }
-        }
-        
-        for (int n = 0; n < new_score_count && n < 100; n++) {
-            scores[n] = new_scores[n];
-        }
-        score_count = new_score_count;
+    // Best score is the highest total not above 21; at most one ace can
+    // ever count as 11, so the running hard total is all that is needed
+    INSTR_EVENT(INSTR_EVENT_SCORE);
+    if (hand_is_soft(hand)) {
+        return hand->hard_total + SOFT_ACE_BONUS;
     }
-    
-    // Find best score (highest <= 21, or lowest > 21)
-    int best_under = -1;
-    int best_over = 9999;
-    
-    for (int i = 0; i < score_count; i++) {
-        if (scores[i] <= TARGET_SCORE && scores[i] > best_under) {
-            best_under = scores[i];
-        }
-        if (scores[i] > TARGET_SCORE && scores[i] < best_over) {
-            best_over = scores[i];
-        }
-    }
-    
-    if (best_under >= 0) {
-        return best_under;
-    }
-    return best_over;
+    return hand->hard_total;
 }
 
 void compare_hands(const Hand* hand1, const Hand* hand2, int* outcome1, int* outcome2) {
@@ -267,19 +405,19 @@ void compare_hands(const Hand* hand1, const Hand* hand2, int* outcome1, int* out
     
     // Examine hand1
     int score1 = score_from_hand(hand1);
-    if (score1 > TARGET_SCORE) {
+    if (hand_is_bust(hand1)) {
         *outcome1 = BUST;
     }
-    if (score1 == TARGET_SCORE && hand1->card_count == 2) {
+    if (hand_is_blackjack(hand1)) {
         *outcome1 = BLACKJACK;
     }
     
     // Examine hand2
     int score2 = score_from_hand(hand2);
-    if (score2 > TARGET_SCORE) {
+    if (hand_is_bust(hand2)) {
         *outcome2 = BUST;
     }
-    if (score2 == TARGET_SCORE && hand2->card_count == 2) {
+    if (hand_is_blackjack(hand2)) {
         *outcome2 = BLACKJACK;
     }
     
@@ -290,13 +428,13 @@ void compare_hands(const Hand* hand1, const Hand* hand2, int* outcome1, int* out
         return;
     }
     
-    // Resolve one blackjack
+    // Resolve one blackjack - it beats any other hand, a bust stays a bust
     if (*outcome1 == BLACKJACK) {
-        if (*outcome2 < LOOSE) *outcome2 = LOOSE;
+        if (*outcome2 > LOOSE) *outcome2 = LOOSE;
         return;
     }
     if (*outcome2 == BLACKJACK) {
-        if (*outcome1 < LOOSE) *outcome1 = LOOSE;
+        if (*outcome1 > LOOSE) *outcome1 = LOOSE;
         return;
     }
     
@@ -321,7 +459,48 @@ void compare_hands(const Hand* hand1, const Hand* hand2, int* outcome1, int* out
 void init_player(Player* player, const char* name, int chip_count) {
     SAFE_STRCPY(player->name, name, sizeof(player->name));
     player->chip_count = chip_count;
-    init_hand(&player->hand);
+    drop_player_hand(player);
+}
+
+const Hand* get_active_hand(const Player* player) {
+    return &player->hands[player->active_hand];
+}
+
+int get_allowed_actions(const Ruleset* ruleset, const Player* player, char* actions) {
+    // Writes the actions open to the active hand as a string, returns how many
+    const Hand* hand = get_active_hand(player);
+    int split = (hand->flags & HAND_SPLIT) != 0;
+    int first_decision = hand->card_count == 2 && !(hand->flags & HAND_DOUBLED);
+    int covered = player->chip_count >= hand->wager;
+    int count = 0;
+    
+    // A natural stands, it is paid as a blackjack
+    if (hand_is_blackjack(hand)) {
+        actions[count++] = 's';
+        actions[count] = '\0';
+        return count;
+    }
+    
+    // Split aces stand on their second card unless the rules say otherwise
+    int aces_locked = (hand->flags & HAND_SPLIT_ACES) && !ruleset->hit_split_aces;
+    if (!aces_locked) {
+        actions[count++] = 'h';
+    }
+    actions[count++] = 's';
+    if (first_decision && !aces_locked && ruleset->double_down_allowed && covered &&
+        (!split || ruleset->double_after_split)) {
+        actions[count++] = 'd';
+    }
+    if (first_decision && covered && player->hand_count < safe_min(ruleset->max_split_hands, MAX_HANDS_PER_SEAT) &&
+        RANK_VALUES[CARD_RANK(hand->cards[0])] == RANK_VALUES[CARD_RANK(hand->cards[1])] &&
+        (!(hand->flags & HAND_SPLIT_ACES) || ruleset->resplit_aces)) {
+        actions[count++] = 'p';
+    }
+    if (first_decision && !split && ruleset->late_surrender) {
+        actions[count++] = 'r';
+    }
+    actions[count] = '\0';
+    return count;
 }
 
 int bet_chips(Player* player, int chip_count) {
@@ -329,7 +508,7 @@ int bet_chips(Player* player, int chip_count) {
         return 0;  // Not enough chips
     }
     player->chip_count -= chip_count;
-    player->hand.wager = chip_count;
+    player->hands[0].wager = chip_count;
     return 1;
 }
 
@@ -338,7 +517,11 @@ void earn_chips(Player* player, int chip_count) {
 }
 
 void drop_player_hand(Player* player) {
-    init_hand(&player->hand);
+    // Pool hands past the first are reset when a split takes them
+    init_hand(&player->hands[0]);
+    player->hand_count = 1;
+    player->active_hand = 0;
+    player->insurance = 0;
 }
 
 // ============================================================================
@@ -355,11 +538,12 @@ void drop_dealer_hand(Dealer* dealer) {
 // ============================================================================
 // TABLE OPERATIONS
 // ============================================================================
-void init_table(Table* table, const Ruleset* ruleset) {
-    init_shoe(&table->shoe, ruleset->deck_count_in_shoe, ruleset->auto_shuffling_shoe);
+void init_table(Table* table, const Ruleset* ruleset, uint64_t seed) {
+    init_ruleset_shoe(&table->shoe, ruleset, seed);
     init_dealer(&table->dealer);
     table->player_count = 0;
     table->active_player_count = 0;
+    table->round.state = ROUND_IDLE;
 }
 
 // ============================================================================
@@ -368,13 +552,82 @@ void init_table(Table* table, const Ruleset* ruleset) {
 void init_game(Game* game, const Ruleset* ruleset) {
     game->ruleset = *ruleset;
     game->running = 1;
+    game->policy = NULL;
+    game->observer = NULL;
+    init_game_stats(&game->stats);
+}
+
+void init_game_stats(GameStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+}
+
+void merge_game_stats(GameStats* into, const GameStats* from) {
+    into->round_count += from->round_count;
+    into->hand_count += from->hand_count;
+    into->win_count += from->win_count;
+    into->loose_count += from->loose_count;
+    into->push_count += from->push_count;
+    into->blackjack_count += from->blackjack_count;
+    into->bust_count += from->bust_count;
+    into->surrender_count += from->surrender_count;
+    into->double_count += from->double_count;
+    into->split_count += from->split_count;
+    into->insurance_count += from->insurance_count;
+    into->total_wagered += from->total_wagered;
+    into->total_paid += from->total_paid;
+}
+
+void init_round_moments(RoundMoments* moments) {
+    memset(moments, 0, sizeof(*moments));
+}
+
+int get_net_histogram_bin(long long net, int unit) {
+    // Bin b holds nets from (b - 2 * NET_HISTOGRAM_UNITS) / 2 wagers up to
+    // half a wager more; integer floor division, nets are often negative
+    long long halves = 2 * net;
+    long long bin = (halves >= 0 ? halves : halves - unit + 1) / unit + 2 * NET_HISTOGRAM_UNITS;
+    return bin < 0 ? 0 : bin >= NET_HISTOGRAM_BINS ? NET_HISTOGRAM_BINS - 1 : (int)bin;
+}
+
+void add_round_moments(RoundMoments* moments, long long net, long long wagered, int unit) {
+    double n = (double)++moments->round_count;
+    double net_delta = (double)net - moments->net_mean;
+    double wagered_delta = (double)wagered - moments->wagered_mean;
+    moments->net_mean += net_delta / n;
+    moments->wagered_mean += wagered_delta / n;
+    moments->net_m2 += net_delta * ((double)net - moments->net_mean);
+    moments->wagered_m2 += wagered_delta * ((double)wagered - moments->wagered_mean);
+    moments->co_m2 += net_delta * ((double)wagered - moments->wagered_mean);
+    moments->histogram[get_net_histogram_bin(net, unit)]++;
+}
+
+void merge_round_moments(RoundMoments* into, const RoundMoments* from) {
+    if (from->round_count == 0) {
+        return;
+    }
+    double n_into = (double)into->round_count;
+    double n_from = (double)from->round_count;
+    double n = n_into + n_from;
+    double net_delta = from->net_mean - into->net_mean;
+    double wagered_delta = from->wagered_mean - into->wagered_mean;
+    double weight = n_into * n_from / n;
+    
+    into->net_mean += net_delta * n_from / n;
+    into->wagered_mean += wagered_delta * n_from / n;
+    into->net_m2 += from->net_m2 + net_delta * net_delta * weight;
+    into->wagered_m2 += from->wagered_m2 + wagered_delta * wagered_delta * weight;
+    into->co_m2 += from->co_m2 + net_delta * wagered_delta * weight;
+    into->round_count += from->round_count;
+    for (int bin = 0; bin < NET_HISTOGRAM_BINS; bin++) {
+        into->histogram[bin] += from->histogram[bin];
+    }
 }
 
 void run_game(Game* game, Table* table) {
     game->running = 1;
     
     while (game->running) {
-        print_colored("Starting new round...\n", "grey");
+        print_colored(VERBOSITY_PLAY, COLOR_GREY, "Starting new round...\n");
         
         // Check if anyone has chips
         int any_chips = 0;
@@ -386,258 +639,422 @@ void run_game(Game* game, Table* table) {
         }
         
         if (!any_chips) {
-            print_colored("Everyone is broke here! Bye-bye.\n", "grey");
+            print_colored(VERBOSITY_RESULTS, COLOR_GREY, "Everyone is broke here! Bye-bye.\n");
             break;
         }
         
         int player_count = play_new_round(game, table);
         if (player_count == 0) {
-            print_colored("No one wants to play anymore? Let's stop the game.\n", "grey");
+            print_colored(VERBOSITY_RESULTS, COLOR_GREY,
+                    "No one wants to play anymore? Let's stop the game.\n");
             break;
         }
     }
+    flush_output();
 }
 
-int play_new_round(Game* game, Table* table) {
-    int active_count = collect_wagers(game, table);
-    if (active_count == 0) {
-        return 0;
+static void build_action_prompt(const char* actions, char* prompt, size_t prompt_size) {
+    // "[h]it, [s]tand or [d]ouble?" for the actions given
+    int length = 0;
+    for (int i = 0; actions[i]; i++) {
+        const char* label = actions[i] == 'h' ? "[h]it" : actions[i] == 's' ? "[s]tand" :
+                            actions[i] == 'd' ? "[d]ouble" : actions[i] == 'p' ? "s[p]lit" : "su[r]render";
+        const char* separator = i == 0 ? "" : actions[i + 1] ? ", " : " or ";
+        length += snprintf(prompt + length, prompt_size - (size_t)length, "%s%s", separator, label);
     }
-    
-    deal_initial_cards(game, table);
-    
-    for (int i = 0; i < table->active_player_count; i++) {
-        int player_idx = table->active_player_indices[i];
-        interact_with_player(game, table, player_idx);
+    snprintf(prompt + length, prompt_size - (size_t)length, "?");
+}
+
+static int ask_wager(Game* game, Table* table, int player_idx) {
+    Player* player = &table->players[player_idx];
+    display_player(player);
+    if (game->policy) {
+        return game->policy->choose_wager(game->policy->context, game, table, player_idx);
     }
     
-    interact_with_dealer(game, table);
-    pay_gains(game, table);
-    cleanup_table(table);
-    
-    return active_count;
+    while (1) {
+        int chip_count = ask_integer(
+            "How much would you like to bet for that round?",
+            game->ruleset.minimum_wager,
+            0,
+            player->chip_count
+        );
+        
+        if (chip_count != 0 && chip_count < game->ruleset.minimum_wager) {
+            print_formatted(VERBOSITY_SILENT, COLOR_GREY, "Minimum bet is %d\n",
+                    game->ruleset.minimum_wager);
+            continue;
+        }
+        
+        if (chip_count > player->chip_count) {
+            print_colored(VERBOSITY_SILENT, COLOR_GREY,
+                    "You do not have enough chips! Please lower your bet.\n");
+            continue;
+        }
+        return chip_count;
+    }
 }
 
-int collect_wagers(Game* game, Table* table) {
-    print_colored("Collecting wagers...\n", "grey");
-    table->active_player_count = 0;
+static int ask_insurance(Game* game, Table* table, int player_idx) {
+    Player* player = &table->players[player_idx];
+    if (game->policy) {
+        return game->policy->choose_insurance &&
+               game->policy->choose_insurance(game->policy->context, game, table, player_idx);
+    }
+    display_player(player);
+    return ask_choice(hand_is_blackjack(&player->hands[0]) ? "Take even money?" : "Take insurance?",
+                      "yn", 'n') == 'y';
+}
+
+static char ask_action(Game* game, Table* table, int player_idx) {
+    if (game->policy) {
+        return game->policy->choose_action(game->policy->context, game, table, player_idx);
+    }
+    char actions[8];
+    char prompt[MAX_STRING_LEN];
+    get_allowed_actions(&game->ruleset, &table->players[player_idx], actions);
+    build_action_prompt(actions, prompt, sizeof(prompt));
+    return ask_choice(prompt, actions, 'h');
+}
+
+int play_new_round(Game* game, Table* table) {
+    // Drives the round state machine to the end, answering each input from
+    // the policy or the console as soon as the round asks for it
+    Round* round = &table->round;
+    start_round(game, table, (1u << table->player_count) - 1);
     
-    for (int i = 0; i < table->player_count; i++) {
-        Player* player = &table->players[i];
-        display_player(player);
+    while (round->state != ROUND_IDLE && round->state != ROUND_SETTLED) {
+        if (round->state == ROUND_DECISION) {
+            submit_action(game, table, ask_action(game, table, get_round_player(table)));
+            continue;
+        }
         
-        while (1) {
-            int chip_count = ask_integer(
-                "How much would you like to bet for that round?",
-                game->ruleset.minimum_wager,
-                0,
-                player->chip_count
-            );
-            
-            if (chip_count == 0) {
-                char msg[MAX_STRING_LEN];
-                snprintf(msg, sizeof(msg), "Player \"%s\" not playing this round.\n", player->name);
-                print_colored(msg, "grey");
-                break;
-            }
-            
-            if (chip_count < game->ruleset.minimum_wager) {
-                char msg[MAX_STRING_LEN];
-                snprintf(msg, sizeof(msg), "Minimum bet is %d\n", game->ruleset.minimum_wager);
-                print_colored(msg, "grey");
+        // Wagers and insurance are asked in seat order
+        for (int i = 0; i < table->player_count; i++) {
+            if (!round_awaits_player(table, i)) {
                 continue;
             }
-            
-            if (chip_count > player->chip_count) {
-                print_colored("You do not have enough chips! Please lower your bet.\n", "grey");
-                continue;
+            if (round->state == ROUND_WAGERS) {
+                submit_wager(game, table, i, ask_wager(game, table, i));
+            } else {
+                submit_insurance(game, table, i, ask_insurance(game, table, i));
             }
-            
-            init_hand(&player->hand);
-            bet_chips(player, chip_count);
-            table->active_player_indices[table->active_player_count++] = i;
             break;
         }
     }
     
-    if (table->active_player_count > 0) {
-        init_hand(&table->dealer.hand);
-    }
-    
-    return table->active_player_count;
+    int active_count = table->active_player_count;
+    end_round(game, table);
+    return active_count;
 }
 
-void deal_initial_cards(Game* game, Table* table) {
-    print_colored("Dealing initial two cards...\n", "grey");
-    
-    if (!game->ruleset.auto_shuffling_shoe) {
-        shuffle_shoe(&table->shoe);
-    }
+void deal_starting_hands(Game* game, Table* table) {
+    print_colored(VERBOSITY_PLAY, COLOR_GREY, "Dealing initial two cards...\n");
     
     // First round - one card to each player and dealer
     for (int i = 0; i < table->active_player_count; i++) {
         int player_idx = table->active_player_indices[i];
-        Card* card = draw_card(&table->shoe, 1);
-        add_card_to_hand(&table->players[player_idx].hand, card);
+        Card card = draw_card(&table->shoe, 1);
+        add_card_to_hand(&table->players[player_idx].hands[0], card);
     }
-    Card* dealer_card = draw_card(&table->shoe, 1);
+    Card dealer_card = draw_card(&table->shoe, 1);
     add_card_to_hand(&table->dealer.hand, dealer_card);
     
     // Second round - second card to each player
     for (int i = 0; i < table->active_player_count; i++) {
         int player_idx = table->active_player_indices[i];
-        Card* card = draw_card(&table->shoe, 1);
-        add_card_to_hand(&table->players[player_idx].hand, card);
+        Card card = draw_card(&table->shoe, 1);
+        add_card_to_hand(&table->players[player_idx].hands[0], card);
         display_player(&table->players[player_idx]);
     }
     
-    // Dealer's hole card
     if (game->ruleset.dealer_receives_hole_card) {
-        Card* hole_card = draw_card(&table->shoe, 0);
+        Card hole_card = draw_card(&table->shoe, 0);
         add_card_to_hand(&table->dealer.hand, hole_card);
-        
-        if (game->ruleset.dealer_reveals_blackjack_hand) {
-            if (get_hand_score(&table->dealer.hand) == TARGET_SCORE) {
-                reveal_all_cards(&table->dealer.hand);
-            }
-        }
     }
-    
     display_dealer(&table->dealer);
 }
 
-void interact_with_player(Game* game, Table* table, int player_idx) {
+void peek_dealer_hand(Game* game, Table* table) {
+    if (dealer_has_revealed_blackjack(game, table)) {
+        reveal_all_cards(&table->dealer.hand);
+        print_colored(VERBOSITY_PLAY, COLOR_RED, "Dealer has Blackjack!\n");
+        display_dealer(&table->dealer);
+    }
+}
+
+int get_insurance_amount(const Game* game, const Table* table, int player_idx) {
+    // Half the wager against a dealer blackjack, paid 2 to 1; for a
+    // blackjack hand this is even money. 0 when it cannot be taken.
+    const Player* player = &table->players[player_idx];
+    int amount = player->hands[0].wager / 2;
+    if (!game->ruleset.insurance_offered || !game->ruleset.dealer_receives_hole_card ||
+        CARD_RANK(table->dealer.hand.cards[0]) != 0 || player->insurance > 0 ||
+        amount > player->chip_count) {
+        return 0;
+    }
+    return amount;
+}
+
+void take_insurance(Game* game, Table* table, int player_idx) {
     Player* player = &table->players[player_idx];
-    char msg[MAX_STRING_LEN * 2];
+    int amount = get_insurance_amount(game, table, player_idx);
+    if (amount == 0) {
+        return;
+    }
+    
+    player->chip_count -= amount;
+    player->insurance = amount;
+    game->stats.insurance_count++;
+    if (game->observer) {
+        game->observer->on_action(game->observer->context, game, table, player_idx, 'i');
+    }
+    print_formatted(VERBOSITY_PLAY, COLOR_GREY, "Player \"%s\" takes insurance for %d chips.\n",
+            player->name, amount);
+}
+
+int dealer_has_revealed_blackjack(const Game* game, const Table* table) {
+    return game->ruleset.dealer_receives_hole_card && game->ruleset.dealer_reveals_blackjack_hand &&
+           hand_is_blackjack(&table->dealer.hand);
+}
+
+static void split_player_hand(Game* game, Player* player) {
+    // The second card moves to the next hand of the pool, with an equal wager
+    Hand* hand = &player->hands[player->active_hand];
+    Hand* split = &player->hands[player->hand_count++];
+    Card kept = hand->cards[0];
+    Card moved = hand->cards[1];
+    int wager = hand->wager;
+    uint8_t flags = HAND_SPLIT | (CARD_RANK(kept) == 0 ? HAND_SPLIT_ACES : 0);
+    
+    init_hand(hand);
+    add_card_to_hand(hand, kept);
+    init_hand(split);
+    add_card_to_hand(split, moved);
+    hand->wager = split->wager = wager;
+    hand->flags = split->flags = flags;
+    player->chip_count -= wager;
+    game->stats.split_count++;
+}
+
+int advance_player_hand(Game* game, Table* table, int player_idx) {
+    // Brings the active hand to its next decision; 0 once it is over
+    Player* player = &table->players[player_idx];
+    Hand* hand = &player->hands[player->active_hand];
     
-    (void)game;  // Suppress unused parameter warning
-    snprintf(msg, sizeof(msg), "Interacting with player \"%s\"...\n", player->name);
-    print_colored(msg, "grey");
+    // A split hand draws its second card when its turn comes
+    if (hand->card_count < 2) {
+        Card card = draw_card(&table->shoe, 1);
+        add_card_to_hand(hand, card);
+        print_formatted(VERBOSITY_PLAY, COLOR_GREY, "Split hand %d received a \"%s\".\n",
+                player->active_hand + 1, card_name(card));
+    }
+    display_player(player);
     
-    while (1) {
-        display_player(player);
-        
-        int score = get_hand_score(&player->hand);
-        if (score > TARGET_SCORE) {
-            snprintf(msg, sizeof(msg), "Player's hand has gone bust with %d points!\n", score);
-            print_colored(msg, "red");
-            break;
+    if (hand_is_bust(hand)) {
+        print_formatted(VERBOSITY_PLAY, COLOR_RED, "Player's hand has gone bust with %d points!\n",
+                get_hand_score(hand));
+        return 0;
+    }
+    if (hand->flags & HAND_DOUBLED) {
+        return 0;   // One card only after doubling
+    }
+    if (hand_is_blackjack(hand)) {
+        print_colored(VERBOSITY_PLAY, COLOR_GREEN, "Player has Blackjack!\n");
+        return 0;
+    }
+    
+    char actions[8];
+    get_allowed_actions(&game->ruleset, player, actions);
+    if (strcmp(actions, "s") == 0) {
+        print_colored(VERBOSITY_PLAY, COLOR_GREY, "Player stands on split aces.\n");
+        return 0;
+    }
+    return 1;
+}
+
+int apply_player_action(Game* game, Table* table, int player_idx, char choice) {
+    // Plays one decision on the active hand; 0 once the hand is over
+    Player* player = &table->players[player_idx];
+    Hand* hand = &player->hands[player->active_hand];
+    
+    char actions[8];
+    get_allowed_actions(&game->ruleset, player, actions);
+    if (choice == '\0' || !strchr(actions, choice)) {
+        choice = (choice == 'd' || choice == 'r') && strchr(actions, 'h') ? 'h' : 's';
+    }
+    if (game->observer) {
+        game->observer->on_action(game->observer->context, game, table, player_idx, choice);
+    }
+    
+    if (choice == 'h' || choice == 'd') {
+        if (choice == 'd') {
+            player->chip_count -= hand->wager;
+            hand->wager *= 2;
+            hand->flags |= HAND_DOUBLED;
+            game->stats.double_count++;
         }
+        Card card = draw_card(&table->shoe, 1);
+        add_card_to_hand(hand, card);
         
-        char choice = ask_choice("[h]it or [s]tand?", "hs", 'h');
-        
-        if (choice == 'h') {
-            Card* card = draw_card(&table->shoe, 1);
-            add_card_to_hand(&player->hand, card);
-            
-            char card_name[MAX_STRING_LEN];
-            get_card_name(card, card_name, sizeof(card_name));
-            snprintf(msg, sizeof(msg), "Player hit and received a \"%s\".\n", card_name);
-            print_colored(msg, "grey");
-        } else if (choice == 's') {
-            print_colored("Player stands.\n", "grey");
-            break;
-        }
+        print_formatted(VERBOSITY_PLAY, COLOR_GREY, "Player %s and received a \"%s\".\n",
+                choice == 'd' ? "doubled down" : "hit", card_name(card));
+        return 1;
+    }
+    if (choice == 'p') {
+        split_player_hand(game, player);
+        print_formatted(VERBOSITY_PLAY, COLOR_GREY, "Player splits into %d hands.\n", player->hand_count);
+        return 1;
     }
+    if (choice == 'r') {
+        hand->flags |= HAND_SURRENDERED;
+        print_colored(VERBOSITY_PLAY, COLOR_GREY, "Player surrenders.\n");
+        return 0;
+    }
+    print_colored(VERBOSITY_PLAY, COLOR_GREY, "Player stands.\n");
+    return 0;
 }
 
 void interact_with_dealer(Game* game, Table* table) {
-    print_colored("Interacting with dealer...\n", "grey");
+    print_colored(VERBOSITY_PLAY, COLOR_GREY, "Interacting with dealer...\n");
     
     if (!game->ruleset.dealer_receives_hole_card) {
-        Card* card = draw_card(&table->shoe, 1);
+        Card card = draw_card(&table->shoe, 1);
         add_card_to_hand(&table->dealer.hand, card);
     }
     
     reveal_all_cards(&table->dealer.hand);
     display_dealer(&table->dealer);
     
-    char msg[MAX_STRING_LEN * 2];
     while (1) {
         int score = get_hand_score(&table->dealer.hand);
         
         if (score > TARGET_SCORE) {
-            snprintf(msg, sizeof(msg), "Dealer has gone bust with %d points\n", score);
-            print_colored(msg, "red");
+            print_formatted(VERBOSITY_PLAY, COLOR_RED, "Dealer has gone bust with %d points\n", score);
             break;
         }
         
         if (score >= MINIMUM_DEALER_SCORE) {
-            print_colored("Dealer stands.\n", "grey");
+            print_colored(VERBOSITY_PLAY, COLOR_GREY, "Dealer stands.\n");
             break;
         }
         
-        Card* card = draw_card(&table->shoe, 1);
+        Card card = draw_card(&table->shoe, 1);
         add_card_to_hand(&table->dealer.hand, card);
         
-        char card_name[MAX_STRING_LEN];
-        get_card_name(card, card_name, sizeof(card_name));
-        snprintf(msg, sizeof(msg), "Dealer hit and received a \"%s\".\n", card_name);
-        print_colored(msg, "grey");
+        print_formatted(VERBOSITY_PLAY, COLOR_GREY, "Dealer hit and received a \"%s\".\n",
+                card_name(card));
         display_dealer(&table->dealer);
     }
 }
 
+static void settle_hand(Game* game, const Hand* dealer_hand, Player* player, int hand_idx) {
+    Hand* hand = &player->hands[hand_idx];
+    char name[MAX_NAME_LEN + 16];
+    if (player->hand_count > 1) {
+        snprintf(name, sizeof(name), "%s, hand %d", player->name, hand_idx + 1);
+    } else {
+        SAFE_STRCPY(name, player->name, sizeof(name));
+    }
+    
+    int outcome_player, outcome_dealer;
+    compare_hands(hand, dealer_hand, &outcome_player, &outcome_dealer);
+    // Surrender is late: without a peek a dealer blackjack shows up only
+    // now, and then the surrendered hand loses its whole wager
+    if ((hand->flags & HAND_SURRENDERED) && !hand_is_blackjack(dealer_hand)) {
+        outcome_player = SURRENDER;
+    }
+    
+    int chip_payout = 0;
+    int player_score = get_hand_score(hand);
+    
+    if (outcome_player == BUST) {
+        print_formatted(VERBOSITY_RESULTS, COLOR_RED, "Player \"%s\" busted with %d points.\n",
+                name, player_score);
+        chip_payout = 0;
+        game->stats.bust_count++;
+    }
+    else if (outcome_player == LOOSE) {
+        print_formatted(VERBOSITY_RESULTS, COLOR_RED,
+                "Player \"%s\" loses with %d points on %d cards.\n",
+                name, player_score, hand->card_count);
+        chip_payout = 0;
+        game->stats.loose_count++;
+    }
+    else if (outcome_player == PUSH) {
+        print_formatted(VERBOSITY_RESULTS, COLOR_YELLOW,
+                "Player \"%s\" is on tie with %d points on %d cards and gets his wager back.\n",
+                name, player_score, hand->card_count);
+        chip_payout = hand->wager;
+        game->stats.push_count++;
+    }
+    else if (outcome_player == WIN) {
+        chip_payout = hand->wager;
+        print_formatted(VERBOSITY_RESULTS, COLOR_GREEN,
+                "Player \"%s\" wins with %d points on %d cards and earns %d more chips.\n",
+                name, player_score, hand->card_count, chip_payout);
+        chip_payout += hand->wager;
+        game->stats.win_count++;
+    }
+    else if (outcome_player == BLACKJACK) {
+        chip_payout = get_blackjack_payout(&game->ruleset, hand->wager);
+        print_formatted(VERBOSITY_RESULTS, COLOR_GREEN,
+                "Player \"%s\" does Blackjack and earns %d more chips\n",
+                name, chip_payout);
+        chip_payout += hand->wager;
+        game->stats.blackjack_count++;
+    }
+    else if (outcome_player == SURRENDER) {
+        chip_payout = hand->wager / 2;
+        print_formatted(VERBOSITY_RESULTS, COLOR_YELLOW,
+                "Player \"%s\" surrendered and gets %d chips back.\n",
+                name, chip_payout);
+        game->stats.surrender_count++;
+    }
+    
+    hand->outcome = (uint8_t)outcome_player;
+    hand->payout = chip_payout;
+    game->stats.hand_count++;
+    game->stats.total_wagered += hand->wager;
+    game->stats.total_paid += chip_payout;
+    earn_chips(player, chip_payout);
+}
+
 void pay_gains(Game* game, Table* table) {
-    print_colored("Paying gains...\n", "grey");
+    print_colored(VERBOSITY_PLAY, COLOR_GREY, "Paying gains...\n");
     
-    char msg[MAX_STRING_LEN * 2];
-    int dealer_score = get_hand_score(&table->dealer.hand);
-    snprintf(msg, sizeof(msg), "Dealer has %d points with %d cards.\n",
-            dealer_score, table->dealer.hand.card_count);
-    print_colored(msg, "white");
+    const Hand* dealer_hand = &table->dealer.hand;
+    int dealer_score = get_hand_score(dealer_hand);
+    print_formatted(VERBOSITY_RESULTS, COLOR_WHITE, "Dealer has %d points with %d cards.\n",
+            dealer_score, dealer_hand->card_count);
     
     for (int i = 0; i < table->active_player_count; i++) {
         int player_idx = table->active_player_indices[i];
         Player* player = &table->players[player_idx];
         
-        int outcome_player, outcome_dealer;
-        compare_hands(&player->hand, &table->dealer.hand, &outcome_player, &outcome_dealer);
-        
-        int chip_payout = 0;
-        int player_score = get_hand_score(&player->hand);
-        
-        if (outcome_player == BUST) {
-            snprintf(msg, sizeof(msg), "Player \"%s\" busted with %d points.\n",
-                    player->name, player_score);
-            print_colored(msg, "red");
-            chip_payout = 0;
-        }
-        else if (outcome_player == LOOSE) {
-            snprintf(msg, sizeof(msg), "Player \"%s\" loses with %d points on %d cards.\n",
-                    player->name, player_score, player->hand.card_count);
-            print_colored(msg, "red");
-            chip_payout = 0;
-        }
-        else if (outcome_player == PUSH) {
-            snprintf(msg, sizeof(msg), 
-                    "Player \"%s\" is on tie with %d points on %d cards and gets his wager back.\n",
-                    player->name, player_score, player->hand.card_count);
-            print_colored(msg, "yellow");
-            chip_payout = player->hand.wager;
-        }
-        else if (outcome_player == WIN) {
-            chip_payout = player->hand.wager;
-            snprintf(msg, sizeof(msg), 
-                    "Player \"%s\" wins with %d points on %d cards and earns %d more chips.\n",
-                    player->name, player_score, player->hand.card_count, chip_payout);
-            print_colored(msg, "green");
-            chip_payout += player->hand.wager;
-        }
-        else if (outcome_player == BLACKJACK) {
-            chip_payout = (int)(player->hand.wager * game->ruleset.blackjack_payout_ratio);
-            snprintf(msg, sizeof(msg), "Player \"%s\" does Blackjack and earns %d more chips\n",
-                    player->name, chip_payout);
-            print_colored(msg, "green");
-            chip_payout += player->hand.wager;
+        if (player->insurance > 0) {
+            int insurance_payout = hand_is_blackjack(dealer_hand) ? 3 * player->insurance : 0;
+            if (insurance_payout > 0) {
+                print_formatted(VERBOSITY_RESULTS, COLOR_GREEN,
+                        "Player \"%s\" wins the insurance and earns %d more chips.\n",
+                        player->name, insurance_payout - player->insurance);
+            } else {
+                print_formatted(VERBOSITY_RESULTS, COLOR_RED, "Player \"%s\" loses the insurance.\n",
+                        player->name);
+            }
+            game->stats.total_wagered += player->insurance;
+            game->stats.total_paid += insurance_payout;
+            earn_chips(player, insurance_payout);
         }
         
-        earn_chips(player, chip_payout);
+        for (int h = 0; h < player->hand_count; h++) {
+            settle_hand(game, dealer_hand, player, h);
+        }
     }
 }
 
 void cleanup_table(Table* table) {
-    print_colored("Cleaning table...\n", "grey");
+    print_colored(VERBOSITY_PLAY, COLOR_GREY, "Cleaning table...\n");
     
     for (int i = 0; i < table->active_player_count; i++) {
         int player_idx = table->active_player_indices[i];
@@ -645,85 +1062,419 @@ void cleanup_table(Table* table) {
     }
     
     drop_dealer_hand(&table->dealer);
-    reload_shoe(&table->shoe);
+    if (collect_discards(&table->shoe)) {
+        print_colored(VERBOSITY_PLAY, COLOR_GREY, "Cut card is out, shuffling the shoe...\n");
+    }
+    table->active_player_count = 0;
+}
+
+// ============================================================================
+// ROUND OPERATIONS
+// ============================================================================
+static int collect_wagers(Game* game, Table* table) {
+    // Wagers are taken in seat order once every seat has answered
+    Round* round = &table->round;
+    table->active_player_count = 0;
+    for (int i = 0; i < table->player_count; i++) {
+        if (round->answers[i] > 0) {
+            drop_player_hand(&table->players[i]);
+            bet_chips(&table->players[i], round->answers[i]);
+            table->active_player_indices[table->active_player_count++] = i;
+        }
+    }
+    
+    if (table->active_player_count > 0) {
+        init_hand(&table->dealer.hand);
+    }
+    return table->active_player_count;
+}
+
+static void deal_initial_cards(Game* game, Table* table) {
+    Round* round = &table->round;
+    INSTR_PHASE_BEGIN(deal);
+    deal_starting_hands(game, table);
+    INSTR_PHASE_END(deal, INSTR_PHASE_DEAL_INITIAL_CARDS);
+    
+    // Insurance is offered to every eligible seat at once
+    round->state = ROUND_INSURANCE;
+    round->pending_count = 0;
+    for (int i = 0; i < table->player_count; i++) {
+        round->answers[i] = 0;
+    }
+    for (int i = 0; i < table->active_player_count; i++) {
+        int player_idx = table->active_player_indices[i];
+        if (get_insurance_amount(game, table, player_idx) > 0) {
+            round->answers[player_idx] = ROUND_AWAITED;
+            round->pending_count++;
+        }
+    }
+}
+
+static void begin_player_turn(Table* table) {
+    Round* round = &table->round;
+    Player* player = &table->players[table->active_player_indices[round->turn]];
+    print_formatted(VERBOSITY_PLAY, COLOR_GREY, "Interacting with player \"%s\"...\n", player->name);
+    player->active_hand = 0;
+#ifdef UNIJACK_INSTRUMENT
+    round->wait_ticks = instr_ticks();
+#endif
+}
+
+static int play_to_next_decision(Game* game, Table* table) {
+    // Plays hands until one needs a decision; 0 once every seat is done
+    Round* round = &table->round;
+    while (round->turn < table->active_player_count) {
+        int player_idx = table->active_player_indices[round->turn];
+        Player* player = &table->players[player_idx];
+        
+        // Splits append to the pool, so hand by hand reaches them too
+        if (player->active_hand >= player->hand_count) {
+            player->active_hand = 0;
+#ifdef UNIJACK_INSTRUMENT
+            instr_record_phase(INSTR_PHASE_INTERACT_WITH_PLAYER, round->wait_ticks);
+#endif
+            if (++round->turn < table->active_player_count) {
+                begin_player_turn(table);
+            }
+            continue;
+        }
+        if (advance_player_hand(game, table, player_idx)) {
+            return 1;
+        }
+        player->active_hand++;
+    }
+    return 0;
+}
+
+static void settle_round(Game* game, Table* table) {
+    INSTR_PHASE_BEGIN(dealer);
+    interact_with_dealer(game, table);
+    INSTR_PHASE_END(dealer, INSTR_PHASE_INTERACT_WITH_DEALER);
+    INSTR_PHASE_BEGIN(pay);
+    pay_gains(game, table);
+    INSTR_PHASE_END(pay, INSTR_PHASE_PAY_GAINS);
+    if (game->observer) {
+        game->observer->on_round_settled(game->observer->context, game, table);
+    }
+    table->round.state = ROUND_SETTLED;
+}
+
+static void resume_round(Game* game, Table* table) {
+    // Runs the round from its last input up to the next one it needs
+    Round* round = &table->round;
+    if (round->pending_count > 0) {
+        return;
+    }
+    
+    if (round->state == ROUND_WAGERS) {
+#ifdef UNIJACK_INSTRUMENT
+        instr_record_phase(INSTR_PHASE_COLLECT_WAGERS, round->wait_ticks);
+#endif
+        if (collect_wagers(game, table) == 0) {
+            round->state = ROUND_IDLE;
+            return;
+        }
+        deal_initial_cards(game, table);
+        if (round->pending_count > 0) {
+            return;
+        }
+    }
+    
+    if (round->state == ROUND_INSURANCE) {
+        // Dealer's hole card is checked for blackjack once insurance is settled,
+        // and once it has shown there is nothing left to decide
+        peek_dealer_hand(game, table);
+        if (dealer_has_revealed_blackjack(game, table)) {
+            settle_round(game, table);
+            return;
+        }
+        round->state = ROUND_DECISION;
+        round->turn = 0;
+        begin_player_turn(table);
+    }
+    
+    if (round->state == ROUND_DECISION && !play_to_next_decision(game, table)) {
+        settle_round(game, table);
+    }
+}
+
+void start_round(Game* game, Table* table, uint32_t seat_mask) {
+    // Asks a wager of every seat in the mask, bit i for players[i]
+    Round* round = &table->round;
+    print_colored(VERBOSITY_PLAY, COLOR_GREY, "Collecting wagers...\n");
+#ifdef UNIJACK_INSTRUMENT
+    round->start_ticks = round->wait_ticks = instr_ticks();
+#endif
+    
+    round->state = ROUND_WAGERS;
+    round->pending_count = 0;
     table->active_player_count = 0;
+    for (int i = 0; i < table->player_count; i++) {
+        int asked = (seat_mask >> i) & 1;
+        round->answers[i] = asked ? ROUND_AWAITED : 0;
+        round->pending_count += asked;
+    }
+    resume_round(game, table);
+}
+
+int round_awaits_player(const Table* table, int player_idx) {
+    const Round* round = &table->round;
+    if (round->state == ROUND_DECISION) {
+        return get_round_player(table) == player_idx;
+    }
+    return (round->state == ROUND_WAGERS || round->state == ROUND_INSURANCE) &&
+           round->answers[player_idx] == ROUND_AWAITED;
+}
+
+int get_round_player(const Table* table) {
+    // Seat whose turn it is, -1 outside of decisions
+    const Round* round = &table->round;
+    return round->state == ROUND_DECISION ? table->active_player_indices[round->turn] : -1;
+}
+
+void submit_wager(Game* game, Table* table, int player_idx, int chip_count) {
+    // A wager the player cannot make sits the player out
+    Round* round = &table->round;
+    Player* player = &table->players[player_idx];
+    if (round->state != ROUND_WAGERS || !round_awaits_player(table, player_idx)) {
+        return;
+    }
+    if (chip_count < game->ruleset.minimum_wager || chip_count > player->chip_count) {
+        chip_count = 0;
+    }
+    if (chip_count == 0) {
+        print_formatted(VERBOSITY_PLAY, COLOR_GREY, "Player \"%s\" not playing this round.\n",
+                player->name);
+    }
+    
+    round->answers[player_idx] = chip_count;
+    round->pending_count--;
+    resume_round(game, table);
+}
+
+void submit_insurance(Game* game, Table* table, int player_idx, int take) {
+    Round* round = &table->round;
+    if (round->state != ROUND_INSURANCE || !round_awaits_player(table, player_idx)) {
+        return;
+    }
+    if (take) {
+        take_insurance(game, table, player_idx);
+    }
+    
+    round->answers[player_idx] = 0;
+    round->pending_count--;
+    resume_round(game, table);
+}
+
+void submit_action(Game* game, Table* table, char choice) {
+    // Decides for the active hand of the seat whose turn it is
+    if (table->round.state != ROUND_DECISION) {
+        return;
+    }
+    int player_idx = get_round_player(table);
+    if (!apply_player_action(game, table, player_idx, choice)) {
+        table->players[player_idx].active_hand++;
+    }
+    resume_round(game, table);
+}
+
+void end_round(Game* game, Table* table) {
+    // Clears a settled round off the table; a round nobody joined just ends
+    Round* round = &table->round;
+    if (round->state == ROUND_SETTLED) {
+        INSTR_PHASE_BEGIN(cleanup);
+        cleanup_table(table);
+        INSTR_PHASE_END(cleanup, INSTR_PHASE_CLEANUP_TABLE);
+        game->stats.round_count++;
+#ifdef UNIJACK_INSTRUMENT
+        instr_record_phase(INSTR_PHASE_ROUND, round->start_ticks);
+#endif
+    }
+    round->state = ROUND_IDLE;
+    flush_output();
 }
 
 // ============================================================================
 // UI OPERATIONS
 // ============================================================================
-void print_colored(const char* msg, const char* color) {
+static int g_verbosity = VERBOSITY_FULL;
+static int g_use_ansi = -1;     // Decided on first output
+
+// Messages of a round collect here and go out in one write
+static THREAD_LOCAL char g_output_buffer[OUTPUT_BUFFER_SIZE];
+static THREAD_LOCAL int g_output_length = 0;
+static THREAD_LOCAL Color g_output_color = COLOR_DEFAULT;
+
+static const char* const ANSI_COLOR_CODES[COLOR_COUNT] = {
+    "\033[0m",     // COLOR_DEFAULT
+    "\033[37m",    // COLOR_GREY
+    "\033[97m",    // COLOR_WHITE
+    "\033[91m",    // COLOR_RED
+    "\033[92m",    // COLOR_GREEN
+    "\033[93m",    // COLOR_YELLOW
+    "\033[96m",    // COLOR_CYAN
+};
+
 #ifndef UNIVAC
-    HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-    WORD color_attr = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE;
-    
-    if (strcmp(color, "red") == 0) {
-        color_attr = FOREGROUND_RED | FOREGROUND_INTENSITY;
-    } else if (strcmp(color, "green") == 0) {
-        color_attr = FOREGROUND_GREEN | FOREGROUND_INTENSITY;
-    } else if (strcmp(color, "yellow") == 0) {
-        color_attr = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_INTENSITY;
-    } else if (strcmp(color, "cyan") == 0) {
-        color_attr = FOREGROUND_GREEN | FOREGROUND_BLUE | FOREGROUND_INTENSITY;
-    } else if (strcmp(color, "white") == 0) {
-        color_attr = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE | FOREGROUND_INTENSITY;
-    } else if (strcmp(color, "grey") == 0) {
-        color_attr = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE;
-    }
-    
-    SetConsoleTextAttribute(hConsole, color_attr);
-    printf("%s", msg);
-    SetConsoleTextAttribute(hConsole, FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE);
+static const WORD CONSOLE_COLOR_ATTRIBUTES[COLOR_COUNT] = {
+    FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE,
+    FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE,
+    FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE | FOREGROUND_INTENSITY,
+    FOREGROUND_RED | FOREGROUND_INTENSITY,
+    FOREGROUND_GREEN | FOREGROUND_INTENSITY,
+    FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_INTENSITY,
+    FOREGROUND_GREEN | FOREGROUND_BLUE | FOREGROUND_INTENSITY,
+};
+#endif
+
+void set_verbosity(int verbosity) {
+    g_verbosity = verbosity;
+}
+
+int get_verbosity(void) {
+    return g_verbosity;
+}
+
+int is_output_enabled(int level) {
+    return level <= g_verbosity;
+}
+
+static int use_ansi_colors(void) {
+    // Escape sequences only go to terminals, never into redirected logs
+    if (g_use_ansi < 0) {
+#ifdef UNIVAC
+        g_use_ansi = isatty(fileno(stdout));
 #else
-    (void)color;  // Suppress unused parameter warning
-    printf("%s", msg);
+        DWORD mode = 0;
+        HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+        g_use_ansi = GetConsoleMode(console, &mode) && (mode & ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+#endif
+    }
+    return g_use_ansi;
+}
+
+static void write_output_buffer(void) {
+    fwrite(g_output_buffer, 1, (size_t)g_output_length, stdout);
+    g_output_length = 0;
+}
+
+static void switch_output_color(Color color) {
+    if (color == g_output_color) {
+        return;
+    }
+#ifndef UNIVAC
+    if (!use_ansi_colors()) {
+        // Legacy consoles take colors as attributes, set between writes
+        write_output_buffer();
+        fflush(stdout);
+        SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), CONSOLE_COLOR_ATTRIBUTES[color]);
+        g_output_color = color;
+        return;
+    }
 #endif
+    if (use_ansi_colors()) {
+        output_text(ANSI_COLOR_CODES[color], (int)strlen(ANSI_COLOR_CODES[color]));
+    }
+    g_output_color = color;
+}
+
+void output_text(const char* text, int length) {
+    if (g_output_length + length > OUTPUT_BUFFER_SIZE) {
+        write_output_buffer();
+        if (length > OUTPUT_BUFFER_SIZE) {
+            fwrite(text, 1, (size_t)length, stdout);
+            return;
+        }
+    }
+    memcpy(&g_output_buffer[g_output_length], text, (size_t)length);
+    g_output_length += length;
+}
+
+void flush_output(void) {
+    // Leave the console in its default color between flushes
+    switch_output_color(COLOR_DEFAULT);
+    if (g_output_length > 0) {
+        write_output_buffer();
+        fflush(stdout);
+    }
+}
+
+void print_colored(int level, Color color, const char* msg) {
+    if (level > g_verbosity) {
+        return;
+    }
+    switch_output_color(color);
+    output_text(msg, (int)strlen(msg));
+}
+
+void print_formatted(int level, Color color, const char* format, ...) {
+    // Skip formatting entirely when nothing would be printed
+    if (level > g_verbosity) {
+        return;
+    }
+    
+    char msg[MAX_STRING_LEN * 2];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(msg, sizeof(msg), format, args);
+    va_end(args);
+    
+    switch_output_color(color);
+    output_text(msg, safe_min(length, (int)sizeof(msg) - 1));
 }
 
 void display_player(const Player* player) {
-    char msg[MAX_STRING_LEN * 10];
+    if (VERBOSITY_FULL > g_verbosity) {
+        return;
+    }
     
-    if (player->hand.card_count == 0) {
-        snprintf(msg, sizeof(msg), "Player \"%s\" has %d remaining chips.\n",
+    if (player->hands[0].card_count == 0) {
+        print_formatted(VERBOSITY_FULL, COLOR_WHITE, "Player \"%s\" has %d remaining chips.\n",
                 player->name, player->chip_count);
-    } else {
-        snprintf(msg, sizeof(msg), "Player \"%s\" has %d cards and %d remaining chips:\n",
-                player->name, player->hand.card_count, player->chip_count);
-        print_colored(msg, "white");
-        
-        for (int i = 0; i < player->hand.card_count; i++) {
-            char card_name[MAX_STRING_LEN];
-            get_card_name(&player->hand.cards[i], card_name, sizeof(card_name));
-            snprintf(msg, sizeof(msg), "  Card \"%s\"\n", card_name);
-            print_colored(msg, "white");
+        return;
+    }
+    
+    if (player->hand_count == 1) {
+        print_formatted(VERBOSITY_FULL, COLOR_WHITE,
+                "Player \"%s\" has %d cards and %d remaining chips:\n",
+                player->name, player->hands[0].card_count, player->chip_count);
+        for (int i = 0; i < player->hands[0].card_count; i++) {
+            print_formatted(VERBOSITY_FULL, COLOR_WHITE, "  Card \"%s\"\n",
+                    card_name(player->hands[0].cards[i]));
         }
         return;
     }
     
-    print_colored(msg, "white");
+    print_formatted(VERBOSITY_FULL, COLOR_WHITE, "Player \"%s\" has %d hands and %d remaining chips:\n",
+            player->name, player->hand_count, player->chip_count);
+    for (int h = 0; h < player->hand_count; h++) {
+        const Hand* hand = &player->hands[h];
+        print_formatted(VERBOSITY_FULL, COLOR_WHITE, "  Hand %d%s, %d chips:\n", h + 1,
+                h == player->active_hand ? " (playing)" : "", hand->wager);
+        for (int i = 0; i < hand->card_count; i++) {
+            print_formatted(VERBOSITY_FULL, COLOR_WHITE, "    Card \"%s\"\n", card_name(hand->cards[i]));
+        }
+    }
 }
 
 void display_dealer(const Dealer* dealer) {
-    char msg[MAX_STRING_LEN * 10];
-    
-    snprintf(msg, sizeof(msg), "Dealer has %d cards:\n", dealer->hand.card_count);
-    print_colored(msg, "white");
+    if (VERBOSITY_FULL > g_verbosity) {
+        return;
+    }
     
+    print_formatted(VERBOSITY_FULL, COLOR_WHITE, "Dealer has %d cards:\n", dealer->hand.card_count);
     for (int i = 0; i < dealer->hand.card_count; i++) {
-        char card_name[MAX_STRING_LEN];
-        get_card_name(&dealer->hand.cards[i], card_name, sizeof(card_name));
-        snprintf(msg, sizeof(msg), "  Card \"%s\"\n", card_name);
-        print_colored(msg, "white");
+        print_formatted(VERBOSITY_FULL, COLOR_WHITE, "  Card \"%s\"\n",
+                card_name(dealer->hand.cards[i]));
     }
 }
 
 int ask_integer(const char* msg, int default_value, int min_value, int max_value) {
     char buffer[MAX_STRING_LEN];
-    char prompt[MAX_STRING_LEN];
     
     while (1) {
-        snprintf(prompt, sizeof(prompt), "%s (default=%d): ", msg, default_value);
-        print_colored(prompt, "cyan");
+        print_formatted(VERBOSITY_SILENT, COLOR_CYAN, "%s (default=%d): ", msg, default_value);
+        flush_output();
         
         if (fgets(buffer, sizeof(buffer), stdin)) {
             size_t len = strlen(buffer);
@@ -737,10 +1488,8 @@ int ask_integer(const char* msg, int default_value, int min_value, int max_value
             
             int value = atoi(buffer);
             if (value < min_value || value > max_value) {
-                char error[MAX_STRING_LEN];
-                snprintf(error, sizeof(error), "Value must be between %d and %d\n", 
+                print_formatted(VERBOSITY_SILENT, COLOR_RED, "Value must be between %d and %d\n",
                         min_value, max_value);
-                print_colored(error, "red");
                 continue;
             }
             
@@ -751,12 +1500,11 @@ int ask_integer(const char* msg, int default_value, int min_value, int max_value
 
 char ask_choice(const char* msg, const char* choices, char default_choice) {
     char buffer[MAX_STRING_LEN];
-    char prompt[MAX_STRING_LEN];
     
     while (1) {
-        snprintf(prompt, sizeof(prompt), "%s (%s) (default=%c): ", 
+        print_formatted(VERBOSITY_SILENT, COLOR_CYAN, "%s (%s) (default=%c): ",
                 msg, choices, default_choice);
-        print_colored(prompt, "cyan");
+        flush_output();
         
         if (fgets(buffer, sizeof(buffer), stdin)) {
             size_t len = strlen(buffer);
@@ -773,7 +1521,7 @@ char ask_choice(const char* msg, const char* choices, char default_choice) {
                 return choice;
             }
             
-            print_colored("Not a valid choice!\n", "red");
+            print_colored(VERBOSITY_SILENT, COLOR_RED, "Not a valid choice!\n");
         }
     }
 }
@@ -788,7 +1536,17 @@ void init_basic_ruleset(Ruleset* ruleset) {
     ruleset->minimum_wager = 1;
     ruleset->dealer_receives_hole_card = 0;
     ruleset->dealer_reveals_blackjack_hand = 0;
-    ruleset->blackjack_payout_ratio = 2.0;
+    ruleset->blackjack_payout_numerator = 2;
+    ruleset->blackjack_payout_denominator = 1;
+    ruleset->machine_return_delay = 0;
+    ruleset->cut_card_penetration = 0.5;
+    ruleset->double_down_allowed = 1;
+    ruleset->double_after_split = 0;
+    ruleset->max_split_hands = 2;
+    ruleset->resplit_aces = 0;
+    ruleset->hit_split_aces = 0;
+    ruleset->late_surrender = 0;
+    ruleset->insurance_offered = 0;
 }
 
 void init_european_ruleset(Ruleset* ruleset) {
@@ -798,7 +1556,17 @@ void init_european_ruleset(Ruleset* ruleset) {
     ruleset->minimum_wager = 10;
     ruleset->dealer_receives_hole_card = 0;
     ruleset->dealer_reveals_blackjack_hand = 0;
-    ruleset->blackjack_payout_ratio = 1.5;
+    ruleset->blackjack_payout_numerator = 3;
+    ruleset->blackjack_payout_denominator = 2;
+    ruleset->machine_return_delay = 0;
+    ruleset->cut_card_penetration = 0.75;
+    ruleset->double_down_allowed = 1;
+    ruleset->double_after_split = 1;
+    ruleset->max_split_hands = 2;
+    ruleset->resplit_aces = 0;
+    ruleset->hit_split_aces = 0;
+    ruleset->late_surrender = 0;
+    ruleset->insurance_offered = 0;
 }
 
 void init_american_ruleset(Ruleset* ruleset) {
@@ -808,7 +1576,36 @@ void init_american_ruleset(Ruleset* ruleset) {
     ruleset->minimum_wager = 10;
     ruleset->dealer_receives_hole_card = 1;
     ruleset->dealer_reveals_blackjack_hand = 1;
-    ruleset->blackjack_payout_ratio = 1.5;
+    ruleset->blackjack_payout_numerator = 3;
+    ruleset->blackjack_payout_denominator = 2;
+    ruleset->machine_return_delay = 1;
+    ruleset->cut_card_penetration = 0.0;   // No cut card in a shuffling machine
+    ruleset->double_down_allowed = 1;
+    ruleset->double_after_split = 1;
+    ruleset->max_split_hands = 4;
+    ruleset->resplit_aces = 0;
+    ruleset->hit_split_aces = 0;
+    ruleset->late_surrender = 1;
+    ruleset->insurance_offered = 1;
+}
+
+int init_ruleset_by_name(Ruleset* ruleset, const char* name) {
+    if (strcmp(name, "basic") == 0) {
+        init_basic_ruleset(ruleset);
+    } else if (strcmp(name, "european") == 0) {
+        init_european_ruleset(ruleset);
+    } else if (strcmp(name, "american") == 0) {
+        init_american_ruleset(ruleset);
+    } else {
+        return 0;  // Unknown ruleset
+    }
+    return 1;
+}
+
+int get_blackjack_payout(const Ruleset* ruleset, int wager) {
+    // Integer ratio so 3:2 and 6:5 pay exactly; odd chips round down
+    return (int)((long long)wager * ruleset->blackjack_payout_numerator /
+                 ruleset->blackjack_payout_denominator);
 }
 
 // ============================================================================
@@ -13,8 +13,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdarg.h>
+#include <stdint.h>
 #include <time.h>
 
+#include "rng.h"
+
 // Platform-specific includes
 #ifndef UNIVAC
 #include <windows.h>
@@ -34,10 +38,14 @@
 #define MAX_CARDS_IN_SHOE (MAX_CARDS_IN_DECK * MAX_DECKS)
 #define MAX_CARDS_IN_HAND 21
 #define MAX_PLAYERS 7
+#define MAX_HANDS_PER_SEAT 4    // Original hand plus up to three splits
+#define MAX_MACHINE_RETURN_DELAY 8
+#define MAX_COUNTING_SYSTEMS 4
 #define MAX_NAME_LEN 64
 
 #define TARGET_SCORE 21
 #define MINIMUM_DEALER_SCORE 17
+#define SOFT_ACE_BONUS 10   // Extra points when an ace counts as 11
 
 // Card constants
 #define NUM_SUITS 4
@@ -49,26 +57,83 @@
 #define PUSH 2
 #define WIN 3
 #define BLACKJACK 4
+#define SURRENDER 5
+#define OUTCOME_COUNT 6
 
-// Card structure
-typedef struct {
-    int suit;       // 0=Spade, 1=Heart, 2=Diamond, 3=Club
-    int rank;       // 0=Ace, 1=2, ..., 9=10, 10=Jack, 11=Queen, 12=King
-    int visible;    // 1=visible, 0=hidden
-} Card;
+// Hand flags
+#define HAND_SPLIT 0x01         // Made by a split, so 21 on two cards is not a blackjack
+#define HAND_SPLIT_ACES 0x02
+#define HAND_DOUBLED 0x04
+#define HAND_SURRENDERED 0x08
+
+// Verbosity levels - a message is printed when its level is at most the
+// current verbosity; level SILENT is for prompts, which always show
+#define VERBOSITY_SILENT 0
+#define VERBOSITY_RESULTS 1     // Round outcomes
+#define VERBOSITY_PLAY 2        // Every action of the round
+#define VERBOSITY_FULL 3        // Hands redrawn after each change
+
+// Output is buffered per thread and written once per round
+#define OUTPUT_BUFFER_SIZE 16384
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+// Console colors
+typedef enum {
+    COLOR_DEFAULT,
+    COLOR_GREY,
+    COLOR_WHITE,
+    COLOR_RED,
+    COLOR_GREEN,
+    COLOR_YELLOW,
+    COLOR_CYAN,
+    COLOR_COUNT
+} Color;
+
+// Card encoding - one byte per card
+//   bits 0-3: rank (0=Ace, 1=2, ..., 9=10, 10=Jack, 11=Queen, 12=King)
+//   bits 4-5: suit (0=Spade, 1=Heart, 2=Diamond, 3=Club)
+//   bit 6:    visible (1=visible, 0=hidden)
+typedef uint8_t Card;
+
+#define CARD_RANK_MASK 0x0F
+#define CARD_SUIT_SHIFT 4
+#define CARD_SUIT_MASK 0x03
+#define CARD_FACE_MASK 0x3F     // Rank and suit bits, index into name tables
+#define CARD_VISIBLE_BIT 0x40
+#define CARD_FACE_COUNT 64
+
+#define MAKE_CARD(suit, rank) ((Card)(((suit) << CARD_SUIT_SHIFT) | (rank)))
+#define CARD_RANK(card) ((card) & CARD_RANK_MASK)
+#define CARD_SUIT(card) (((card) >> CARD_SUIT_SHIFT) & CARD_SUIT_MASK)
+#define CARD_IS_VISIBLE(card) (((card) & CARD_VISIBLE_BIT) != 0)
 
 // Hand structure
 typedef struct {
     Card cards[MAX_CARDS_IN_HAND];
-    int card_count;
+    uint8_t card_count;
+    uint8_t hard_total;     // Sum of card values with every ace counted as 1
+    uint8_t has_ace;        // 1 if an ace may still be counted as 11
+    uint8_t outcome;        // Set by pay_gains
+    uint8_t flags;          // HAND_* bits
     int wager;
+    int payout;             // Chips returned by pay_gains, wager included
 } Hand;
 
 // Player structure
+// Splits take hands from the seat's fixed pool, so a round never allocates.
+// hands[0] is the hand first dealt; active_hand is the one being played.
 typedef struct {
     char name[MAX_NAME_LEN];
     int chip_count;
-    Hand hand;
+    Hand hands[MAX_HANDS_PER_SEAT];
+    uint8_t hand_count;
+    uint8_t active_hand;
+    int insurance;          // Side bet against a dealer blackjack, 0 = none
 } Player;
 
 // Dealer structure
@@ -76,12 +141,43 @@ typedef struct {
     Hand hand;
 } Dealer;
 
+// Counting system structure - card counting weights per rank
+// The running count starts at initial_count + initial_count_per_deck * decks,
+// which is 0 for balanced systems and negative for unbalanced ones like KO.
+typedef struct {
+    const char* name;
+    int8_t weights[NUM_RANKS];
+    int initial_count;
+    int initial_count_per_deck;
+} CountingSystem;
+
 // Shoe structure
+// A regular shoe deals from cards[current_index]; everything before it is
+// either on the table or in the discard tray, and the whole shoe is
+// shuffled after the round in which the cut card came out.
+// An auto-shuffling shoe is a continuous shuffling machine: cards is a ring
+// holding the machine's cards followed by the dealt ones, newest first.
+// Discards re-enter the machine return_delay rounds after they were dealt.
 typedef struct {
     Card cards[MAX_CARDS_IN_SHOE];
     int total_cards;
     int current_index;
     int auto_shuffling;
+    int cut_card_index;         // Reshuffle after the round once this many cards are out
+    int cut_card_reached;
+    int machine_start;          // Ring position of the first card in the machine
+    int machine_count;          // Cards currently in the machine
+    int return_delay;           // Rounds before discards re-enter the machine
+    int round_dealt_count;      // Cards dealt since the last collect_discards (in play)
+    int pending_round_count;    // Rounds of discards waiting to re-enter
+    int pending_cards[MAX_MACHINE_RETURN_DELAY + 1];  // Oldest round first
+    int remaining_counts[NUM_RANKS];    // Cards of each rank not dealt yet
+    int counting_system_count;
+    int running_counts[MAX_COUNTING_SYSTEMS];
+    int initial_running_counts[MAX_COUNTING_SYSTEMS];
+    int8_t count_weights[MAX_COUNTING_SYSTEMS][NUM_RANKS];
+    int antithetic;             // Mirror every random pick, see pick_from_shoe
+    Rng rng;
 } Shoe;
 
 // Ruleset structure
@@ -92,9 +188,44 @@ typedef struct {
     int minimum_wager;
     int dealer_receives_hole_card;
     int dealer_reveals_blackjack_hand;
-    double blackjack_payout_ratio;
+    int blackjack_payout_numerator;     // Blackjack pays numerator to denominator,
+    int blackjack_payout_denominator;   // e.g. 3 to 2, in exact integer chips
+    int machine_return_delay;       // Rounds before an auto-shuffling shoe takes discards back
+    double cut_card_penetration;    // Share of a regular shoe dealt before reshuffling, 0 = every round
+    int double_down_allowed;        // Double any first two cards
+    int double_after_split;
+    int max_split_hands;            // Hands a seat may split into, 1 = no splitting
+    int resplit_aces;
+    int hit_split_aces;             // 0 = split aces get one card each
+    int late_surrender;             // Give up half the wager once the dealer has no blackjack
+    int insurance_offered;          // Against an ace upcard, needs a hole card
 } Ruleset;
 
+// Round states - what a round in progress waits for
+typedef enum {
+    ROUND_IDLE,             // No round in progress, start_round begins one
+    ROUND_WAGERS,           // submit_wager from every seat asked
+    ROUND_INSURANCE,        // submit_insurance from every seat offered it
+    ROUND_DECISION,         // submit_action for the seat whose turn it is
+    ROUND_SETTLED           // Paid and observed, end_round clears the table
+} RoundState;
+
+#define ROUND_AWAITED -1    // Answer not submitted yet
+
+// Round structure - a round suspended until its next input
+// Between two inputs a round is nothing but this and its table, so one
+// thread can keep any number of tables in flight.
+typedef struct {
+    RoundState state;
+    int answers[MAX_PLAYERS];   // Wagers or insurance, ROUND_AWAITED until submitted
+    int pending_count;
+    int turn;                   // Position in active_player_indices while deciding
+#ifdef UNIJACK_INSTRUMENT
+    uint64_t start_ticks;       // Round start, for the round phase
+    uint64_t wait_ticks;        // Start of the wagers or of the current turn
+#endif
+} Round;
+
 // Table structure
 typedef struct {
     Shoe shoe;
@@ -103,40 +234,127 @@ typedef struct {
     int player_count;
     int active_player_indices[MAX_PLAYERS];
     int active_player_count;
+    Round round;
 } Table;
 
+// Game statistics structure - running tallies of settled hands
+typedef struct {
+    long long round_count;
+    long long hand_count;
+    long long win_count;
+    long long loose_count;
+    long long push_count;
+    long long blackjack_count;
+    long long bust_count;
+    long long surrender_count;
+    long long double_count;
+    long long split_count;
+    long long insurance_count;
+    long long total_wagered;    // Insurance included
+    long long total_paid;
+} GameStats;
+
+// Histogram of round nets in half minimum wagers, the outer bins open ended
+#define NET_HISTOGRAM_UNITS 8
+#define NET_HISTOGRAM_BINS (4 * NET_HISTOGRAM_UNITS)
+
+// Round moments structure - streaming spread of the chips rounds win
+// Every round adds its net and its wager, summed over the seats (Welford);
+// two accumulators merge into the one their rounds would have filled
+// together (Chan et al.), so workers never share one.
+typedef struct {
+    long long round_count;
+    double net_mean;            // Chips per round
+    double wagered_mean;
+    double net_m2;              // Sums of squared deviations from the means
+    double wagered_m2;
+    double co_m2;               // Sum of products of both deviations
+    long long histogram[NET_HISTOGRAM_BINS];
+} RoundMoments;
+
+// Player policy and round observer structures (defined below, need Game and Table)
+typedef struct PlayerPolicy PlayerPolicy;
+typedef struct RoundObserver RoundObserver;
+
 // Game state structure
 typedef struct {
     Ruleset ruleset;
     int running;
+    const PlayerPolicy* policy;     // NULL = ask on console
+    const RoundObserver* observer;  // NULL = nobody watching
+    GameStats stats;
 } Game;
 
+// Player policy structure - decision callbacks used instead of the console
+// choose_wager returns a chip count (0 = sit out), choose_action returns
+// one of the characters accepted by submit_action.
+// Actions are 'h'it, 's'tand, 'd'ouble, s'p'lit and su'r'render, for the
+// player's active hand; an action the rules do not allow at that point
+// counts as a hit for double and surrender and as a stand otherwise.
+// choose_insurance may be NULL, which never takes insurance.
+struct PlayerPolicy {
+    int (*choose_wager)(void* context, const Game* game, const Table* table, int player_idx);
+    char (*choose_action)(void* context, const Game* game, const Table* table, int player_idx);
+    void* context;
+    int (*choose_insurance)(void* context, const Game* game, const Table* table, int player_idx);
+};
+
+// Round observer structure - notified of every decision, and of each round
+// once it is paid, before the table is cleaned
+struct RoundObserver {
+    void (*on_action)(void* context, const Game* game, const Table* table, int player_idx, char action);
+    void (*on_round_settled)(void* context, const Game* game, const Table* table);
+    void* context;
+};
+
 // BSS-initialized global state
 #ifdef UNIVAC
 // For UNIVAC, we ensure BSS initialization
 extern Card g_deck_template[MAX_CARDS_IN_DECK];
 extern int g_bss_initialized;
+void init_bss(void);
 #endif
 
 // Function declarations - Card operations
 void init_card(Card* card, int suit, int rank);
-void get_card_name(const Card* card, char* buffer, size_t buffer_size);
-void get_card_values(const Card* card, int* values, int* value_count);
+const char* card_name(Card card);
+void get_card_name(Card card, char* buffer, size_t buffer_size);
+void get_card_values(Card card, int* values, int* value_count);
 
 // Function declarations - Deck operations
 void create_deck(Card* deck);
 
+// Hard value of each rank, aces counting 1
+extern const uint8_t RANK_VALUES[NUM_RANKS];
+
 // Function declarations - Shoe operations
-void init_shoe(Shoe* shoe, int deck_count, int auto_shuffling);
+void init_shoe(Shoe* shoe, int deck_count, int auto_shuffling, uint64_t seed);
+void init_ruleset_shoe(Shoe* shoe, const Ruleset* ruleset, uint64_t seed);
 void shuffle_shoe(Shoe* shoe);
 void reload_shoe(Shoe* shoe);
-Card* draw_card(Shoe* shoe, int visible);
+void restart_shoe(Shoe* shoe, const Rng* rng);
+Card draw_card(Shoe* shoe, int visible);
+void place_cut_card(Shoe* shoe, double penetration);
+int collect_discards(Shoe* shoe);
+int get_cards_remaining(const Shoe* shoe);
+
+// Function declarations - Counting operations
+extern const CountingSystem HI_LO_COUNT;
+extern const CountingSystem KO_COUNT;
+extern const CountingSystem OMEGA_II_COUNT;
+const CountingSystem* find_counting_system(const char* name);
+int add_counting_system(Shoe* shoe, const CountingSystem* system);
+int get_running_count(const Shoe* shoe, int system_idx);
+double get_true_count(const Shoe* shoe, int system_idx);
 
 // Function declarations - Hand operations
 void init_hand(Hand* hand);
-void add_card_to_hand(Hand* hand, Card* card);
+void add_card_to_hand(Hand* hand, Card card);
 void reveal_all_cards(Hand* hand);
 int get_hand_score(const Hand* hand);
+int hand_is_bust(const Hand* hand);
+int hand_is_soft(const Hand* hand);
+int hand_is_blackjack(const Hand* hand);
 
 // Function declarations - Score operations
 int score_from_hand(const Hand* hand);
@@ -144,6 +362,8 @@ void compare_hands(const Hand* hand1, const Hand* hand2, int* outcome1, int* out
 
 // Function declarations - Player operations
 void init_player(Player* player, const char* name, int chip_count);
+const Hand* get_active_hand(const Player* player);
+int get_allowed_actions(const Ruleset* ruleset, const Player* player, char* actions);
 int bet_chips(Player* player, int chip_count);
 void earn_chips(Player* player, int chip_count);
 void drop_player_hand(Player* player);
@@ -153,21 +373,48 @@ void init_dealer(Dealer* dealer);
 void drop_dealer_hand(Dealer* dealer);
 
 // Function declarations - Table operations
-void init_table(Table* table, const Ruleset* ruleset);
+void init_table(Table* table, const Ruleset* ruleset, uint64_t seed);
 
 // Function declarations - Game operations
 void init_game(Game* game, const Ruleset* ruleset);
+void init_game_stats(GameStats* stats);
+void merge_game_stats(GameStats* into, const GameStats* from);
+void init_round_moments(RoundMoments* moments);
+void add_round_moments(RoundMoments* moments, long long net, long long wagered, int unit);
+void merge_round_moments(RoundMoments* into, const RoundMoments* from);
+int get_net_histogram_bin(long long net, int unit);
 void run_game(Game* game, Table* table);
 int play_new_round(Game* game, Table* table);
-int collect_wagers(Game* game, Table* table);
-void deal_initial_cards(Game* game, Table* table);
-void interact_with_player(Game* game, Table* table, int player_idx);
+void deal_starting_hands(Game* game, Table* table);
+int get_insurance_amount(const Game* game, const Table* table, int player_idx);
+void take_insurance(Game* game, Table* table, int player_idx);
+void peek_dealer_hand(Game* game, Table* table);
+int dealer_has_revealed_blackjack(const Game* game, const Table* table);
+int advance_player_hand(Game* game, Table* table, int player_idx);
+int apply_player_action(Game* game, Table* table, int player_idx, char choice);
 void interact_with_dealer(Game* game, Table* table);
 void pay_gains(Game* game, Table* table);
 void cleanup_table(Table* table);
 
+// Function declarations - Round operations
+// A round runs by itself up to the next input it needs and returns; the
+// caller submits inputs whenever they arrive, in any order across seats.
+void start_round(Game* game, Table* table, uint32_t seat_mask);
+int round_awaits_player(const Table* table, int player_idx);
+int get_round_player(const Table* table);
+void submit_wager(Game* game, Table* table, int player_idx, int chip_count);
+void submit_insurance(Game* game, Table* table, int player_idx, int take);
+void submit_action(Game* game, Table* table, char choice);
+void end_round(Game* game, Table* table);
+
 // Function declarations - UI operations
-void print_colored(const char* msg, const char* color);
+void set_verbosity(int verbosity);
+int get_verbosity(void);
+int is_output_enabled(int level);
+void print_colored(int level, Color color, const char* msg);
+void print_formatted(int level, Color color, const char* format, ...);
+void output_text(const char* text, int length);
+void flush_output(void);
 void display_player(const Player* player);
 void display_dealer(const Dealer* dealer);
 int ask_integer(const char* msg, int default_value, int min_value, int max_value);
@@ -177,6 +424,8 @@ char ask_choice(const char* msg, const char* choices, char default_choice);
 void init_basic_ruleset(Ruleset* ruleset);
 void init_european_ruleset(Ruleset* ruleset);
 void init_american_ruleset(Ruleset* ruleset);
+int init_ruleset_by_name(Ruleset* ruleset, const char* name);
+int get_blackjack_payout(const Ruleset* ruleset, int wager);
 
 // Utility functions
 void to_upper(char* str);
@@ -102,8 +102,26 @@ if %ERRORLEVEL% NEQ 0 (
     exit /b 1
 )
 
+echo Compiling rng.c...
+gcc -c -DUNIVAC -O2 -Wall -Wno-unused-parameter rng.c -o rng_univac.o
+
+if %ERRORLEVEL% NEQ 0 (
+    echo ERROR: Failed to compile rng.c
+    pause
+    exit /b 1
+)
+
+echo Compiling main.c...
+gcc -c -DUNIVAC -O2 -Wall -Wno-unused-parameter main.c -o main_univac.o
+
+if %ERRORLEVEL% NEQ 0 (
+    echo ERROR: Failed to compile main.c
+    pause
+    exit /b 1
+)
+
 echo Linking...
-gcc -o blackjack_univac.exe blackjack_univac.o
+gcc -o blackjack_univac.exe main_univac.o blackjack_univac.o rng_univac.o
 
 if %ERRORLEVEL% EQU 0 (
     echo.
@@ -203,7 +221,7 @@ echo.
 echo Compiling and linking...
 gcc %WARNING_FLAGS% %OPTIMIZE_FLAGS% %PERF_FLAGS% ^
     -o blackjack.exe ^
-    blackjack.c ^
+    main.c blackjack.c rng.c ^
     %LINKER_FLAGS%
 
 if %ERRORLEVEL% EQU 0 (
@@ -262,7 +280,7 @@ echo Compiling with MSVC...
 echo.
 
 REM Compile source files
-cl /W4 /O2 /Fe:blackjack.exe blackjack.c
+cl /W4 /O2 /Fe:blackjack.exe main.c blackjack.c rng.c
 
 if %ERRORLEVEL% EQU 0 (
     echo.
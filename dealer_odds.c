@@ -0,0 +1,114 @@
+/*
+ * UNIJACK - Dealer odds entry point
+ * Prints the exact dealer outcome distribution for every upcard drawn
+ * from a full shoe, or from a shoe with some cards already removed.
+ */
+
+#include "odds.h"
+#include "sim.h"
+
+static const char* VALUE_LABELS[CARD_VALUE_COUNT] = {
+    "A", "2", "3", "4", "5", "6", "7", "8", "9", "10"
+};
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --ruleset NAME   basic, european or american (default: american)\n"
+        "  --remove CARDS   comma separated cards already dealt, e.g. A,10,10,5\n",
+        program);
+}
+
+static int parse_value_label(const char* label) {
+    for (int v = 0; v < CARD_VALUE_COUNT; v++) {
+        if (strcmp(label, VALUE_LABELS[v]) == 0) {
+            return v;
+        }
+    }
+    if (strcmp(label, "J") == 0 || strcmp(label, "Q") == 0 || strcmp(label, "K") == 0) {
+        return TEN_VALUE_INDEX;
+    }
+    return -1;
+}
+
+static int remove_cards(int counts[CARD_VALUE_COUNT], const char* list) {
+    char buffer[MAX_STRING_LEN * 4];
+    SAFE_STRCPY(buffer, list, sizeof(buffer));
+    to_upper(buffer);
+    
+    for (char* token = strtok(buffer, ","); token; token = strtok(NULL, ",")) {
+        int v = parse_value_label(token);
+        if (v < 0 || counts[v] == 0) {
+            fprintf(stderr, "Cannot remove card \"%s\"\n", token);
+            return 0;
+        }
+        counts[v]--;
+    }
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    Ruleset ruleset;
+    init_american_ruleset(&ruleset);
+    const char* removed = NULL;
+    
+    for (int i = 1; i < argc; i++) {
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        
+        if (strcmp(argv[i], "--ruleset") == 0 && value) {
+            if (!init_ruleset_by_name(&ruleset, value)) {
+                fprintf(stderr, "Unknown ruleset \"%s\"\n", value);
+                return 1;
+            }
+            i++;
+        } else if (strcmp(argv[i], "--remove") == 0 && value) {
+            removed = value;
+            i++;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    int counts[CARD_VALUE_COUNT];
+    count_values_in_full_shoe(ruleset.deck_count_in_shoe, counts);
+    if (removed && !remove_cards(counts, removed)) {
+        return 1;
+    }
+    
+    DealerOddsCache cache;
+    if (!init_dealer_odds_cache(&cache, 1 << 16)) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    
+    printf("Dealer odds, %d decks%s\n", ruleset.deck_count_in_shoe,
+           dealer_peeks_for_blackjack(&ruleset) ? ", no dealer blackjack (peeked)" : "");
+    printf("Up      17      18      19      20      21    Bust      BJ   Time(us)\n");
+    
+    for (int i = 1; i <= CARD_VALUE_COUNT; i++) {
+        int upcard = i % CARD_VALUE_COUNT;  // 2..10 then Ace
+        int shoe_counts[CARD_VALUE_COUNT];
+        memcpy(shoe_counts, counts, sizeof(counts));
+        if (shoe_counts[upcard] == 0) {
+            continue;
+        }
+        shoe_counts[upcard]--;
+        
+        // Start cold so the reported time covers a full query
+        clear_dealer_odds_cache(&cache);
+        DealerOdds odds;
+        double start = sim_clock_seconds();
+        compute_dealer_odds_for_ruleset(&cache, shoe_counts, upcard, &ruleset, &odds);
+        double elapsed = sim_clock_seconds() - start;
+        
+        printf("%-3s", VALUE_LABELS[upcard]);
+        for (int o = 0; o < DEALER_OUTCOME_COUNT; o++) {
+            printf(" %7.4f", odds.p[o]);
+        }
+        printf(" %10.1f\n", elapsed * 1e6);
+    }
+    
+    free_dealer_odds_cache(&cache);
+    return 0;
+}
@@ -0,0 +1,380 @@
+/*
+ * UNIJACK - Hand history
+ * Implementation
+ */
+
+#include "history.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char* const OUTCOME_NAMES[OUTCOME_COUNT] = {"bust", "lose", "push", "win", "blackjack", "surrender"};
+
+// ============================================================================
+// BYTE ORDER HELPERS
+// ============================================================================
+static inline void put_u16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put_u32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static inline void put_u64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static inline uint16_t get_u16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get_u32(const uint8_t* p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+static inline uint64_t get_u64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+// ============================================================================
+// LOG OPERATIONS
+// ============================================================================
+static void* history_flush_thread(void* argument) {
+    HistoryLog* log = (HistoryLog*)argument;
+    
+    pthread_mutex_lock(&log->lock);
+    while (1) {
+        while (log->queue_count == 0 && !log->closing) {
+            pthread_cond_wait(&log->queued, &log->lock);
+        }
+        if (log->queue_count == 0) {
+            break;  // Closing and nothing left to write
+        }
+        HistoryBuffer* buffer = log->queue[log->queue_head];
+        log->queue_head = (log->queue_head + 1) % log->queue_capacity;
+        log->queue_count--;
+        int failed = log->failed;
+        pthread_mutex_unlock(&log->lock);
+        
+        // The disk write happens outside the lock, writers keep filling
+        if (!failed && fwrite(buffer->data, 1, buffer->length, log->file) != buffer->length) {
+            failed = 1;
+        }
+        
+        pthread_mutex_lock(&log->lock);
+        log->failed |= failed;
+        log->bytes_written += (long long)buffer->length;
+        buffer->in_flight = 0;
+        pthread_cond_broadcast(&log->written);
+    }
+    pthread_mutex_unlock(&log->lock);
+    return NULL;
+}
+
+int open_history_log(HistoryLog* log, const char* path, const Ruleset* ruleset, uint64_t seed,
+                     int max_writers) {
+    memset(log, 0, sizeof(*log));
+    log->queue_capacity = safe_max(max_writers, 1) * HISTORY_BUFFERS_PER_WRITER;
+    log->queue = calloc(log->queue_capacity, sizeof(HistoryBuffer*));
+    log->file = fopen(path, "wb");
+    if (!log->queue || !log->file) {
+        free(log->queue);
+        if (log->file) {
+            fclose(log->file);
+        }
+        return 0;
+    }
+    
+    uint8_t header[HISTORY_HEADER_SIZE] = {0};
+    memcpy(header, HISTORY_MAGIC, 4);
+    put_u16(&header[4], HISTORY_VERSION);
+    put_u16(&header[6], HISTORY_HEADER_SIZE);
+    put_u64(&header[8], seed);
+    put_u16(&header[16], (uint16_t)(ruleset->deck_count_in_shoe * MAX_CARDS_IN_DECK));
+    header[18] = (uint8_t)ruleset->auto_shuffling_shoe;
+    header[19] = (uint8_t)ruleset->dealer_receives_hole_card;
+    put_u32(&header[20], (uint32_t)ruleset->minimum_wager);
+    put_u32(&header[24], (uint32_t)((ruleset->blackjack_payout_numerator * 1000LL +
+            ruleset->blackjack_payout_denominator / 2) / ruleset->blackjack_payout_denominator));
+    header[28] = (uint8_t)ruleset->dealer_reveals_blackjack_hand;
+    if (fwrite(header, 1, sizeof(header), log->file) != sizeof(header)) {
+        free(log->queue);
+        fclose(log->file);
+        return 0;
+    }
+    log->bytes_written = sizeof(header);
+    
+    pthread_mutex_init(&log->lock, NULL);
+    pthread_cond_init(&log->queued, NULL);
+    pthread_cond_init(&log->written, NULL);
+    if (pthread_create(&log->flush_thread, NULL, history_flush_thread, log) != 0) {
+        pthread_mutex_destroy(&log->lock);
+        pthread_cond_destroy(&log->queued);
+        pthread_cond_destroy(&log->written);
+        free(log->queue);
+        fclose(log->file);
+        return 0;
+    }
+    return 1;
+}
+
+int close_history_log(HistoryLog* log) {
+    // Writers must be closed first, so everything they filled is queued
+    pthread_mutex_lock(&log->lock);
+    log->closing = 1;
+    pthread_cond_signal(&log->queued);
+    pthread_mutex_unlock(&log->lock);
+    pthread_join(log->flush_thread, NULL);
+    
+    int ok = !log->failed;
+    if (fclose(log->file) != 0) {
+        ok = 0;
+    }
+    pthread_mutex_destroy(&log->lock);
+    pthread_cond_destroy(&log->queued);
+    pthread_cond_destroy(&log->written);
+    free(log->queue);
+    log->queue = NULL;
+    log->file = NULL;
+    return ok;
+}
+
+// ============================================================================
+// WRITER OPERATIONS
+// ============================================================================
+static void submit_history_buffer(HistoryWriter* writer) {
+    HistoryLog* log = writer->log;
+    HistoryBuffer* buffer = &writer->buffers[writer->current];
+    int next = (writer->current + 1) % HISTORY_BUFFERS_PER_WRITER;
+    
+    pthread_mutex_lock(&log->lock);
+    buffer->in_flight = 1;
+    log->queue[(log->queue_head + log->queue_count) % log->queue_capacity] = buffer;
+    log->queue_count++;
+    pthread_cond_signal(&log->queued);
+    
+    // Only blocks when the disk is slower than the simulation
+    while (writer->buffers[next].in_flight) {
+        pthread_cond_wait(&log->written, &log->lock);
+    }
+    pthread_mutex_unlock(&log->lock);
+    
+    writer->current = next;
+    writer->buffers[next].length = 0;
+}
+
+static void history_on_action(void* context, const Game* game, const Table* table, int player_idx,
+                              char action) {
+    (void)game;
+    HistoryWriter* writer = (HistoryWriter*)context;
+    int hand_idx = table->players[player_idx].active_hand;
+    uint8_t* count = &writer->decision_counts[player_idx][hand_idx];
+    if (*count < HISTORY_MAX_DECISIONS) {
+        writer->decisions[player_idx][hand_idx][(*count)++] = action;
+    }
+}
+
+static void history_on_round_settled(void* context, const Game* game, const Table* table) {
+    (void)game;
+    HistoryWriter* writer = (HistoryWriter*)context;
+    if (writer->buffers[writer->current].length + HISTORY_MAX_RECORD_SIZE > HISTORY_BUFFER_SIZE) {
+        submit_history_buffer(writer);
+    }
+    HistoryBuffer* buffer = &writer->buffers[writer->current];
+    uint8_t* record = &buffer->data[buffer->length];
+    
+    // Cards out of the shoe before this round's were dealt
+    const Shoe* shoe = &table->shoe;
+    int shoe_dealt = shoe->total_cards - get_cards_remaining(shoe) - shoe->round_dealt_count;
+    const Hand* dealer = &table->dealer.hand;
+    
+    int hand_count = 0;
+    record[3] = dealer->card_count;
+    put_u32(&record[4], writer->chunk_idx);
+    put_u32(&record[8], writer->round_idx);
+    put_u16(&record[12], (uint16_t)safe_max(shoe_dealt, 0));
+    uint8_t* p = &record[HISTORY_ROUND_HEADER_SIZE];
+    for (int i = 0; i < dealer->card_count; i++) {
+        *p++ = dealer->cards[i] & CARD_FACE_MASK;
+    }
+    
+    for (int i = 0; i < table->active_player_count; i++) {
+        int player_idx = table->active_player_indices[i];
+        const Player* player = &table->players[player_idx];
+        for (int h = 0; h < player->hand_count; h++) {
+            const Hand* hand = &player->hands[h];
+            int decision_count = writer->decision_counts[player_idx][h];
+            p[0] = (uint8_t)player_idx;
+            p[1] = hand->card_count;
+            p[2] = (uint8_t)decision_count;
+            p[3] = hand->outcome;
+            put_u32(&p[4], (uint32_t)hand->wager);
+            put_u32(&p[8], (uint32_t)hand->payout);
+            p += HISTORY_SEAT_HEADER_SIZE;
+            for (int c = 0; c < hand->card_count; c++) {
+                *p++ = hand->cards[c] & CARD_FACE_MASK;
+            }
+            memcpy(p, writer->decisions[player_idx][h], (size_t)decision_count);
+            p += decision_count;
+            writer->decision_counts[player_idx][h] = 0;
+            hand_count++;
+        }
+    }
+    
+    put_u16(record, (uint16_t)(p - record));
+    record[2] = (uint8_t)hand_count;
+    buffer->length += (size_t)(p - record);
+    writer->round_idx++;
+}
+
+int init_history_writer(HistoryWriter* writer, HistoryLog* log) {
+    memset(writer, 0, sizeof(*writer));
+    writer->log = log;
+    for (int i = 0; i < HISTORY_BUFFERS_PER_WRITER; i++) {
+        writer->buffers[i].data = malloc(HISTORY_BUFFER_SIZE);
+        if (!writer->buffers[i].data) {
+            for (int j = 0; j < i; j++) {
+                free(writer->buffers[j].data);
+            }
+            return 0;
+        }
+    }
+    writer->observer.on_action = history_on_action;
+    writer->observer.on_round_settled = history_on_round_settled;
+    writer->observer.context = writer;
+    return 1;
+}
+
+void begin_history_chunk(HistoryWriter* writer, long long chunk_idx) {
+    writer->chunk_idx = (uint32_t)chunk_idx;
+    writer->round_idx = 0;
+    memset(writer->decision_counts, 0, sizeof(writer->decision_counts));
+}
+
+void close_history_writer(HistoryWriter* writer) {
+    HistoryLog* log = writer->log;
+    if (writer->buffers[writer->current].length > 0) {
+        submit_history_buffer(writer);
+    }
+    
+    pthread_mutex_lock(&log->lock);
+    for (int i = 0; i < HISTORY_BUFFERS_PER_WRITER; i++) {
+        while (writer->buffers[i].in_flight) {
+            pthread_cond_wait(&log->written, &log->lock);
+        }
+    }
+    pthread_mutex_unlock(&log->lock);
+    
+    for (int i = 0; i < HISTORY_BUFFERS_PER_WRITER; i++) {
+        free(writer->buffers[i].data);
+        writer->buffers[i].data = NULL;
+    }
+}
+
+// ============================================================================
+// READER OPERATIONS
+// ============================================================================
+int map_history_file(HistoryFile* file, const char* path) {
+    memset(file, 0, sizeof(*file));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < HISTORY_HEADER_SIZE) {
+        close(fd);
+        return 0;
+    }
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return 0;
+    }
+    
+    const uint8_t* header = (const uint8_t*)data;
+    file->data = header;
+    file->size = (size_t)st.st_size;
+    if (memcmp(header, HISTORY_MAGIC, 4) != 0 || get_u16(&header[4]) == 0 || get_u16(&header[4]) > HISTORY_VERSION ||
+        get_u16(&header[6]) != HISTORY_HEADER_SIZE) {
+        unmap_history_file(file);
+        return 0;
+    }
+    file->header.version = get_u16(&header[4]);
+    file->header.seed = get_u64(&header[8]);
+    file->header.total_cards = get_u16(&header[16]);
+    file->header.auto_shuffling = header[18];
+    file->header.dealer_receives_hole_card = header[19];
+    file->header.minimum_wager = get_u32(&header[20]);
+    file->header.blackjack_payout_milli = get_u32(&header[24]);
+    file->header.dealer_reveals_blackjack_hand = header[28];
+    return 1;
+}
+
+void unmap_history_file(HistoryFile* file) {
+    if (file->data) {
+        munmap((void*)file->data, file->size);
+    }
+    memset(file, 0, sizeof(*file));
+}
+
+size_t decode_history_round(const uint8_t* data, size_t available, HistoryRound* round) {
+    // Returns the record size, or 0 when the record is cut short or invalid
+    if (available < HISTORY_ROUND_HEADER_SIZE) {
+        return 0;
+    }
+    size_t size = get_u16(data);
+    if (size < HISTORY_ROUND_HEADER_SIZE || size > available) {
+        return 0;
+    }
+    round->hand_count = data[2];
+    round->dealer_card_count = data[3];
+    round->chunk_idx = get_u32(&data[4]);
+    round->round_idx = get_u32(&data[8]);
+    round->shoe_dealt = get_u16(&data[12]);
+    if (round->hand_count > HISTORY_MAX_HANDS) {
+        return 0;
+    }
+    
+    size_t offset = HISTORY_ROUND_HEADER_SIZE;
+    round->dealer_cards = &data[offset];
+    offset += round->dealer_card_count;
+    for (int i = 0; i < round->hand_count; i++) {
+        if (offset + HISTORY_SEAT_HEADER_SIZE > size) {
+            return 0;
+        }
+        HistorySeat* seat = &round->seats[i];
+        const uint8_t* p = &data[offset];
+        seat->seat_idx = p[0];
+        seat->card_count = p[1];
+        seat->decision_count = p[2];
+        seat->outcome = p[3];
+        seat->wager = get_u32(&p[4]);
+        seat->payout = get_u32(&p[8]);
+        offset += HISTORY_SEAT_HEADER_SIZE;
+        seat->cards = &data[offset];
+        offset += seat->card_count;
+        seat->decisions = (const char*)&data[offset];
+        offset += seat->decision_count;
+    }
+    return offset == size ? size : 0;
+}
+
+const char* history_outcome_name(int outcome) {
+    return outcome >= 0 && outcome < OUTCOME_COUNT ? OUTCOME_NAMES[outcome] : "?";
+}
@@ -0,0 +1,142 @@
+/*
+ * UNIJACK - Hand history
+ * Compact binary log of every round played. Writers append whole rounds
+ * to large per-thread buffers that a background thread writes to disk.
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "blackjack.h"
+
+#include <pthread.h>
+
+// File format, all integers little-endian
+//
+// File header (HISTORY_HEADER_SIZE bytes)
+//   char[4] magic "UJHH"       u16 version          u16 header size
+//   u64     seed               u16 cards in shoe    u8  auto-shuffling
+//   u8      hole card          u32 minimum wager    u32 blackjack payout x1000
+//   u8      reveals blackjack  u8[3] reserved
+//
+// Round record, one per round, in the order buffers reached the disk
+//   u16 record size            u8  hand count       u8  dealer card count
+//   u32 chunk index            u32 round index in the chunk
+//   u16 cards dealt from the shoe before the round
+//   u8[dealer card count] dealer cards (rank and suit bits)
+//   then for every hand played, split hands right after their seat's first:
+//     u8  seat index           u8  card count       u8  decision count
+//     u8  outcome (BUST..SURRENDER)                 u32 wager
+//     u32 payout (wager included)
+//     u8[card count] cards     char[decision count] decisions
+// Decisions are the PlayerPolicy action letters, plus 'i' on a seat's
+// first hand when it took insurance (half its first wager)
+//
+// Version 1 logs predate splits and are read the same way
+#define HISTORY_MAGIC "UJHH"
+#define HISTORY_VERSION 2
+#define HISTORY_MAX_HANDS (MAX_PLAYERS * MAX_HANDS_PER_SEAT)
+#define HISTORY_HEADER_SIZE 32
+#define HISTORY_ROUND_HEADER_SIZE 14
+#define HISTORY_SEAT_HEADER_SIZE 12
+#define HISTORY_MAX_DECISIONS 32
+#define HISTORY_MAX_RECORD_SIZE \
+    (HISTORY_ROUND_HEADER_SIZE + MAX_CARDS_IN_HAND + \
+     HISTORY_MAX_HANDS * (HISTORY_SEAT_HEADER_SIZE + MAX_CARDS_IN_HAND + HISTORY_MAX_DECISIONS))
+
+// Each writer fills one buffer while the other is on its way to disk
+#define HISTORY_BUFFER_SIZE (1 << 20)
+#define HISTORY_BUFFERS_PER_WRITER 2
+
+// History file header structure - decoded form
+typedef struct {
+    uint16_t version;
+    uint64_t seed;
+    uint16_t total_cards;
+    uint8_t auto_shuffling;
+    uint8_t dealer_receives_hole_card;
+    uint8_t dealer_reveals_blackjack_hand;
+    uint32_t minimum_wager;
+    uint32_t blackjack_payout_milli;
+} HistoryHeader;
+
+// History seat structure - one hand of a decoded round
+typedef struct {
+    uint8_t seat_idx;
+    uint8_t card_count;
+    uint8_t decision_count;
+    uint8_t outcome;
+    uint32_t wager;
+    uint32_t payout;
+    const uint8_t* cards;
+    const char* decisions;
+} HistorySeat;
+
+// History round structure - decoded record, pointing into the log data
+typedef struct {
+    uint32_t chunk_idx;
+    uint32_t round_idx;
+    uint16_t shoe_dealt;
+    uint8_t hand_count;
+    uint8_t dealer_card_count;
+    const uint8_t* dealer_cards;
+    HistorySeat seats[HISTORY_MAX_HANDS];
+} HistoryRound;
+
+// History buffer structure
+typedef struct {
+    uint8_t* data;
+    size_t length;
+    int in_flight;              // Queued for or being written by the flush thread
+} HistoryBuffer;
+
+// History log structure - one open file and its flush thread
+typedef struct {
+    FILE* file;
+    pthread_t flush_thread;
+    pthread_mutex_t lock;
+    pthread_cond_t queued;      // Signaled when a buffer is queued or on close
+    pthread_cond_t written;     // Signaled when a buffer is free again
+    HistoryBuffer** queue;      // Ring of buffers waiting to be written
+    int queue_capacity;
+    int queue_head;
+    int queue_count;
+    int closing;
+    int failed;
+    long long bytes_written;
+} HistoryLog;
+
+// History writer structure - one per producing thread
+typedef struct {
+    HistoryLog* log;
+    HistoryBuffer buffers[HISTORY_BUFFERS_PER_WRITER];
+    int current;
+    uint32_t chunk_idx;
+    uint32_t round_idx;
+    uint8_t decision_counts[MAX_PLAYERS][MAX_HANDS_PER_SEAT];
+    char decisions[MAX_PLAYERS][MAX_HANDS_PER_SEAT][HISTORY_MAX_DECISIONS];
+    RoundObserver observer;     // Assign &writer->observer to Game.observer
+} HistoryWriter;
+
+// History file structure - a log mapped into memory for reading
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    HistoryHeader header;
+} HistoryFile;
+
+// Function declarations - Writing
+int open_history_log(HistoryLog* log, const char* path, const Ruleset* ruleset, uint64_t seed,
+                     int max_writers);
+int close_history_log(HistoryLog* log);
+int init_history_writer(HistoryWriter* writer, HistoryLog* log);
+void begin_history_chunk(HistoryWriter* writer, long long chunk_idx);
+void close_history_writer(HistoryWriter* writer);
+
+// Function declarations - Reading
+int map_history_file(HistoryFile* file, const char* path);
+void unmap_history_file(HistoryFile* file);
+size_t decode_history_round(const uint8_t* data, size_t available, HistoryRound* round);
+const char* history_outcome_name(int outcome);
+
+#endif // HISTORY_H
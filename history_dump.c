@@ -0,0 +1,126 @@
+/*
+ * UNIJACK - Hand history dump entry point
+ * Prints the header of a hand-history log and its rounds, one line per
+ * round and one per seat.
+ */
+
+#include "history.h"
+
+static const char RANK_LABELS[NUM_RANKS + 1] = "A23456789TJQK";
+static const char SUIT_LABELS[NUM_SUITS + 1] = "shdc";
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s FILE [options]\n"
+        "  --limit N        print at most N rounds (default: all)\n"
+        "  --chunk N        only print rounds of chunk N\n"
+        "  --header         print the header only\n",
+        program);
+}
+
+static int print_cards(const uint8_t* cards, int card_count) {
+    // Prints the cards and returns the best score of the hand
+    Hand hand;
+    init_hand(&hand);
+    for (int i = 0; i < card_count; i++) {
+        Card card = cards[i];
+        printf(" %c%c", RANK_LABELS[CARD_RANK(card) % NUM_RANKS], SUIT_LABELS[CARD_SUIT(card)]);
+        add_card_to_hand(&hand, card);
+    }
+    return score_from_hand(&hand);
+}
+
+static void print_round(const HistoryRound* round) {
+    printf("chunk %u round %u depth %u dealer", round->chunk_idx, round->round_idx, round->shoe_dealt);
+    int dealer_score = print_cards(round->dealer_cards, round->dealer_card_count);
+    printf(" (%d)\n", dealer_score);
+    
+    for (int i = 0; i < round->hand_count; i++) {
+        const HistorySeat* seat = &round->seats[i];
+        // Split hands of a seat follow each other
+        int split_hand = (i > 0 && round->seats[i - 1].seat_idx == seat->seat_idx) ||
+                         (i + 1 < round->hand_count && round->seats[i + 1].seat_idx == seat->seat_idx);
+        int hand_number = 1;
+        for (int j = i - 1; j >= 0 && round->seats[j].seat_idx == seat->seat_idx; j--) {
+            hand_number++;
+        }
+        if (split_hand) {
+            printf("  seat %d hand %d wager %u:", seat->seat_idx + 1, hand_number, seat->wager);
+        } else {
+            printf("  seat %d wager %u:", seat->seat_idx + 1, seat->wager);
+        }
+        int score = print_cards(seat->cards, seat->card_count);
+        printf(" (%d) %.*s %s %+lld\n", score, seat->decision_count, seat->decisions,
+               history_outcome_name(seat->outcome), (long long)seat->payout - (long long)seat->wager);
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* path = NULL;
+    long long limit = -1;
+    long long chunk_filter = -1;
+    int header_only = 0;
+    
+    for (int i = 1; i < argc; i++) {
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        
+        if (strcmp(argv[i], "--limit") == 0 && value) {
+            limit = atoll(value);
+            i++;
+        } else if (strcmp(argv[i], "--chunk") == 0 && value) {
+            chunk_filter = atoll(value);
+            i++;
+        } else if (strcmp(argv[i], "--header") == 0) {
+            header_only = 1;
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!path) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    HistoryFile file;
+    if (!map_history_file(&file, path)) {
+        fprintf(stderr, "Cannot read \"%s\" as a hand history\n", path);
+        return 1;
+    }
+    
+    const HistoryHeader* header = &file.header;
+    printf("Version:       %u\n", header->version);
+    printf("Seed:          %llu\n", (unsigned long long)header->seed);
+    printf("Shoe:          %u cards%s\n", header->total_cards,
+           header->auto_shuffling ? ", continuous shuffling" : "");
+    printf("Hole card:     %s\n", header->dealer_receives_hole_card ? "yes" : "no");
+    printf("Minimum wager: %u\n", header->minimum_wager);
+    printf("Blackjack:     pays %.3f\n", header->blackjack_payout_milli / 1000.0);
+    if (header_only) {
+        unmap_history_file(&file);
+        return 0;
+    }
+    
+    size_t offset = HISTORY_HEADER_SIZE;
+    long long printed = 0;
+    HistoryRound round;
+    while (offset < file.size && (limit < 0 || printed < limit)) {
+        size_t size = decode_history_round(&file.data[offset], file.size - offset, &round);
+        if (size == 0) {
+            fprintf(stderr, "Damaged record at byte %zu\n", offset);
+            unmap_history_file(&file);
+            return 1;
+        }
+        offset += size;
+        if (chunk_filter >= 0 && round.chunk_idx != (uint32_t)chunk_filter) {
+            continue;
+        }
+        print_round(&round);
+        printed++;
+    }
+    
+    unmap_history_file(&file);
+    return 0;
+}
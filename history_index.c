@@ -0,0 +1,32 @@
+/*
+ * UNIJACK - Hand history indexer entry point
+ * Builds the secondary indexes history_query reads, one LOG.idx file
+ * next to every log given.
+ */
+
+#include "query.h"
+#include "sim.h"
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s LOG...\n", argv[0]);
+        return 1;
+    }
+    
+    int failures = 0;
+    for (int i = 1; i < argc; i++) {
+        char index_path[MAX_STRING_LEN * 4];
+        snprintf(index_path, sizeof(index_path), "%s%s", argv[i], HISTORY_INDEX_SUFFIX);
+        
+        double start = sim_clock_seconds();
+        uint64_t hand_count = 0;
+        if (!build_history_index(argv[i], index_path, &hand_count)) {
+            fprintf(stderr, "Cannot index \"%s\"\n", argv[i]);
+            failures++;
+            continue;
+        }
+        printf("%s: %llu hands in %.3f s\n", index_path, (unsigned long long)hand_count,
+               sim_clock_seconds() - start);
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,174 @@
+/*
+ * UNIJACK - Hand history query entry point
+ * Answers questions about logged hands through the indexes built by
+ * history_index, printing aggregates and optionally the matching hands.
+ */
+
+#include "query.h"
+#include "sim.h"
+
+static const char RANK_LABELS[NUM_RANKS + 1] = "A23456789TJQK";
+static const char SUIT_LABELS[NUM_SUITS + 1] = "shdc";
+
+// Query listing structure - state of --list across logs
+typedef struct {
+    long long limit;
+    long long printed;
+} QueryListing;
+
+// Query aggregation structure - context of the aggregating callback
+typedef struct {
+    HistoryAggregate* aggregate;
+    const HistoryQuery* query;
+} QueryAggregation;
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s [options] LOG...\n"
+        "  --start V        starting hand total, s for soft (e.g. 16, s17, 12-16)\n"
+        "  --upcard V       dealer upcard, A or 2 to 10\n"
+        "  --outcome V      bust, lose, push, win, blackjack or surrender\n"
+        "  --depth P        percent of the shoe dealt before the round (e.g. 75, 70-80)\n"
+        "  --action V       first decision: hit, stand, double, split, surrender or none\n"
+        "  --by DIM         aggregate per value of start, upcard, outcome, depth or action\n"
+        "  --list N         print up to N matching hands\n"
+        "Values may be comma separated lists and ranges. Run history_index first.\n",
+        program);
+}
+
+static void print_cards(const uint8_t* cards, int card_count) {
+    for (int i = 0; i < card_count; i++) {
+        printf(" %c%c", RANK_LABELS[CARD_RANK(cards[i]) % NUM_RANKS], SUIT_LABELS[CARD_SUIT(cards[i])]);
+    }
+}
+
+static int print_match(void* context, const HistoryIndex* index, uint64_t hand) {
+    QueryListing* listing = (QueryListing*)context;
+    const HistoryIndexRow* row = &index->rows[hand];
+    HistoryRound round;
+    decode_history_round(&index->log.data[row->record_offset],
+                         index->log.size - row->record_offset, &round);
+    const HistorySeat* seat = &round.seats[row->hand_idx];
+    printf("chunk %u round %u seat %d:", round.chunk_idx, round.round_idx, seat->seat_idx + 1);
+    print_cards(seat->cards, seat->card_count);
+    printf(" %.*s vs", seat->decision_count, seat->decisions);
+    print_cards(round.dealer_cards, round.dealer_card_count);
+    printf(" (%d) %s %+d\n", row->dealer_score, history_outcome_name(seat->outcome), row->net);
+    return ++listing->printed < listing->limit;
+}
+
+static int aggregate_match(void* context, const HistoryIndex* index, uint64_t hand) {
+    QueryAggregation* aggregation = (QueryAggregation*)context;
+    add_to_history_aggregate(aggregation->aggregate, index, aggregation->query, hand);
+    return 1;
+}
+
+static double percent_of(long long part, long long whole) {
+    return whole > 0 ? 100.0 * (double)part / (double)whole : 0.0;
+}
+
+static void print_aggregate(const char* label, const HistoryAggregate* aggregate) {
+    const long long* counts = aggregate->outcome_counts;
+    long long hands = aggregate->hand_count;
+    printf("%-10s %12lld %12lld %7.2f %7.2f %7.2f %7.2f %7.2f %7.2f %9.4f %9.2f\n", label, hands,
+           aggregate->round_count, percent_of(counts[WIN], hands), percent_of(counts[BLACKJACK], hands),
+           percent_of(counts[PUSH], hands), percent_of(counts[LOOSE], hands),
+           percent_of(counts[BUST], hands), percent_of(counts[SURRENDER], hands),
+           hands > 0 ? (double)aggregate->net / (double)hands : 0.0,
+           percent_of(aggregate->dealer_bust_count, aggregate->round_count));
+}
+
+int main(int argc, char** argv) {
+    HistoryQuery query;
+    init_history_query(&query);
+    int group_by = -1;
+    long long list_limit = 0;
+    const char* logs[MAX_STRING_LEN];
+    int log_count = 0;
+    
+    for (int i = 1; i < argc; i++) {
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        int dimension = argv[i][0] == '-' && argv[i][1] == '-' ? find_dimension(argv[i] + 2) : -1;
+        
+        if (dimension >= 0 && value) {
+            if (!parse_history_condition(&query, dimension, value)) {
+                fprintf(stderr, "Bad %s \"%s\"\n", get_dimension_name(dimension), value);
+                return 1;
+            }
+            i++;
+        } else if (strcmp(argv[i], "--by") == 0 && value) {
+            group_by = find_dimension(value);
+            if (group_by < 0) {
+                fprintf(stderr, "Unknown dimension \"%s\"\n", value);
+                return 1;
+            }
+            i++;
+        } else if (strcmp(argv[i], "--list") == 0 && value) {
+            list_limit = atoll(value);
+            i++;
+        } else if (argv[i][0] != '-' && log_count < MAX_STRING_LEN) {
+            logs[log_count++] = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (log_count == 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    // One aggregate per value of the grouping dimension, or a single total
+    int group_count = group_by >= 0 ? get_dimension_key_count(group_by) : 1;
+    HistoryAggregate aggregates[2 * HISTORY_START_SOFT_KEY];
+    for (int g = 0; g < group_count; g++) {
+        init_history_aggregate(&aggregates[g]);
+    }
+    QueryListing listing = {list_limit, 0};
+    
+    double start = sim_clock_seconds();
+    for (int i = 0; i < log_count; i++) {
+        char index_path[MAX_STRING_LEN * 4];
+        snprintf(index_path, sizeof(index_path), "%s%s", logs[i], HISTORY_INDEX_SUFFIX);
+        HistoryIndex index;
+        if (!open_history_index(&index, logs[i], index_path)) {
+            fprintf(stderr, "No up-to-date index for \"%s\", run history_index on it\n", logs[i]);
+            return 1;
+        }
+        
+        if (listing.printed < listing.limit) {
+            run_history_query(&index, &query, print_match, &listing);
+        }
+        for (int g = 0; g < group_count; g++) {
+            // Grouping narrows the query, so each group counts its own rounds
+            HistoryQuery group_query = query;
+            if (group_by >= 0) {
+                group_query.allowed[group_by] = (query.allowed[group_by] ? query.allowed[group_by] : ~0ULL) &
+                                                (1ULL << g);
+                if (!group_query.allowed[group_by]) {
+                    continue;
+                }
+            }
+            QueryAggregation aggregation = {&aggregates[g], &group_query};
+            run_history_query(&index, &group_query, aggregate_match, &aggregation);
+        }
+        close_history_index(&index);
+    }
+    double elapsed = sim_clock_seconds() - start;
+    
+    printf("%-10s %12s %12s %7s %7s %7s %7s %7s %7s %9s %9s\n", group_by >= 0 ? get_dimension_name(group_by) : "",
+           "hands", "rounds", "win%", "bj%", "push%", "lose%", "bust%", "surr%", "net/hand", "dbust%");
+    for (int g = 0; g < group_count; g++) {
+        char label[MAX_STRING_LEN];
+        if (group_by < 0) {
+            SAFE_STRCPY(label, "all", sizeof(label));
+        } else if (aggregates[g].hand_count > 0) {
+            format_dimension_key(group_by, g, label, sizeof(label));
+        } else {
+            continue;
+        }
+        print_aggregate(label, &aggregates[g]);
+    }
+    printf("Elapsed:       %.3f s\n", elapsed);
+    return 0;
+}
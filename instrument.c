@@ -0,0 +1,213 @@
+/*
+ * UNIJACK - Hot-path instrumentation
+ * Implementation
+ */
+
+#include "instrument.h"
+
+#ifdef UNIJACK_INSTRUMENT
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Timestamps come from the TSC where there is one (a few cycles to read)
+// and are converted to nanoseconds once, when the report is written
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define INSTR_USE_TSC 1
+#else
+#define INSTR_USE_TSC 0
+#endif
+
+// Nanoseconds of clock time used to calibrate the TSC at the least
+#define INSTR_CALIBRATION_NS 10000000ULL
+
+// Instrumentation block - one per thread, linked so the report finds them all
+typedef struct InstrBlock {
+    InstrPhase phases[INSTR_PHASE_COUNT];
+    uint64_t events[INSTR_EVENT_COUNT];
+    struct InstrBlock* next;
+} InstrBlock;
+
+static const char* const PHASE_NAMES[INSTR_PHASE_COUNT] = {
+    "collect_wagers",
+    "deal_initial_cards",
+    "interact_with_player",
+    "interact_with_dealer",
+    "pay_gains",
+    "cleanup_table",
+    "round",
+};
+
+static const char* const EVENT_NAMES[INSTR_EVENT_COUNT] = {
+    "shuffles",
+    "reloads",
+    "cards_drawn",
+    "score_calls",
+};
+
+static pthread_mutex_t g_instr_lock = PTHREAD_MUTEX_INITIALIZER;
+static InstrBlock* g_instr_blocks = NULL;
+static int g_instr_block_count = 0;
+static uint64_t g_start_ticks = 0;
+static uint64_t g_start_ns = 0;
+static __thread InstrBlock* t_instr_block = NULL;
+
+// ============================================================================
+// CLOCK OPERATIONS
+// ============================================================================
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t instr_ticks(void) {
+#if INSTR_USE_TSC
+    return __rdtsc();
+#else
+    return monotonic_ns();
+#endif
+}
+
+static double ticks_per_ns(void) {
+#if INSTR_USE_TSC
+    // Rate over the whole run so far, stretched to the minimum if it was short
+    uint64_t ns = monotonic_ns();
+    while (ns - g_start_ns < INSTR_CALIBRATION_NS) {
+        ns = monotonic_ns();
+    }
+    return (double)(instr_ticks() - g_start_ticks) / (double)(ns - g_start_ns);
+#else
+    return 1.0;
+#endif
+}
+
+// ============================================================================
+// RECORDING OPERATIONS
+// ============================================================================
+static InstrBlock* get_thread_block(void) {
+    if (!t_instr_block) {
+        InstrBlock* block = calloc(1, sizeof(InstrBlock));
+        if (!block) {
+            abort();  // Instrumented builds are diagnostic, do not hide data loss
+        }
+        pthread_mutex_lock(&g_instr_lock);
+        if (!g_instr_blocks) {
+            g_start_ns = monotonic_ns();
+            g_start_ticks = instr_ticks();
+        }
+        block->next = g_instr_blocks;
+        g_instr_blocks = block;
+        g_instr_block_count++;
+        pthread_mutex_unlock(&g_instr_lock);
+        t_instr_block = block;
+    }
+    return t_instr_block;
+}
+
+static int bucket_of(uint64_t ticks) {
+    // Bucket b holds durations in [2^(b-1), 2^b) ticks, bucket 0 holds 0
+    int bucket = ticks ? 64 - __builtin_clzll(ticks) : 0;
+    return bucket < INSTR_BUCKET_COUNT ? bucket : INSTR_BUCKET_COUNT - 1;
+}
+
+void instr_record_phase(int phase, uint64_t start_ticks) {
+    uint64_t ticks = instr_ticks() - start_ticks;
+    InstrPhase* timer = &get_thread_block()->phases[phase];
+    timer->count++;
+    timer->total_ticks += ticks;
+    if (ticks > timer->max_ticks) {
+        timer->max_ticks = ticks;
+    }
+    timer->buckets[bucket_of(ticks)]++;
+}
+
+void instr_count_event(int event) {
+    get_thread_block()->events[event]++;
+}
+
+// ============================================================================
+// REPORT OPERATIONS
+// ============================================================================
+static double bucket_limit_ns(int bucket, double rate) {
+    return bucket ? (double)(1ULL << bucket) / rate : 0.0;
+}
+
+static double percentile_ns(const InstrPhase* timer, double fraction, double rate) {
+    // Upper bound of the bucket holding the requested rank
+    uint64_t rank = (uint64_t)(fraction * (double)timer->count);
+    uint64_t seen = 0;
+    for (int b = 0; b < INSTR_BUCKET_COUNT; b++) {
+        seen += timer->buckets[b];
+        if (seen > rank) {
+            return bucket_limit_ns(b, rate);
+        }
+    }
+    return bucket_limit_ns(INSTR_BUCKET_COUNT - 1, rate);
+}
+
+int write_instrument_report(FILE* stream) {
+    // Called once worker threads are done, their blocks are summed here
+    InstrPhase phases[INSTR_PHASE_COUNT] = {{0}};
+    uint64_t events[INSTR_EVENT_COUNT] = {0};
+    
+    pthread_mutex_lock(&g_instr_lock);
+    for (InstrBlock* block = g_instr_blocks; block; block = block->next) {
+        for (int p = 0; p < INSTR_PHASE_COUNT; p++) {
+            phases[p].count += block->phases[p].count;
+            phases[p].total_ticks += block->phases[p].total_ticks;
+            if (block->phases[p].max_ticks > phases[p].max_ticks) {
+                phases[p].max_ticks = block->phases[p].max_ticks;
+            }
+            for (int b = 0; b < INSTR_BUCKET_COUNT; b++) {
+                phases[p].buckets[b] += block->phases[p].buckets[b];
+            }
+        }
+        for (int e = 0; e < INSTR_EVENT_COUNT; e++) {
+            events[e] += block->events[e];
+        }
+    }
+    int thread_count = g_instr_block_count;
+    double rate = g_instr_blocks ? ticks_per_ns() : 1.0;
+    pthread_mutex_unlock(&g_instr_lock);
+    
+    fprintf(stream, "{\n");
+    fprintf(stream, "  \"clock\": \"%s\",\n", INSTR_USE_TSC ? "tsc" : "monotonic");
+    fprintf(stream, "  \"ticks_per_ns\": %.6f,\n", rate);
+    fprintf(stream, "  \"threads\": %d,\n", thread_count);
+    fprintf(stream, "  \"events\": {");
+    for (int e = 0; e < INSTR_EVENT_COUNT; e++) {
+        fprintf(stream, "%s\"%s\": %llu", e ? ", " : "", EVENT_NAMES[e], (unsigned long long)events[e]);
+    }
+    fprintf(stream, "},\n");
+    fprintf(stream, "  \"phases\": [\n");
+    for (int p = 0; p < INSTR_PHASE_COUNT; p++) {
+        const InstrPhase* timer = &phases[p];
+        double total_ns = (double)timer->total_ticks / rate;
+        fprintf(stream,
+                "    {\"name\": \"%s\", \"count\": %llu, \"total_ns\": %.0f, \"mean_ns\": %.1f, "
+                "\"max_ns\": %.1f, \"p50_ns\": %.1f, \"p90_ns\": %.1f, \"p99_ns\": %.1f,\n",
+                PHASE_NAMES[p], (unsigned long long)timer->count, total_ns,
+                timer->count ? total_ns / (double)timer->count : 0.0,
+                (double)timer->max_ticks / rate,
+                percentile_ns(timer, 0.50, rate), percentile_ns(timer, 0.90, rate),
+                percentile_ns(timer, 0.99, rate));
+        fprintf(stream, "     \"histogram\": [");
+        int first = 1;
+        for (int b = 0; b < INSTR_BUCKET_COUNT; b++) {
+            if (timer->buckets[b] == 0) {
+                continue;
+            }
+            fprintf(stream, "%s{\"le_ns\": %.1f, \"count\": %llu}", first ? "" : ", ",
+                    bucket_limit_ns(b, rate), (unsigned long long)timer->buckets[b]);
+            first = 0;
+        }
+        fprintf(stream, "]}%s\n", p + 1 < INSTR_PHASE_COUNT ? "," : "");
+    }
+    fprintf(stream, "  ]\n}\n");
+    return ferror(stream) ? 0 : 1;
+}
+
+#endif // UNIJACK_INSTRUMENT
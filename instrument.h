@@ -0,0 +1,64 @@
+/*
+ * UNIJACK - Hot-path instrumentation
+ * Per-phase timers and event counters for the round loop, reported as JSON.
+ * Everything compiles to nothing unless UNIJACK_INSTRUMENT is defined.
+ */
+
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Timed phases of a round; the waits for wagers and for each seat's
+// turn run from the question to the last answer
+#define INSTR_PHASE_COLLECT_WAGERS 0
+#define INSTR_PHASE_DEAL_INITIAL_CARDS 1
+#define INSTR_PHASE_INTERACT_WITH_PLAYER 2
+#define INSTR_PHASE_INTERACT_WITH_DEALER 3
+#define INSTR_PHASE_PAY_GAINS 4
+#define INSTR_PHASE_CLEANUP_TABLE 5
+#define INSTR_PHASE_ROUND 6
+#define INSTR_PHASE_COUNT 7
+
+// Counted events
+#define INSTR_EVENT_SHUFFLE 0
+#define INSTR_EVENT_RELOAD 1
+#define INSTR_EVENT_DRAW 2
+#define INSTR_EVENT_SCORE 3
+#define INSTR_EVENT_COUNT 4
+
+// Latency histograms have one bucket per power of two nanoseconds
+#define INSTR_BUCKET_COUNT 64
+
+#ifdef UNIJACK_INSTRUMENT
+
+// Phase timer structure - one per phase and thread, summed in the report
+typedef struct {
+    uint64_t count;
+    uint64_t total_ticks;
+    uint64_t max_ticks;
+    uint64_t buckets[INSTR_BUCKET_COUNT];
+} InstrPhase;
+
+// Function declarations - Instrumentation operations
+uint64_t instr_ticks(void);
+void instr_record_phase(int phase, uint64_t start_ticks);
+void instr_count_event(int event);
+int write_instrument_report(FILE* stream);
+
+#define INSTR_ENABLED 1
+#define INSTR_PHASE_BEGIN(name) uint64_t instr_start_##name = instr_ticks()
+#define INSTR_PHASE_END(name, phase) instr_record_phase(phase, instr_start_##name)
+#define INSTR_EVENT(event) instr_count_event(event)
+
+#else
+
+#define INSTR_ENABLED 0
+#define INSTR_PHASE_BEGIN(name) ((void)0)
+#define INSTR_PHASE_END(name, phase) ((void)0)
+#define INSTR_EVENT(event) ((void)0)
+
+#endif // UNIJACK_INSTRUMENT
+
+#endif // INSTRUMENT_H
@@ -0,0 +1,729 @@
+/*
+ * UNIJACK - Table server load generator
+ * Opens many bot connections to a local table_server, plays with a
+ * configurable think time and reports decision latency, rounds per table
+ * and error counts, for capacity planning on a single machine.
+ */
+
+#define _GNU_SOURCE     // SOCK_NONBLOCK and SOCK_CLOEXEC
+#include "server.h"
+
+#include <errno.h>
+#include <math.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define LOAD_DEFAULT_BOTS 1000
+#define LOAD_DEFAULT_SECONDS 10.0
+#define LOAD_DEFAULT_HIT_BELOW 17
+#define LOAD_MAX_THREADS 64
+#define LOAD_EVENT_BATCH 512
+#define LOAD_READ_SIZE 4096
+#define LOAD_RECONNECT_MS 100
+
+// Latency histogram: 8 linear sub-buckets per power of two nanoseconds,
+// so percentiles are within 12.5% of the exact value
+#define LATENCY_SUB_BITS 3
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+#define LATENCY_BUCKET_COUNT ((64 - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS)
+
+// Think time distributions
+#define THINK_FIXED 0
+#define THINK_UNIFORM 1
+#define THINK_EXPONENTIAL 2
+
+// Bot states
+#define BOT_IDLE 0              // Waiting to (re)connect
+#define BOT_CONNECTING 1
+#define BOT_CONNECTED 2
+
+// Load configuration structure
+typedef struct {
+    const char* host;
+    int port;
+    const char* unix_path;      // Used instead of TCP when set
+    int bot_count;
+    int thread_count;
+    double seconds;
+    int think_kind;
+    double think_a_ms;          // Fixed or mean time, or uniform minimum
+    double think_b_ms;          // Uniform maximum
+    int wager;                  // 0 = table minimum
+    int hit_below;
+    uint64_t seed;
+} LoadConfig;
+
+// Load statistics structure - per thread, summed in the report
+typedef struct {
+    long long connect_count;
+    long long connect_error_count;
+    long long drop_count;       // Connections the server closed unasked
+    long long broke_count;
+    long long answer_count;
+    long long timeout_count;    // Questions asked again before the answer, a lower bound
+    long long error_count;      // ERROR lines received
+    long long latency_count;
+    double latency_total_ns;
+    uint64_t latency_max_ns;
+    uint64_t latency_buckets[LATENCY_BUCKET_COUNT];
+} LoadStats;
+
+// Load bot structure - one connection and its pending answer
+typedef struct LoadBot {
+    int fd;
+    int state;
+    int table_id;
+    int minimum_wager;
+    int64_t due_ns;             // When the pending answer or reconnect is due
+    int heap_idx;               // Position in the timer heap, -1 = none
+    int has_answer;
+    int64_t action_sent_ns;     // Last ACT, until the next line arrives
+    int input_length;
+    char answer[SERVER_MAX_LINE];
+    char input[SERVER_MAX_LINE];
+} LoadBot;
+
+// Load table structure - what a thread saw of one server table
+// Rounds are counted from the results of one bot per table, as results of
+// other bots may be read after the next round has already been dealt.
+typedef struct {
+    long long round_count;
+    LoadBot* counting_bot;
+} LoadTable;
+
+// Load thread structure
+typedef struct {
+    const LoadConfig* config;
+    pthread_t thread;
+    int epoll_fd;
+    LoadBot* bots;
+    int bot_count;
+    LoadBot** heap;
+    int heap_count;
+    LoadTable* tables;
+    int table_capacity;
+    Rng rng;
+    LoadStats stats;
+} LoadThread;
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int latency_bucket(uint64_t ns) {
+    if (ns < LATENCY_SUB_BUCKETS) {
+        return (int)ns;
+    }
+    int exponent = 63 - __builtin_clzll(ns);
+    int sub = (int)((ns >> (exponent - LATENCY_SUB_BITS)) & (LATENCY_SUB_BUCKETS - 1));
+    return (exponent - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS + sub;
+}
+
+static double latency_bucket_limit_ns(int bucket) {
+    // Upper bound of a bucket, the start of the next one
+    bucket++;
+    if (bucket < LATENCY_SUB_BUCKETS) {
+        return (double)bucket;
+    }
+    int exponent = bucket / LATENCY_SUB_BUCKETS + LATENCY_SUB_BITS - 1;
+    int sub = bucket % LATENCY_SUB_BUCKETS;
+    return ldexp((double)(LATENCY_SUB_BUCKETS + sub), exponent - LATENCY_SUB_BITS);
+}
+
+static double latency_percentile_ns(const LoadStats* stats, double fraction) {
+    long long rank = (long long)ceil(fraction * (double)stats->latency_count);
+    long long seen = 0;
+    for (int b = 0; b < LATENCY_BUCKET_COUNT; b++) {
+        seen += (long long)stats->latency_buckets[b];
+        if (seen >= rank && seen > 0) {
+            double limit = latency_bucket_limit_ns(b);
+            return limit < (double)stats->latency_max_ns ? limit : (double)stats->latency_max_ns;
+        }
+    }
+    return 0.0;
+}
+
+static void format_duration(double ns, char* buffer, size_t buffer_size) {
+    if (ns < 1e3) {
+        snprintf(buffer, buffer_size, "%.0f ns", ns);
+    } else if (ns < 1e6) {
+        snprintf(buffer, buffer_size, "%.1f us", ns / 1e3);
+    } else {
+        snprintf(buffer, buffer_size, "%.2f ms", ns / 1e6);
+    }
+}
+
+static int parse_think_time(LoadConfig* config, const char* text) {
+    // fixed:MS, uniform:MIN-MAX, exp:MEAN, or a bare number of milliseconds
+    if (strncmp(text, "uniform:", 8) == 0) {
+        config->think_kind = THINK_UNIFORM;
+        return sscanf(text + 8, "%lf-%lf", &config->think_a_ms, &config->think_b_ms) == 2 &&
+               config->think_a_ms >= 0.0 && config->think_b_ms >= config->think_a_ms;
+    }
+    if (strncmp(text, "exp:", 4) == 0) {
+        config->think_kind = THINK_EXPONENTIAL;
+        return sscanf(text + 4, "%lf", &config->think_a_ms) == 1 && config->think_a_ms >= 0.0;
+    }
+    config->think_kind = THINK_FIXED;
+    const char* number = strncmp(text, "fixed:", 6) == 0 ? text + 6 : text;
+    return sscanf(number, "%lf", &config->think_a_ms) == 1 && config->think_a_ms >= 0.0;
+}
+
+static int64_t draw_think_ns(LoadThread* thread) {
+    const LoadConfig* config = thread->config;
+    double ms = config->think_a_ms;
+    if (config->think_kind == THINK_UNIFORM) {
+        ms += (config->think_b_ms - config->think_a_ms) * rng_uniform(&thread->rng);
+    } else if (config->think_kind == THINK_EXPONENTIAL) {
+        ms *= -log(1.0 - rng_uniform(&thread->rng));
+    }
+    return (int64_t)(ms * 1e6);
+}
+
+// ============================================================================
+// TIMER HEAP
+// ============================================================================
+static void swap_heap_entries(LoadThread* thread, int a, int b) {
+    LoadBot* bot = thread->heap[a];
+    thread->heap[a] = thread->heap[b];
+    thread->heap[b] = bot;
+    thread->heap[a]->heap_idx = a;
+    thread->heap[b]->heap_idx = b;
+}
+
+static void sift_heap(LoadThread* thread, int idx) {
+    while (idx > 0 && thread->heap[(idx - 1) / 2]->due_ns > thread->heap[idx]->due_ns) {
+        swap_heap_entries(thread, idx, (idx - 1) / 2);
+        idx = (idx - 1) / 2;
+    }
+    while (1) {
+        int smallest = idx;
+        for (int child = 2 * idx + 1; child <= 2 * idx + 2 && child < thread->heap_count; child++) {
+            if (thread->heap[child]->due_ns < thread->heap[smallest]->due_ns) {
+                smallest = child;
+            }
+        }
+        if (smallest == idx) {
+            return;
+        }
+        swap_heap_entries(thread, idx, smallest);
+        idx = smallest;
+    }
+}
+
+static void schedule_bot(LoadThread* thread, LoadBot* bot, int64_t due_ns) {
+    bot->due_ns = due_ns;
+    if (bot->heap_idx < 0) {
+        bot->heap_idx = thread->heap_count;
+        thread->heap[thread->heap_count++] = bot;
+    }
+    sift_heap(thread, bot->heap_idx);
+}
+
+static void unschedule_bot(LoadThread* thread, LoadBot* bot) {
+    int idx = bot->heap_idx;
+    if (idx < 0) {
+        return;
+    }
+    swap_heap_entries(thread, idx, --thread->heap_count);
+    bot->heap_idx = -1;
+    if (idx < thread->heap_count) {
+        sift_heap(thread, idx);
+    }
+}
+
+// ============================================================================
+// BOT OPERATIONS
+// ============================================================================
+static LoadTable* get_load_table(LoadThread* thread, int table_id) {
+    if (table_id < 0) {
+        return NULL;
+    }
+    if (table_id >= thread->table_capacity) {
+        int capacity = safe_max(table_id + 1, 2 * thread->table_capacity);
+        LoadTable* tables = realloc(thread->tables, (size_t)capacity * sizeof(LoadTable));
+        if (!tables) {
+            return NULL;
+        }
+        memset(tables + thread->table_capacity, 0,
+               (size_t)(capacity - thread->table_capacity) * sizeof(LoadTable));
+        thread->tables = tables;
+        thread->table_capacity = capacity;
+    }
+    return &thread->tables[table_id];
+}
+
+static void connect_bot(LoadThread* thread, LoadBot* bot) {
+    const LoadConfig* config = thread->config;
+    struct sockaddr_storage address;
+    socklen_t address_size;
+    memset(&address, 0, sizeof(address));
+    if (config->unix_path) {
+        struct sockaddr_un* unix_address = (struct sockaddr_un*)&address;
+        unix_address->sun_family = AF_UNIX;
+        SAFE_STRCPY(unix_address->sun_path, config->unix_path, sizeof(unix_address->sun_path));
+        address_size = sizeof(struct sockaddr_un);
+    } else {
+        struct sockaddr_in* inet_address = (struct sockaddr_in*)&address;
+        inet_address->sin_family = AF_INET;
+        inet_address->sin_port = htons((uint16_t)config->port);
+        inet_pton(AF_INET, config->host, &inet_address->sin_addr);
+        address_size = sizeof(struct sockaddr_in);
+    }
+    
+    bot->fd = socket(address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    bot->table_id = -1;
+    bot->has_answer = 0;
+    bot->action_sent_ns = 0;
+    bot->input_length = 0;
+    if (bot->fd >= 0 && !config->unix_path) {
+        int on = 1;
+        setsockopt(bot->fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+    
+    // Completion of a non-blocking connect shows up as EPOLLOUT
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT;
+    event.data.ptr = bot;
+    if (bot->fd < 0 ||
+        (connect(bot->fd, (struct sockaddr*)&address, address_size) < 0 && errno != EINPROGRESS) ||
+        epoll_ctl(thread->epoll_fd, EPOLL_CTL_ADD, bot->fd, &event) < 0) {
+        thread->stats.connect_error_count++;
+        if (bot->fd >= 0) {
+            close(bot->fd);
+        }
+        bot->fd = -1;
+        bot->state = BOT_IDLE;
+        schedule_bot(thread, bot, now_ns() + LOAD_RECONNECT_MS * 1000000LL);
+        return;
+    }
+    bot->state = BOT_CONNECTING;
+}
+
+static void drop_bot(LoadThread* thread, LoadBot* bot) {
+    // Closed by either side; the bot takes a new seat shortly after
+    LoadTable* table = get_load_table(thread, bot->table_id);
+    if (table && table->counting_bot == bot) {
+        table->counting_bot = NULL;
+    }
+    unschedule_bot(thread, bot);
+    close(bot->fd);
+    bot->fd = -1;
+    bot->state = BOT_IDLE;
+    schedule_bot(thread, bot, now_ns() + LOAD_RECONNECT_MS * 1000000LL);
+}
+
+static void send_answer(LoadThread* thread, LoadBot* bot) {
+    size_t length = strlen(bot->answer);
+    bot->has_answer = 0;
+    if (send(bot->fd, bot->answer, length, MSG_NOSIGNAL) != (ssize_t)length) {
+        thread->stats.drop_count++;
+        drop_bot(thread, bot);
+        return;
+    }
+    thread->stats.answer_count++;
+    if (bot->answer[0] == 'A') {
+        bot->action_sent_ns = now_ns();
+    }
+}
+
+static void queue_answer(LoadThread* thread, LoadBot* bot, const char* format, ...) {
+    // A new question while the last answer is still being thought about
+    // means the server's timeout already answered it
+    if (bot->has_answer) {
+        thread->stats.timeout_count++;
+    }
+    va_list args;
+    va_start(args, format);
+    vsnprintf(bot->answer, sizeof(bot->answer), format, args);
+    va_end(args);
+    bot->has_answer = 1;
+    
+    int64_t think_ns = draw_think_ns(thread);
+    if (think_ns <= 0) {
+        unschedule_bot(thread, bot);
+        send_answer(thread, bot);
+    } else {
+        schedule_bot(thread, bot, now_ns() + think_ns);
+    }
+}
+
+static void record_latency(LoadStats* stats, uint64_t ns) {
+    stats->latency_buckets[latency_bucket(ns)]++;
+    stats->latency_count++;
+    stats->latency_total_ns += (double)ns;
+    if (ns > stats->latency_max_ns) {
+        stats->latency_max_ns = ns;
+    }
+}
+
+static void handle_bot_line(LoadThread* thread, LoadBot* bot, char* line) {
+    const LoadConfig* config = thread->config;
+    char* words[8];
+    int word_count = 0;
+    for (char* word = strtok(line, " "); word && word_count < 8; word = strtok(NULL, " ")) {
+        words[word_count++] = word;
+    }
+    if (word_count == 0) {
+        return;
+    }
+    
+    // Decision latency: an ACT answered right away by the seat's next TURN
+    int64_t action_sent_ns = bot->action_sent_ns;
+    bot->action_sent_ns = 0;
+    if (action_sent_ns && strcmp(words[0], "TURN") == 0) {
+        record_latency(&thread->stats, (uint64_t)(now_ns() - action_sent_ns));
+    }
+    
+    LoadTable* table = get_load_table(thread, bot->table_id);
+    if (strcmp(words[0], "WELCOME") == 0 && word_count >= 5) {
+        bot->table_id = atoi(words[1]);
+        bot->minimum_wager = atoi(words[4]);
+    } else if (strcmp(words[0], "BET") == 0 && word_count >= 4) {
+        int wager = config->wager > 0 ? config->wager : bot->minimum_wager;
+        queue_answer(thread, bot, "BET %s %d\n", words[1], safe_min(wager, atoi(words[3])));
+    } else if (strcmp(words[0], "INSURANCE") == 0 && word_count >= 2) {
+        queue_answer(thread, bot, "INSURE %s n\n", words[1]);
+    } else if (strcmp(words[0], "TURN") == 0 && word_count >= 5) {
+        char action = atoi(words[3]) < config->hit_below ? 'h' : 's';
+        queue_answer(thread, bot, "ACT %s %c\n", words[1], action);
+    } else if (strcmp(words[0], "RESULT") == 0) {
+        if (bot->has_answer) {
+            thread->stats.timeout_count++;
+            bot->has_answer = 0;
+            unschedule_bot(thread, bot);
+        }
+        if (table && !table->counting_bot) {
+            table->counting_bot = bot;
+        }
+        if (table && table->counting_bot == bot) {
+            table->round_count++;
+        }
+    } else if (strcmp(words[0], "ERROR") == 0) {
+        thread->stats.error_count++;
+    } else if (strcmp(words[0], "BYE") == 0) {
+        if (word_count >= 2 && strcmp(words[1], "broke") == 0) {
+            thread->stats.broke_count++;
+        } else {
+            thread->stats.drop_count++;
+        }
+        drop_bot(thread, bot);
+    }
+}
+
+static void read_bot(LoadThread* thread, LoadBot* bot) {
+    char buffer[LOAD_READ_SIZE];
+    ssize_t result = recv(bot->fd, buffer, sizeof(buffer), 0);
+    if (result <= 0) {
+        if (result == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            thread->stats.drop_count++;
+            drop_bot(thread, bot);
+        }
+        return;
+    }
+    
+    for (ssize_t i = 0; i < result && bot->state == BOT_CONNECTED; i++) {
+        if (buffer[i] == '\n') {
+            bot->input[bot->input_length] = '\0';
+            bot->input_length = 0;
+            handle_bot_line(thread, bot, bot->input);
+        } else if (bot->input_length < SERVER_MAX_LINE - 1) {
+            bot->input[bot->input_length++] = buffer[i];
+        }
+    }
+}
+
+static void finish_connect(LoadThread* thread, LoadBot* bot) {
+    int error = 0;
+    socklen_t error_size = sizeof(error);
+    if (getsockopt(bot->fd, SOL_SOCKET, SO_ERROR, &error, &error_size) < 0 || error != 0) {
+        thread->stats.connect_error_count++;
+        drop_bot(thread, bot);
+        return;
+    }
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = bot;
+    epoll_ctl(thread->epoll_fd, EPOLL_CTL_MOD, bot->fd, &event);
+    bot->state = BOT_CONNECTED;
+    thread->stats.connect_count++;
+}
+
+// ============================================================================
+// THREAD OPERATIONS
+// ============================================================================
+static void* load_thread_main(void* argument) {
+    LoadThread* thread = (LoadThread*)argument;
+    struct epoll_event events[LOAD_EVENT_BATCH];
+    for (int i = 0; i < thread->bot_count; i++) {
+        connect_bot(thread, &thread->bots[i]);
+    }
+    
+    int64_t end_ns = now_ns() + (int64_t)(thread->config->seconds * 1e9);
+    int64_t now = now_ns();
+    while (now < end_ns) {
+        int64_t wait_ns = end_ns - now;
+        if (thread->heap_count > 0 && thread->heap[0]->due_ns - now < wait_ns) {
+            wait_ns = thread->heap[0]->due_ns - now;
+        }
+        int wait_ms = wait_ns > 0 ? (int)((wait_ns + 999999) / 1000000) : 0;
+        int event_count = epoll_wait(thread->epoll_fd, events, LOAD_EVENT_BATCH, wait_ms);
+        
+        for (int i = 0; i < event_count; i++) {
+            LoadBot* bot = (LoadBot*)events[i].data.ptr;
+            if (bot->state == BOT_CONNECTING) {
+                finish_connect(thread, bot);
+            } else if (bot->state == BOT_CONNECTED && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                read_bot(thread, bot);
+            }
+        }
+        
+        // Answers whose think time is over, and bots due to reconnect
+        now = now_ns();
+        while (thread->heap_count > 0 && thread->heap[0]->due_ns <= now) {
+            LoadBot* bot = thread->heap[0];
+            unschedule_bot(thread, bot);
+            if (bot->state == BOT_IDLE) {
+                connect_bot(thread, bot);
+            } else if (bot->state == BOT_CONNECTED && bot->has_answer) {
+                send_answer(thread, bot);
+            }
+        }
+        now = now_ns();
+    }
+    
+    for (int i = 0; i < thread->bot_count; i++) {
+        if (thread->bots[i].fd >= 0) {
+            close(thread->bots[i].fd);
+        }
+    }
+    return NULL;
+}
+
+static void merge_load_stats(LoadStats* into, const LoadStats* from) {
+    into->connect_count += from->connect_count;
+    into->connect_error_count += from->connect_error_count;
+    into->drop_count += from->drop_count;
+    into->broke_count += from->broke_count;
+    into->answer_count += from->answer_count;
+    into->timeout_count += from->timeout_count;
+    into->error_count += from->error_count;
+    into->latency_count += from->latency_count;
+    into->latency_total_ns += from->latency_total_ns;
+    if (from->latency_max_ns > into->latency_max_ns) {
+        into->latency_max_ns = from->latency_max_ns;
+    }
+    for (int b = 0; b < LATENCY_BUCKET_COUNT; b++) {
+        into->latency_buckets[b] += from->latency_buckets[b];
+    }
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void print_report(const LoadConfig* config, LoadThread* threads) {
+    LoadStats stats;
+    memset(&stats, 0, sizeof(stats));
+    int table_capacity = 0;
+    for (int t = 0; t < config->thread_count; t++) {
+        merge_load_stats(&stats, &threads[t].stats);
+        table_capacity = safe_max(table_capacity, threads[t].table_capacity);
+    }
+    
+    // A table's bots may be spread over threads, which all saw its rounds
+    double* rates = malloc((size_t)safe_max(table_capacity, 1) * sizeof(double));
+    int table_count = 0;
+    long long round_count = 0;
+    for (int id = 0; rates && id < table_capacity; id++) {
+        long long rounds = 0;
+        for (int t = 0; t < config->thread_count; t++) {
+            if (id < threads[t].table_capacity && threads[t].tables[id].round_count > rounds) {
+                rounds = threads[t].tables[id].round_count;
+            }
+        }
+        if (rounds > 0) {
+            rates[table_count++] = (double)rounds / config->seconds;
+            round_count += rounds;
+        }
+    }
+    
+    printf("Bots:          %d on %d threads for %.1f s\n", config->bot_count, config->thread_count,
+           config->seconds);
+    printf("Connections:   %lld (%lld failed, %lld dropped, %lld went broke)\n", stats.connect_count,
+           stats.connect_error_count, stats.drop_count, stats.broke_count);
+    printf("Answers:       %lld (at least %lld timed out, %lld errors)\n", stats.answer_count,
+           stats.timeout_count, stats.error_count);
+    printf("Rounds:        %lld (%.0f/s) on %d tables\n", round_count, (double)round_count / config->seconds,
+           table_count);
+    if (rates && table_count > 0) {
+        qsort(rates, (size_t)table_count, sizeof(double), compare_doubles);
+        printf("Per table:     %.2f rounds/s median, min %.2f, max %.2f\n", rates[table_count / 2], rates[0],
+               rates[table_count - 1]);
+    }
+    free(rates);
+    
+    if (stats.latency_count > 0) {
+        static const double FRACTIONS[5] = {0.50, 0.90, 0.99, 0.999, 1.0};
+        static const char* const LABELS[5] = {"p50", "p90", "p99", "p99.9", "max"};
+        printf("Decisions:     %lld timed, mean ", stats.latency_count);
+        char text[32];
+        format_duration(stats.latency_total_ns / (double)stats.latency_count, text, sizeof(text));
+        printf("%s\n", text);
+        printf("Latency:      ");
+        for (int i = 0; i < 5; i++) {
+            format_duration(i == 4 ? (double)stats.latency_max_ns : latency_percentile_ns(&stats, FRACTIONS[i]),
+                            text, sizeof(text));
+            printf(" %s %s%s", LABELS[i], text, i < 4 ? "," : "\n");
+        }
+    }
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --host A         server address (default: 127.0.0.1)\n"
+        "  --port N         server port (default: %d)\n"
+        "  --unix PATH      connect to a Unix socket instead\n"
+        "  --bots N         connections to open (default: %d)\n"
+        "  --threads N      event loops (default: 1)\n"
+        "  --seconds S      run time (default: %.0f)\n"
+        "  --think T        think time in ms: N, fixed:N, uniform:MIN-MAX or exp:MEAN\n"
+        "                   (default: 0)\n"
+        "  --wager N        chips per round (default: table minimum)\n"
+        "  --hit-below N    hit while the hand scores less (default: %d)\n"
+        "  --seed N         think time seed (default: current time)\n",
+        program, SERVER_DEFAULT_PORT, LOAD_DEFAULT_BOTS, LOAD_DEFAULT_SECONDS, LOAD_DEFAULT_HIT_BELOW);
+}
+
+int main(int argc, char** argv) {
+#ifdef UNIVAC
+    init_bss();
+#endif
+
+    LoadConfig config;
+    memset(&config, 0, sizeof(config));
+    config.host = "127.0.0.1";
+    config.port = SERVER_DEFAULT_PORT;
+    config.bot_count = LOAD_DEFAULT_BOTS;
+    config.thread_count = 1;
+    config.seconds = LOAD_DEFAULT_SECONDS;
+    config.think_kind = THINK_FIXED;
+    config.hit_below = LOAD_DEFAULT_HIT_BELOW;
+    config.seed = (uint64_t)time(NULL);
+    
+    for (int i = 1; i < argc; i++) {
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        
+        if (strcmp(argv[i], "--host") == 0 && value) {
+            config.host = value;
+            i++;
+        } else if (strcmp(argv[i], "--port") == 0 && value) {
+            config.port = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--unix") == 0 && value) {
+            config.unix_path = value;
+            i++;
+        } else if (strcmp(argv[i], "--bots") == 0 && value) {
+            config.bot_count = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--threads") == 0 && value) {
+            config.thread_count = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--seconds") == 0 && value) {
+            config.seconds = atof(value);
+            i++;
+        } else if (strcmp(argv[i], "--think") == 0 && value) {
+            if (!parse_think_time(&config, value)) {
+                fprintf(stderr, "Bad think time \"%s\"\n", value);
+                return 1;
+            }
+            i++;
+        } else if (strcmp(argv[i], "--wager") == 0 && value) {
+            config.wager = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--hit-below") == 0 && value) {
+            config.hit_below = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--seed") == 0 && value) {
+            config.seed = strtoull(value, NULL, 10);
+            i++;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    struct in_addr probe;
+    if (config.bot_count <= 0 || config.thread_count <= 0 || config.thread_count > LOAD_MAX_THREADS ||
+        config.seconds <= 0.0 || config.wager < 0 ||
+        (!config.unix_path && inet_pton(AF_INET, config.host, &probe) != 1) ||
+        (config.unix_path && strlen(config.unix_path) >= sizeof(((struct sockaddr_un*)0)->sun_path))) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    // Every bot is a socket
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    
+    LoadThread* threads = calloc((size_t)config.thread_count, sizeof(LoadThread));
+    LoadBot* bots = calloc((size_t)config.bot_count, sizeof(LoadBot));
+    LoadBot** heap = calloc((size_t)config.bot_count, sizeof(LoadBot*));
+    if (!threads || !bots || !heap) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    
+    // Bots are split evenly, each thread with its own think time stream
+    Rng master;
+    rng_seed(&master, config.seed);
+    int first_bot = 0;
+    for (int t = 0; t < config.thread_count; t++) {
+        LoadThread* thread = &threads[t];
+        thread->config = &config;
+        thread->bots = &bots[first_bot];
+        thread->heap = &heap[first_bot];
+        thread->bot_count = config.bot_count / config.thread_count + (t < config.bot_count % config.thread_count);
+        for (int i = 0; i < thread->bot_count; i++) {
+            thread->bots[i].fd = -1;
+            thread->bots[i].heap_idx = -1;
+        }
+        first_bot += thread->bot_count;
+        rng_split(&master, &thread->rng);
+        thread->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (thread->epoll_fd < 0 || pthread_create(&thread->thread, NULL, load_thread_main, thread) != 0) {
+            fprintf(stderr, "Cannot start load thread %d\n", t);
+            return 1;
+        }
+    }
+    for (int t = 0; t < config.thread_count; t++) {
+        pthread_join(threads[t].thread, NULL);
+        close(threads[t].epoll_fd);
+    }
+    
+    print_report(&config, threads);
+    for (int t = 0; t < config.thread_count; t++) {
+        free(threads[t].tables);
+    }
+    free(threads);
+    free(bots);
+    free(heap);
+    return 0;
+}
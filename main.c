@@ -0,0 +1,51 @@
+/*
+ * UNIJACK - Text-based Blackjack Game
+ * Interactive console entry point
+ */
+
+#include "blackjack.h"
+
+// ============================================================================
+// MAIN ENTRY POINT
+// ============================================================================
+int main(void) {
+#ifndef UNIVAC
+    console_setup();
+#endif
+
+#ifdef UNIVAC
+    init_bss();
+#endif
+    
+    // Default to American ruleset
+    Ruleset ruleset;
+    init_american_ruleset(&ruleset);
+    
+    // Default player
+    Table table;
+    init_table(&table, &ruleset, (uint64_t)time(NULL));
+    
+    // Get player name
+    char player_name[MAX_NAME_LEN];
+    printf("Enter player name: ");
+    if (fgets(player_name, sizeof(player_name), stdin)) {
+        size_t len = strlen(player_name);
+        if (len > 0 && player_name[len - 1] == '\n') {
+            player_name[len - 1] = '\0';
+        }
+    }
+    if (strlen(player_name) == 0) {
+        SAFE_STRCPY(player_name, "Player", sizeof(player_name));
+    }
+    
+    // Initialize player
+    init_player(&table.players[0], player_name, 100);
+    table.player_count = 1;
+    
+    // Create and run game
+    Game game;
+    init_game(&game, &ruleset);
+    run_game(&game, &table);
+    
+    return 0;
+}
@@ -0,0 +1,392 @@
+/*
+ * UNIJACK - Exact dealer odds
+ * Implementation
+ */
+
+#include "odds.h"
+
+#define KEY_COUNT_BITS 6
+#define KEY_USED_BIT ((uint64_t)1 << 63)
+#define KEY_TEN_MASK 0xFF
+#define KEY_HARD_SHIFT 8
+#define KEY_ACE_SHIFT 13
+
+// Value of each card value index, aces counted as 1
+static const int VALUE_POINTS[CARD_VALUE_COUNT] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+
+// Walk state for one query
+typedef struct {
+    DealerOddsCache* cache;
+    int counts[CARD_VALUE_COUNT];
+    int remaining;
+} OddsWalk;
+
+// ============================================================================
+// CACHE OPERATIONS
+// ============================================================================
+int init_dealer_odds_cache(DealerOddsCache* cache, size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    
+    cache->entries = calloc(size, sizeof(DealerOddsEntry));
+    if (!cache->entries) {
+        cache->capacity = 0;
+        return 0;
+    }
+    cache->capacity = size;
+    cache->used = 0;
+    cache->lookups = 0;
+    cache->hits = 0;
+    return 1;
+}
+
+void clear_dealer_odds_cache(DealerOddsCache* cache) {
+    memset(cache->entries, 0, cache->capacity * sizeof(DealerOddsEntry));
+    cache->used = 0;
+}
+
+void free_dealer_odds_cache(DealerOddsCache* cache) {
+    free(cache->entries);
+    cache->entries = NULL;
+    cache->capacity = 0;
+    cache->used = 0;
+}
+
+static size_t hash_key(uint64_t key_low, uint64_t key_high, size_t mask) {
+    uint64_t h = key_low * 0x9E3779B97F4A7C15ULL ^ key_high * 0xC2B2AE3D27D4EB4FULL;
+    h ^= h >> 29;
+    return (size_t)h & mask;
+}
+
+static DealerOddsEntry* find_entry(DealerOddsCache* cache, uint64_t key_low, uint64_t key_high) {
+    size_t mask = cache->capacity - 1;
+    size_t slot = hash_key(key_low, key_high, mask);
+    
+    // Linear probing, key_high always carries the used bit
+    while (cache->entries[slot].key_high != 0) {
+        if (cache->entries[slot].key_high == key_high && cache->entries[slot].key_low == key_low) {
+            return &cache->entries[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+    return &cache->entries[slot];
+}
+
+// ============================================================================
+// ODDS OPERATIONS
+// ============================================================================
+void count_values_in_full_shoe(int deck_count, int counts[CARD_VALUE_COUNT]) {
+    for (int v = 0; v < CARD_VALUE_COUNT; v++) {
+        counts[v] = NUM_SUITS * deck_count;
+    }
+    counts[TEN_VALUE_INDEX] = NUM_SUITS * deck_count * (NUM_RANKS - TEN_VALUE_INDEX);
+}
+
+void count_values_in_shoe(const Shoe* shoe, int counts[CARD_VALUE_COUNT]) {
+    for (int v = 0; v < CARD_VALUE_COUNT; v++) {
+        counts[v] = 0;
+    }
+    for (int rank = 0; rank < NUM_RANKS; rank++) {
+        counts[RANK_VALUE_INDEX(rank)] += shoe->remaining_counts[rank];
+    }
+}
+
+int dealer_peeks_for_blackjack(const Ruleset* ruleset) {
+    // A checked hole card means a dealer blackjack is already face up
+    // whenever players still have decisions to make
+    return ruleset->dealer_receives_hole_card && ruleset->dealer_reveals_blackjack_hand;
+}
+
+static void dealer_draws(OddsWalk* walk, uint64_t key_low, int hard, int has_ace,
+                         double p[DEALER_BUST + 1]) {
+    memset(p, 0, (DEALER_BUST + 1) * sizeof(double));
+    
+    if (hard > TARGET_SCORE) {
+        p[DEALER_BUST] = 1.0;
+        return;
+    }
+    
+    int score = (has_ace && hard + SOFT_ACE_BONUS <= TARGET_SCORE) ? hard + SOFT_ACE_BONUS : hard;
+    if (score >= MINIMUM_DEALER_SCORE || walk->remaining == 0) {
+        // An empty shoe cannot happen in play, count the dealer as standing
+        p[safe_max(score, MINIMUM_DEALER_SCORE) - MINIMUM_DEALER_SCORE] = 1.0;
+        return;
+    }
+    
+    uint64_t key_high = KEY_USED_BIT | (uint64_t)walk->counts[TEN_VALUE_INDEX]
+                      | ((uint64_t)hard << KEY_HARD_SHIFT) | ((uint64_t)has_ace << KEY_ACE_SHIFT);
+    DealerOddsCache* cache = walk->cache;
+    cache->lookups++;
+    DealerOddsEntry* entry = find_entry(cache, key_low, key_high);
+    if (entry->key_high == key_high) {
+        cache->hits++;
+        memcpy(p, entry->p, sizeof(entry->p));
+        return;
+    }
+    
+    double inverse_remaining = 1.0 / walk->remaining;
+    for (int v = 0; v < CARD_VALUE_COUNT; v++) {
+        int count = walk->counts[v];
+        if (count == 0) {
+            continue;
+        }
+        
+        double weight = count * inverse_remaining;
+        double child[DEALER_BUST + 1];
+        uint64_t child_key = (v < TEN_VALUE_INDEX) ? key_low - ((uint64_t)1 << (v * KEY_COUNT_BITS)) : key_low;
+        
+        walk->counts[v]--;
+        walk->remaining--;
+        dealer_draws(walk, child_key, hard + VALUE_POINTS[v], has_ace | (v == 0), child);
+        walk->counts[v]++;
+        walk->remaining++;
+        
+        for (int o = 0; o <= DEALER_BUST; o++) {
+            p[o] += weight * child[o];
+        }
+    }
+    
+    // Children may have refilled the table, so look the slot up again
+    if (cache->used >= cache->capacity / 4 * 3) {
+        clear_dealer_odds_cache(cache);
+    }
+    entry = find_entry(cache, key_low, key_high);
+    entry->key_low = key_low;
+    entry->key_high = key_high;
+    memcpy(entry->p, p, sizeof(entry->p));
+    cache->used++;
+}
+
+void compute_dealer_odds(DealerOddsCache* cache, const int counts[CARD_VALUE_COUNT],
+                         int upcard_value, int exclude_blackjack, DealerOdds* odds) {
+    OddsWalk walk;
+    walk.cache = cache;
+    walk.remaining = 0;
+    uint64_t key_low = 0;
+    for (int v = 0; v < CARD_VALUE_COUNT; v++) {
+        walk.counts[v] = counts[v];
+        walk.remaining += counts[v];
+        if (v < TEN_VALUE_INDEX) {
+            key_low |= (uint64_t)counts[v] << (v * KEY_COUNT_BITS);
+        }
+    }
+    
+    memset(odds, 0, sizeof(*odds));
+    if (walk.remaining == 0) {
+        return;
+    }
+    
+    // The dealer's second card decides blackjack, every later card is
+    // handled by dealer_draws and its memo table
+    int up_points = VALUE_POINTS[upcard_value];
+    double total_weight = 0.0;
+    for (int v = 0; v < CARD_VALUE_COUNT; v++) {
+        if (walk.counts[v] == 0) {
+            continue;
+        }
+        
+        double weight = (double)walk.counts[v] / walk.remaining;
+        int hard = up_points + VALUE_POINTS[v];
+        int has_ace = (upcard_value == 0) || (v == 0);
+        
+        if (has_ace && hard + SOFT_ACE_BONUS == TARGET_SCORE) {
+            if (!exclude_blackjack) {
+                odds->p[DEALER_BLACKJACK] += weight;
+                total_weight += weight;
+            }
+            continue;
+        }
+        
+        double child[DEALER_BUST + 1];
+        uint64_t child_key = (v < TEN_VALUE_INDEX) ? key_low - ((uint64_t)1 << (v * KEY_COUNT_BITS)) : key_low;
+        walk.counts[v]--;
+        walk.remaining--;
+        dealer_draws(&walk, child_key, hard, has_ace, child);
+        walk.counts[v]++;
+        walk.remaining++;
+        
+        for (int o = 0; o <= DEALER_BUST; o++) {
+            odds->p[o] += weight * child[o];
+        }
+        total_weight += weight;
+    }
+    
+    // Condition on the outcomes that were kept
+    if (total_weight > 0.0 && exclude_blackjack) {
+        for (int o = 0; o < DEALER_OUTCOME_COUNT; o++) {
+            odds->p[o] /= total_weight;
+        }
+    }
+}
+
+void compute_dealer_odds_for_ruleset(DealerOddsCache* cache, const int counts[CARD_VALUE_COUNT],
+                                     int upcard_value, const Ruleset* ruleset, DealerOdds* odds) {
+    compute_dealer_odds(cache, counts, upcard_value, dealer_peeks_for_blackjack(ruleset), odds);
+}
+
+// ============================================================================
+// DRAW TABLE OPERATIONS
+// ============================================================================
+#define DRAW_KEY_BITS 5
+#define DRAW_MAP_CAPACITY 4096      // Distinct dealer hands per upcard stay near 2000
+
+// Build state: distinct hands found so far, keyed by packed drawn counts
+typedef struct {
+    uint64_t keys[DRAW_MAP_CAPACITY];
+    int hand_of_slot[DRAW_MAP_CAPACITY];
+    uint64_t hand_keys[DRAW_MAP_CAPACITY];
+    double orderings[DRAW_MAP_CAPACITY];
+    uint8_t outcomes[DRAW_MAP_CAPACITY];
+    int hand_count;
+    int overflow;
+} DrawTableBuilder;
+
+static void record_dealer_hand(DrawTableBuilder* builder, uint64_t key, int outcome) {
+    size_t slot = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 40) & (DRAW_MAP_CAPACITY - 1);
+    while (builder->keys[slot] != 0) {
+        if (builder->keys[slot] == key) {
+            builder->orderings[builder->hand_of_slot[slot]] += 1.0;
+            return;
+        }
+        slot = (slot + 1) & (DRAW_MAP_CAPACITY - 1);
+    }
+    
+    if (builder->hand_count >= DRAW_MAP_CAPACITY / 4 * 3) {
+        builder->overflow = 1;
+        return;
+    }
+    int hand = builder->hand_count++;
+    builder->keys[slot] = key;
+    builder->hand_of_slot[slot] = hand;
+    builder->hand_keys[hand] = key;
+    builder->orderings[hand] = 1.0;
+    builder->outcomes[hand] = (uint8_t)outcome;
+}
+
+static void enumerate_dealer_draws(DrawTableBuilder* builder, uint64_t key, int hard, int has_ace,
+                                   int drawn) {
+    if (hard > TARGET_SCORE) {
+        record_dealer_hand(builder, key, DEALER_BUST);
+        return;
+    }
+    
+    int score = (has_ace && hard + SOFT_ACE_BONUS <= TARGET_SCORE) ? hard + SOFT_ACE_BONUS : hard;
+    if (drawn == 1 && score == TARGET_SCORE) {
+        record_dealer_hand(builder, key, DEALER_BLACKJACK);
+        return;
+    }
+    if (score >= MINIMUM_DEALER_SCORE || drawn == MAX_DEALER_DRAWS) {
+        record_dealer_hand(builder, key, safe_max(score, MINIMUM_DEALER_SCORE) - MINIMUM_DEALER_SCORE);
+        return;
+    }
+    
+    for (int v = 0; v < CARD_VALUE_COUNT; v++) {
+        enumerate_dealer_draws(builder, key + ((uint64_t)1 << (v * DRAW_KEY_BITS)),
+                               hard + VALUE_POINTS[v], has_ace | (v == 0), drawn + 1);
+    }
+}
+
+int init_dealer_draw_table(DealerDrawTable* table, int upcard_value) {
+    memset(table, 0, sizeof(*table));
+    table->upcard_value = upcard_value;
+    
+    DrawTableBuilder* builder = calloc(1, sizeof(DrawTableBuilder));
+    if (!builder) {
+        return 0;
+    }
+    enumerate_dealer_draws(builder, 0, VALUE_POINTS[upcard_value], upcard_value == 0, 0);
+    
+    // Count factors: one per drawn card
+    size_t factor_count = 0;
+    for (int h = 0; h < builder->hand_count; h++) {
+        for (int v = 0; v < CARD_VALUE_COUNT; v++) {
+            factor_count += (builder->hand_keys[h] >> (v * DRAW_KEY_BITS)) & 0x1F;
+        }
+    }
+    
+    int count = builder->hand_count;
+    table->orderings = malloc(count * sizeof(double));
+    table->outcomes = malloc(count);
+    table->draw_counts = malloc(count);
+    table->factor_offsets = malloc((count + 1) * sizeof(uint32_t));
+    table->factors = malloc(factor_count);
+    if (builder->overflow || !table->orderings || !table->outcomes || !table->draw_counts ||
+        !table->factor_offsets || !table->factors) {
+        free(builder);
+        free_dealer_draw_table(table);
+        return 0;
+    }
+    
+    uint32_t offset = 0;
+    for (int h = 0; h < count; h++) {
+        table->orderings[h] = builder->orderings[h];
+        table->outcomes[h] = builder->outcomes[h];
+        table->factor_offsets[h] = offset;
+        for (int v = 0; v < CARD_VALUE_COUNT; v++) {
+            int copies = (int)((builder->hand_keys[h] >> (v * DRAW_KEY_BITS)) & 0x1F);
+            for (int k = 0; k < copies; k++) {
+                table->factors[offset++] = (uint8_t)(v * MAX_DEALER_DRAWS + k);
+            }
+        }
+        table->draw_counts[h] = (uint8_t)(offset - table->factor_offsets[h]);
+    }
+    table->factor_offsets[count] = offset;
+    table->hand_count = count;
+    
+    free(builder);
+    return 1;
+}
+
+void free_dealer_draw_table(DealerDrawTable* table) {
+    free(table->orderings);
+    free(table->outcomes);
+    free(table->draw_counts);
+    free(table->factor_offsets);
+    free(table->factors);
+    memset(table, 0, sizeof(*table));
+}
+
+void compute_dealer_odds_from_table(const DealerDrawTable* table, const int counts[CARD_VALUE_COUNT],
+                                    int exclude_blackjack, DealerOdds* odds) {
+    // factor[v][k] is the number of cards of value v left after k of them
+    // were drawn; a hand's weight is the product of its factors over the
+    // falling factorial of the remaining card count
+    double factor[CARD_VALUE_COUNT * MAX_DEALER_DRAWS];
+    double inverse_falling[MAX_DEALER_DRAWS + 1];
+    int remaining = 0;
+    
+    for (int v = 0; v < CARD_VALUE_COUNT; v++) {
+        remaining += counts[v];
+        for (int k = 0; k < MAX_DEALER_DRAWS; k++) {
+            factor[v * MAX_DEALER_DRAWS + k] = (double)(counts[v] - k);
+        }
+    }
+    inverse_falling[0] = 1.0;
+    for (int n = 1; n <= MAX_DEALER_DRAWS; n++) {
+        int left = remaining - (n - 1);
+        inverse_falling[n] = left > 0 ? inverse_falling[n - 1] / left : 0.0;
+    }
+    
+    memset(odds, 0, sizeof(*odds));
+    for (int h = 0; h < table->hand_count; h++) {
+        double weight = table->orderings[h] * inverse_falling[table->draw_counts[h]];
+        const uint8_t* f = &table->factors[table->factor_offsets[h]];
+        const uint8_t* end = &table->factors[table->factor_offsets[h + 1]];
+        while (f < end && weight != 0.0) {
+            weight *= factor[*f++];
+        }
+        odds->p[table->outcomes[h]] += weight;
+    }
+    
+    if (exclude_blackjack) {
+        double kept = 1.0 - odds->p[DEALER_BLACKJACK];
+        odds->p[DEALER_BLACKJACK] = 0.0;
+        if (kept > 0.0) {
+            for (int o = 0; o < DEALER_OUTCOME_COUNT; o++) {
+                odds->p[o] /= kept;
+            }
+        }
+    }
+}
@@ -0,0 +1,83 @@
+/*
+ * UNIJACK - Exact dealer odds
+ * Probability of every dealer final total given the unseen cards and the
+ * dealer's upcard, memoized over shoe composition states.
+ */
+
+#ifndef ODDS_H
+#define ODDS_H
+
+#include "blackjack.h"
+
+// Card values as used by the odds engine: 0=Ace, 1=2, ..., 8=9, 9=10/J/Q/K
+#define CARD_VALUE_COUNT 10
+#define TEN_VALUE_INDEX 9
+#define RANK_VALUE_INDEX(rank) ((rank) < TEN_VALUE_INDEX ? (rank) : TEN_VALUE_INDEX)
+
+// Dealer outcome indices
+#define DEALER_17 0
+#define DEALER_18 1
+#define DEALER_19 2
+#define DEALER_20 3
+#define DEALER_21 4
+#define DEALER_BUST 5
+#define DEALER_BLACKJACK 6
+#define DEALER_OUTCOME_COUNT 7
+
+// Dealer odds structure - probabilities indexed by dealer outcome
+typedef struct {
+    double p[DEALER_OUTCOME_COUNT];
+} DealerOdds;
+
+// Memo entry - dealer outcome distribution from one composition state
+typedef struct {
+    uint64_t key_low;       // Counts of values Ace..9, 6 bits each
+    uint64_t key_high;      // Count of tens, hard total, ace flag, used bit
+    double p[DEALER_BUST + 1];
+} DealerOddsEntry;
+
+// Memo table shared by every query made through it
+typedef struct {
+    DealerOddsEntry* entries;
+    size_t capacity;        // Power of two
+    size_t used;
+    long long lookups;
+    long long hits;
+} DealerOddsCache;
+
+// Every dealer hand that can follow one upcard, as multisets of drawn cards
+// Odds for any composition are then a sum of falling-factorial products,
+// which beats walking the draw tree when many compositions are queried.
+#define MAX_DEALER_DRAWS 16
+
+typedef struct {
+    int upcard_value;
+    int hand_count;
+    double* orderings;          // Number of draw orders leading to each hand
+    uint8_t* outcomes;          // Dealer outcome index of each hand
+    uint8_t* draw_counts;       // Cards drawn after the upcard
+    uint32_t* factor_offsets;   // First factor of each hand
+    uint8_t* factors;           // value * MAX_DEALER_DRAWS + copies of value drawn before
+} DealerDrawTable;
+
+// Function declarations - Cache operations
+int init_dealer_odds_cache(DealerOddsCache* cache, size_t capacity);
+void clear_dealer_odds_cache(DealerOddsCache* cache);
+void free_dealer_odds_cache(DealerOddsCache* cache);
+
+// Function declarations - Odds operations
+void count_values_in_full_shoe(int deck_count, int counts[CARD_VALUE_COUNT]);
+void count_values_in_shoe(const Shoe* shoe, int counts[CARD_VALUE_COUNT]);
+void compute_dealer_odds(DealerOddsCache* cache, const int counts[CARD_VALUE_COUNT],
+                         int upcard_value, int exclude_blackjack, DealerOdds* odds);
+void compute_dealer_odds_for_ruleset(DealerOddsCache* cache, const int counts[CARD_VALUE_COUNT],
+                                     int upcard_value, const Ruleset* ruleset, DealerOdds* odds);
+int dealer_peeks_for_blackjack(const Ruleset* ruleset);
+
+// Function declarations - Draw table operations
+int init_dealer_draw_table(DealerDrawTable* table, int upcard_value);
+void free_dealer_draw_table(DealerDrawTable* table);
+void compute_dealer_odds_from_table(const DealerDrawTable* table, const int counts[CARD_VALUE_COUNT],
+                                    int exclude_blackjack, DealerOdds* odds);
+
+#endif // ODDS_H
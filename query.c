@@ -0,0 +1,454 @@
+/*
+ * UNIJACK - Hand history queries
+ * Implementation
+ */
+
+#include "query.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char* const DIMENSION_NAMES[DIMENSION_COUNT] = {"start", "upcard", "outcome", "depth", "action"};
+static const int DIMENSION_KEY_COUNTS[DIMENSION_COUNT] = {
+    2 * HISTORY_START_SOFT_KEY, 10, OUTCOME_COUNT, HISTORY_DEPTH_BUCKET_COUNT, HISTORY_ACTION_COUNT
+};
+static const char* const ACTION_NAMES[HISTORY_ACTION_COUNT] = {"none", "hit", "stand", "double", "split", "surrender"};
+static const char ACTION_LETTERS[HISTORY_ACTION_COUNT + 1] = "-hsdpr";
+
+// ============================================================================
+// LAYOUT OPERATIONS
+// ============================================================================
+static size_t align8(size_t size) {
+    return (size + 7) & ~(size_t)7;
+}
+
+static size_t postings_offset(uint64_t hand_count, int dimension) {
+    // Byte offset of a dimension's starts array; postings follow it
+    size_t offset = HISTORY_INDEX_HEADER_SIZE + (size_t)hand_count * sizeof(HistoryIndexRow);
+    for (int d = 0; d < dimension; d++) {
+        offset += (size_t)(DIMENSION_KEY_COUNTS[d] + 1) * sizeof(uint64_t);
+        offset += align8((size_t)hand_count * sizeof(uint32_t));
+    }
+    return offset;
+}
+
+static void point_into_index(HistoryIndex* index, uint8_t* data) {
+    index->rows = (const HistoryIndexRow*)(data + HISTORY_INDEX_HEADER_SIZE);
+    for (int d = 0; d < DIMENSION_COUNT; d++) {
+        size_t offset = postings_offset(index->hand_count, d);
+        index->starts[d] = (const uint64_t*)(data + offset);
+        index->postings[d] = (const uint32_t*)(data + offset +
+                                               (size_t)(DIMENSION_KEY_COUNTS[d] + 1) * sizeof(uint64_t));
+    }
+}
+
+int get_dimension_key_count(int dimension) {
+    return DIMENSION_KEY_COUNTS[dimension];
+}
+
+const char* get_dimension_name(int dimension) {
+    return DIMENSION_NAMES[dimension];
+}
+
+int find_dimension(const char* name) {
+    for (int d = 0; d < DIMENSION_COUNT; d++) {
+        if (strcmp(name, DIMENSION_NAMES[d]) == 0) {
+            return d;
+        }
+    }
+    return -1;
+}
+
+// ============================================================================
+// BUILD OPERATIONS
+// ============================================================================
+static void fill_index_row(HistoryIndexRow* row, uint64_t record_offset, const HistoryRound* round,
+                           int hand_idx, int dealer_score, int total_cards) {
+    const HistorySeat* seat = &round->seats[hand_idx];
+    memset(row, 0, sizeof(*row));
+    row->record_offset = record_offset;
+    row->net = (int32_t)((int64_t)seat->payout - (int64_t)seat->wager);
+    row->seat_idx = seat->seat_idx;
+    row->hand_idx = (uint8_t)hand_idx;
+    row->dealer_score = (uint8_t)dealer_score;
+    
+    Hand start;
+    init_hand(&start);
+    for (int c = 0; c < seat->card_count && c < 2; c++) {
+        add_card_to_hand(&start, seat->cards[c]);
+    }
+    row->keys[DIMENSION_START] = hand_is_soft(&start) ?
+        (uint8_t)(HISTORY_START_SOFT_KEY + start.hard_total + SOFT_ACE_BONUS) : start.hard_total;
+    row->keys[DIMENSION_UPCARD] = round->dealer_card_count > 0 ?
+        (uint8_t)(RANK_VALUES[CARD_RANK(round->dealer_cards[0]) % NUM_RANKS] - 1) : 0;
+    row->keys[DIMENSION_OUTCOME] = (uint8_t)safe_min(seat->outcome, OUTCOME_COUNT - 1);
+    int depth = total_cards > 0 ? round->shoe_dealt * HISTORY_DEPTH_BUCKET_COUNT / total_cards : 0;
+    row->keys[DIMENSION_DEPTH] = (uint8_t)safe_min(depth, HISTORY_DEPTH_BUCKET_COUNT - 1);
+    row->keys[DIMENSION_ACTION] = HISTORY_ACTION_NONE;
+    for (int d = 0; d < seat->decision_count; d++) {
+        const char* letter = strchr(ACTION_LETTERS + 1, seat->decisions[d]);
+        if (seat->decisions[d] && letter) {
+            row->keys[DIMENSION_ACTION] = (uint8_t)(letter - ACTION_LETTERS);
+            break;
+        }
+    }
+}
+
+static int count_history_hands(const HistoryFile* log, uint64_t* hand_count, uint64_t* round_count) {
+    HistoryRound round;
+    size_t offset = HISTORY_HEADER_SIZE;
+    *hand_count = 0;
+    *round_count = 0;
+    while (offset < log->size) {
+        size_t size = decode_history_round(&log->data[offset], log->size - offset, &round);
+        if (size == 0) {
+            return 0;
+        }
+        *hand_count += round.hand_count;
+        (*round_count)++;
+        offset += size;
+    }
+    return 1;
+}
+
+int build_history_index(const char* log_path, const char* index_path, uint64_t* hand_count) {
+    // The index is filled in place through a shared mapping, so logs far
+    // larger than memory index fine; it appears under its name only once complete
+    HistoryFile log;
+    if (!map_history_file(&log, log_path)) {
+        return 0;
+    }
+    HistoryIndex index;
+    memset(&index, 0, sizeof(index));
+    if (!count_history_hands(&log, &index.hand_count, &index.round_count) ||
+        index.hand_count > HISTORY_INDEX_MAX_HANDS) {
+        unmap_history_file(&log);
+        return 0;
+    }
+    
+    char temp_path[MAX_STRING_LEN * 4];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", index_path);
+    size_t size = postings_offset(index.hand_count, DIMENSION_COUNT);
+    int fd = open(temp_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        unmap_history_file(&log);
+        return 0;
+    }
+    uint8_t* data = ftruncate(fd, (off_t)size) == 0 ?
+        mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (data == MAP_FAILED) {
+        unlink(temp_path);
+        unmap_history_file(&log);
+        return 0;
+    }
+    
+    memcpy(data, HISTORY_INDEX_MAGIC, 4);
+    uint32_t version = HISTORY_INDEX_VERSION;
+    uint64_t counts[3] = {log.size, index.hand_count, index.round_count};
+    memcpy(data + 4, &version, sizeof(version));
+    memcpy(data + 8, counts, sizeof(counts));
+    point_into_index(&index, data);
+    
+    HistoryIndexRow* rows = (HistoryIndexRow*)index.rows;
+    HistoryRound round;
+    uint64_t hand = 0;
+    size_t offset = HISTORY_HEADER_SIZE;
+    while (offset < log.size) {
+        size_t record_size = decode_history_round(&log.data[offset], log.size - offset, &round);
+        Hand dealer;
+        init_hand(&dealer);
+        for (int c = 0; c < round.dealer_card_count; c++) {
+            add_card_to_hand(&dealer, round.dealer_cards[c]);
+        }
+        int dealer_score = score_from_hand(&dealer);
+        for (int i = 0; i < round.hand_count; i++) {
+            fill_index_row(&rows[hand++], offset, &round, i, dealer_score,
+                           log.header.total_cards);
+        }
+        offset += record_size;
+    }
+    
+    // Counting sort per dimension; hands go in ascending, so postings stay sorted
+    for (int d = 0; d < DIMENSION_COUNT; d++) {
+        uint64_t* starts = (uint64_t*)index.starts[d];
+        uint32_t* postings = (uint32_t*)index.postings[d];
+        uint64_t next[2 * HISTORY_START_SOFT_KEY] = {0};
+        for (uint64_t h = 0; h < index.hand_count; h++) {
+            next[rows[h].keys[d]]++;
+        }
+        uint64_t total = 0;
+        for (int k = 0; k < DIMENSION_KEY_COUNTS[d]; k++) {
+            starts[k] = total;
+            total += next[k];
+            next[k] = starts[k];
+        }
+        starts[DIMENSION_KEY_COUNTS[d]] = total;
+        for (uint64_t h = 0; h < index.hand_count; h++) {
+            postings[next[rows[h].keys[d]]++] = (uint32_t)h;
+        }
+    }
+    
+    int ok = msync(data, size, MS_SYNC) == 0;
+    munmap(data, size);
+    unmap_history_file(&log);
+    if (!ok || rename(temp_path, index_path) != 0) {
+        unlink(temp_path);
+        return 0;
+    }
+    if (hand_count) {
+        *hand_count = index.hand_count;
+    }
+    return 1;
+}
+
+// ============================================================================
+// INDEX OPERATIONS
+// ============================================================================
+int open_history_index(HistoryIndex* index, const char* log_path, const char* index_path) {
+    memset(index, 0, sizeof(*index));
+    if (!map_history_file(&index->log, log_path)) {
+        return 0;
+    }
+    int fd = open(index_path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size < HISTORY_INDEX_HEADER_SIZE) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        unmap_history_file(&index->log);
+        return 0;
+    }
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        unmap_history_file(&index->log);
+        return 0;
+    }
+    index->data = (const uint8_t*)data;
+    index->size = (size_t)st.st_size;
+    
+    // Stale when the log changed size since the index was built
+    uint32_t version;
+    uint64_t counts[3];
+    memcpy(&version, index->data + 4, sizeof(version));
+    memcpy(counts, index->data + 8, sizeof(counts));
+    index->hand_count = counts[1];
+    index->round_count = counts[2];
+    if (memcmp(index->data, HISTORY_INDEX_MAGIC, 4) != 0 || version != HISTORY_INDEX_VERSION ||
+        counts[0] != index->log.size || counts[1] > HISTORY_INDEX_MAX_HANDS ||
+        postings_offset(index->hand_count, DIMENSION_COUNT) != index->size) {
+        close_history_index(index);
+        return 0;
+    }
+    point_into_index(index, (uint8_t*)data);
+    return 1;
+}
+
+void close_history_index(HistoryIndex* index) {
+    if (index->data) {
+        munmap((void*)index->data, index->size);
+    }
+    unmap_history_file(&index->log);
+    memset(index, 0, sizeof(*index));
+}
+
+// ============================================================================
+// QUERY OPERATIONS
+// ============================================================================
+void init_history_query(HistoryQuery* query) {
+    memset(query, 0, sizeof(*query));
+}
+
+static int parse_dimension_key(int dimension, const char* text) {
+    // Returns the key a single value names, or -1
+    char* end = NULL;
+    switch (dimension) {
+        case DIMENSION_START: {
+            int soft = (text[0] == 's' || text[0] == 'S');
+            long total = strtol(text + soft, &end, 10);
+            if (*end || total < (soft ? 12 : 2) || total > (soft ? 21 : 20)) {
+                return -1;
+            }
+            return (int)total + (soft ? HISTORY_START_SOFT_KEY : 0);
+        }
+        case DIMENSION_UPCARD: {
+            if (strchr("AaTtJjQqKk", text[0]) && text[0] && !text[1]) {
+                return (text[0] == 'A' || text[0] == 'a') ? 0 : 9;
+            }
+            long value = strtol(text, &end, 10);
+            return (*end || value < 1 || value > 10) ? -1 : (int)value - 1;
+        }
+        case DIMENSION_OUTCOME:
+            for (int k = 0; k < OUTCOME_COUNT; k++) {
+                if (strcmp(text, history_outcome_name(k)) == 0) {
+                    return k;
+                }
+            }
+            return -1;
+        case DIMENSION_DEPTH: {
+            long percent = strtol(text, &end, 10);
+            if (*end || percent < 0 || percent > 100) {
+                return -1;
+            }
+            return safe_min((int)percent / HISTORY_DEPTH_BUCKET_PERCENT, HISTORY_DEPTH_BUCKET_COUNT - 1);
+        }
+        case DIMENSION_ACTION:
+            for (int k = 0; k < HISTORY_ACTION_COUNT; k++) {
+                if (strcmp(text, ACTION_NAMES[k]) == 0) {
+                    return k;
+                }
+            }
+            return -1;
+        default:
+            return -1;
+    }
+}
+
+int parse_history_condition(HistoryQuery* query, int dimension, const char* values) {
+    // Comma separated values or inclusive ranges, e.g. "12-16,s17" or "70-80"
+    char buffer[MAX_STRING_LEN * 4];
+    SAFE_STRCPY(buffer, values, sizeof(buffer));
+    uint64_t allowed = 0;
+    
+    for (char* token = strtok(buffer, ","); token; token = strtok(NULL, ",")) {
+        char* dash = strchr(token, '-');
+        if (dash) {
+            *dash = '\0';
+        }
+        int low = parse_dimension_key(dimension, token);
+        int high = dash ? parse_dimension_key(dimension, dash + 1) : low;
+        if (dash && dimension == DIMENSION_DEPTH && high > low && atoi(dash + 1) % HISTORY_DEPTH_BUCKET_PERCENT == 0) {
+            high--;  // "70-80" ends with the bucket below 80%
+        }
+        if (low < 0 || high < low) {
+            return 0;
+        }
+        for (int k = low; k <= high; k++) {
+            allowed |= 1ULL << k;
+        }
+    }
+    if (allowed == 0) {
+        return 0;
+    }
+    query->allowed[dimension] = allowed;
+    return 1;
+}
+
+void format_dimension_key(int dimension, int key, char* buffer, size_t buffer_size) {
+    switch (dimension) {
+        case DIMENSION_START:
+            if (key >= HISTORY_START_SOFT_KEY) {
+                snprintf(buffer, buffer_size, "s%d", key - HISTORY_START_SOFT_KEY);
+            } else {
+                snprintf(buffer, buffer_size, "%d", key);
+            }
+            break;
+        case DIMENSION_UPCARD:
+            if (key == 0) {
+                snprintf(buffer, buffer_size, "A");
+            } else {
+                snprintf(buffer, buffer_size, "%d", key + 1);
+            }
+            break;
+        case DIMENSION_OUTCOME:
+            snprintf(buffer, buffer_size, "%s", history_outcome_name(key));
+            break;
+        case DIMENSION_DEPTH:
+            snprintf(buffer, buffer_size, "%d-%d%%", key * HISTORY_DEPTH_BUCKET_PERCENT,
+                     (key + 1) * HISTORY_DEPTH_BUCKET_PERCENT);
+            break;
+        default:
+            snprintf(buffer, buffer_size, "%s", ACTION_NAMES[key % HISTORY_ACTION_COUNT]);
+            break;
+    }
+}
+
+int hand_matches_query(const HistoryIndex* index, const HistoryQuery* query, uint64_t hand) {
+    const HistoryIndexRow* row = &index->rows[hand];
+    for (int d = 0; d < DIMENSION_COUNT; d++) {
+        if (query->allowed[d] && !((query->allowed[d] >> row->keys[d]) & 1)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+long long run_history_query(const HistoryIndex* index, const HistoryQuery* query,
+                            HistoryMatchFn on_match, void* context) {
+    // Walk the postings of the most selective condition and check the
+    // others on the rows; without conditions every hand is visited
+    int driver = -1;
+    uint64_t fewest = index->hand_count;
+    for (int d = 0; d < DIMENSION_COUNT; d++) {
+        if (!query->allowed[d]) {
+            continue;
+        }
+        uint64_t count = 0;
+        for (int k = 0; k < DIMENSION_KEY_COUNTS[d]; k++) {
+            if ((query->allowed[d] >> k) & 1) {
+                count += index->starts[d][k + 1] - index->starts[d][k];
+            }
+        }
+        if (driver < 0 || count < fewest) {
+            driver = d;
+            fewest = count;
+        }
+    }
+    
+    long long matches = 0;
+    if (driver < 0) {
+        for (uint64_t hand = 0; hand < index->hand_count; hand++) {
+            matches++;
+            if (!on_match(context, index, hand)) {
+                return matches;
+            }
+        }
+        return matches;
+    }
+    for (int k = 0; k < DIMENSION_KEY_COUNTS[driver]; k++) {
+        if (!((query->allowed[driver] >> k) & 1)) {
+            continue;
+        }
+        for (uint64_t p = index->starts[driver][k]; p < index->starts[driver][k + 1]; p++) {
+            uint64_t hand = index->postings[driver][p];
+            if (!hand_matches_query(index, query, hand)) {
+                continue;
+            }
+            matches++;
+            if (!on_match(context, index, hand)) {
+                return matches;
+            }
+        }
+    }
+    return matches;
+}
+
+// ============================================================================
+// AGGREGATE OPERATIONS
+// ============================================================================
+void init_history_aggregate(HistoryAggregate* aggregate) {
+    memset(aggregate, 0, sizeof(*aggregate));
+}
+
+void add_to_history_aggregate(HistoryAggregate* aggregate, const HistoryIndex* index,
+                              const HistoryQuery* query, uint64_t hand) {
+    const HistoryIndexRow* row = &index->rows[hand];
+    aggregate->hand_count++;
+    aggregate->outcome_counts[row->keys[DIMENSION_OUTCOME]]++;
+    aggregate->net += row->net;
+    
+    // A round counts once, with the first of its seats that matches;
+    // seats of a round are neighbours in the rows
+    for (uint64_t h = hand; h > 0 && index->rows[h - 1].record_offset == row->record_offset; h--) {
+        if (hand_matches_query(index, query, h - 1)) {
+            return;
+        }
+    }
+    aggregate->round_count++;
+    if (row->dealer_score > TARGET_SCORE) {
+        aggregate->dealer_bust_count++;
+    }
+}
@@ -0,0 +1,114 @@
+/*
+ * UNIJACK - Hand history queries
+ * Secondary indexes over hand-history logs: one fixed-size row per hand
+ * and one posting list per value of each indexed dimension, built once
+ * and memory-mapped by every query.
+ */
+
+#ifndef QUERY_H
+#define QUERY_H
+
+#include "history.h"
+
+// Index file format, native byte order, built next to the log as LOG.idx
+//
+// Header (HISTORY_INDEX_HEADER_SIZE bytes)
+//   char[4] magic "UJHI"       u32 version
+//   u64 size of the indexed log, so a grown or replaced log is noticed
+//   u64 hand count             u64 round count
+// Rows, one HistoryIndexRow per hand, in log order
+// Then for every dimension, in HistoryDimension order:
+//   u64[key count + 1] start of each key's postings
+//   u32[hand count] hand numbers, grouped by key, ascending within a key
+#define HISTORY_INDEX_MAGIC "UJHI"
+#define HISTORY_INDEX_VERSION 2
+#define HISTORY_INDEX_HEADER_SIZE 64
+#define HISTORY_INDEX_SUFFIX ".idx"
+#define HISTORY_INDEX_MAX_HANDS 0xFFFFFFFFULL
+
+// Shoe depth is indexed in buckets of this many percent of the shoe dealt
+#define HISTORY_DEPTH_BUCKET_PERCENT 5
+#define HISTORY_DEPTH_BUCKET_COUNT (100 / HISTORY_DEPTH_BUCKET_PERCENT)
+
+// Starting hands are keyed by their two-card total, soft totals offset
+#define HISTORY_START_SOFT_KEY 32
+
+// First decision keys, insurance aside
+#define HISTORY_ACTION_NONE 0
+#define HISTORY_ACTION_HIT 1
+#define HISTORY_ACTION_STAND 2
+#define HISTORY_ACTION_DOUBLE 3
+#define HISTORY_ACTION_SPLIT 4
+#define HISTORY_ACTION_SURRENDER 5
+#define HISTORY_ACTION_COUNT 6
+
+// Indexed dimensions, every hand has exactly one key in each
+typedef enum {
+    DIMENSION_START,            // Two-card total, HISTORY_START_SOFT_KEY + total if soft
+    DIMENSION_UPCARD,           // Dealer upcard value, 1 (ace) to 10
+    DIMENSION_OUTCOME,          // BUST to SURRENDER
+    DIMENSION_DEPTH,            // Shoe dealt before the round, in depth buckets
+    DIMENSION_ACTION,           // First decision, HISTORY_ACTION_*
+    DIMENSION_COUNT
+} HistoryDimension;
+
+// Index row structure - everything aggregates need, without the log
+typedef struct {
+    uint64_t record_offset;     // Round record in the log, shared by its seats
+    int32_t net;                // Payout minus wager
+    uint8_t seat_idx;
+    uint8_t dealer_score;
+    uint8_t keys[DIMENSION_COUNT];
+    uint8_t hand_idx;           // Entry of the hand in its round record
+    uint8_t reserved[4];
+} HistoryIndexRow;
+
+// History index structure - a mapped index and its log
+typedef struct {
+    HistoryFile log;
+    const uint8_t* data;
+    size_t size;
+    uint64_t hand_count;
+    uint64_t round_count;
+    const HistoryIndexRow* rows;
+    const uint64_t* starts[DIMENSION_COUNT];
+    const uint32_t* postings[DIMENSION_COUNT];
+} HistoryIndex;
+
+// History query structure - allowed keys per dimension, 0 = any
+typedef struct {
+    uint64_t allowed[DIMENSION_COUNT];
+} HistoryQuery;
+
+// History aggregate structure - tallies of the matching hands
+typedef struct {
+    long long hand_count;
+    long long round_count;      // Rounds with at least one matching hand
+    long long outcome_counts[OUTCOME_COUNT];
+    long long net;
+    long long dealer_bust_count;    // Over rounds
+} HistoryAggregate;
+
+// Called for every matching hand; return 0 to stop the query
+typedef int (*HistoryMatchFn)(void* context, const HistoryIndex* index, uint64_t hand);
+
+// Function declarations - Index operations
+int build_history_index(const char* log_path, const char* index_path, uint64_t* hand_count);
+int open_history_index(HistoryIndex* index, const char* log_path, const char* index_path);
+void close_history_index(HistoryIndex* index);
+int get_dimension_key_count(int dimension);
+const char* get_dimension_name(int dimension);
+int find_dimension(const char* name);
+
+// Function declarations - Query operations
+void init_history_query(HistoryQuery* query);
+int parse_history_condition(HistoryQuery* query, int dimension, const char* values);
+void format_dimension_key(int dimension, int key, char* buffer, size_t buffer_size);
+int hand_matches_query(const HistoryIndex* index, const HistoryQuery* query, uint64_t hand);
+long long run_history_query(const HistoryIndex* index, const HistoryQuery* query,
+                            HistoryMatchFn on_match, void* context);
+void init_history_aggregate(HistoryAggregate* aggregate);
+void add_to_history_aggregate(HistoryAggregate* aggregate, const HistoryIndex* index,
+                              const HistoryQuery* query, uint64_t hand);
+
+#endif // QUERY_H
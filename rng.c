@@ -0,0 +1,112 @@
+/*
+ * UNIJACK - Random number generation
+ * Implementation of xoshiro256** (Blackman and Vigna) and Lemire's
+ * unbiased bounded integers.
+ */
+
+#include "rng.h"
+
+static uint64_t rotate_left(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static uint64_t splitmix64(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// ============================================================================
+// RNG OPERATIONS
+// ============================================================================
+void rng_seed(Rng* rng, uint64_t seed) {
+    // splitmix64 never yields four zero words, which xoshiro must avoid
+    uint64_t state = seed;
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = splitmix64(&state);
+    }
+}
+
+uint64_t rng_next(Rng* rng) {
+    uint64_t* s = rng->s;
+    uint64_t result = rotate_left(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotate_left(s[3], 45);
+    
+    return result;
+}
+
+uint32_t rng_bounded(Rng* rng, uint32_t bound) {
+    // Lemire's multiply-and-reject: uniform in [0, bound) without division
+    // on the common path and without the bias of a plain modulo
+    uint64_t m = (uint64_t)(uint32_t)(rng_next(rng) >> 32) * bound;
+    uint32_t low = (uint32_t)m;
+    
+    if (low < bound) {
+        uint32_t threshold = (uint32_t)(-bound) % bound;
+        while (low < threshold) {
+            m = (uint64_t)(uint32_t)(rng_next(rng) >> 32) * bound;
+            low = (uint32_t)m;
+        }
+    }
+    
+    return (uint32_t)(m >> 32);
+}
+
+double rng_uniform(Rng* rng) {
+    // 53 random bits mapped to [0, 1)
+    return (double)(rng_next(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void rng_apply_jump(Rng* rng, const uint64_t polynomial[4]) {
+    uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    
+    for (int i = 0; i < 4; i++) {
+        for (int b = 0; b < 64; b++) {
+            if (polynomial[i] & ((uint64_t)1 << b)) {
+                s0 ^= rng->s[0];
+                s1 ^= rng->s[1];
+                s2 ^= rng->s[2];
+                s3 ^= rng->s[3];
+            }
+            rng_next(rng);
+        }
+    }
+    
+    rng->s[0] = s0;
+    rng->s[1] = s1;
+    rng->s[2] = s2;
+    rng->s[3] = s3;
+}
+
+void rng_jump(Rng* rng) {
+    // Equivalent to 2^128 calls to rng_next
+    static const uint64_t JUMP[4] = {
+        0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL,
+        0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL
+    };
+    rng_apply_jump(rng, JUMP);
+}
+
+void rng_long_jump(Rng* rng) {
+    // Equivalent to 2^192 calls to rng_next
+    static const uint64_t LONG_JUMP[4] = {
+        0x76E15D3EFEFDCBBFULL, 0xC5004E441C522FB3ULL,
+        0x77710069854EE241ULL, 0x39109BB02ACBE635ULL
+    };
+    rng_apply_jump(rng, LONG_JUMP);
+}
+
+void rng_split(Rng* rng, Rng* child) {
+    // The child takes the current stream, the parent moves 2^128 draws
+    // ahead, so successive splits hand out non-overlapping streams
+    *child = *rng;
+    rng_jump(rng);
+}
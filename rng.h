@@ -0,0 +1,26 @@
+/*
+ * UNIJACK - Random number generation
+ * xoshiro256** generator with explicit state, seeded through splitmix64.
+ * Every stream is reproducible bit-for-bit from its seed on any platform.
+ */
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// Random number generator state
+typedef struct {
+    uint64_t s[4];
+} Rng;
+
+// Function declarations - Rng operations
+void rng_seed(Rng* rng, uint64_t seed);
+uint64_t rng_next(Rng* rng);
+uint32_t rng_bounded(Rng* rng, uint32_t bound);
+double rng_uniform(Rng* rng);
+void rng_jump(Rng* rng);
+void rng_long_jump(Rng* rng);
+void rng_split(Rng* rng, Rng* child);
+
+#endif // RNG_H
@@ -0,0 +1,892 @@
+/*
+ * UNIJACK - Table server
+ * Implementation
+ */
+
+#define _GNU_SOURCE     // accept4
+#include "server.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define SERVER_EVENT_BATCH 512
+#define SERVER_ACCEPT_BATCH 64
+#define SERVER_READ_SIZE 4096
+#define SERVER_IDLE_WAIT_MS 100     // Longest epoll wait, so a stop request is noticed
+
+static const char RANK_LABELS[NUM_RANKS + 1] = "A23456789TJQK";
+static const char SUIT_LABELS[NUM_SUITS + 1] = "shdc";
+
+static volatile sig_atomic_t g_server_stopping = 0;
+
+typedef struct ServerLoop ServerLoop;
+typedef struct ServerTable ServerTable;
+
+// Seat states
+#define SEAT_EMPTY 0
+#define SEAT_TAKEN 1
+#define SEAT_LEFT 2             // Disconnected mid-round, freed once the round is over
+
+// Server connection structure - one client socket and the seat it holds
+// Closing is deferred to the end of the loop pass, so table code never
+// sees a connection vanish under it.
+typedef struct ServerConnection {
+    int fd;
+    ServerTable* table;
+    int seat_idx;
+    int closing;
+    int dirty;                  // Output waiting for the end of the loop pass
+    int want_write;             // EPOLLOUT armed, the socket is full
+    struct ServerConnection* next_dirty;
+    struct ServerConnection* next_closing;
+    int input_length;
+    int output_length;
+    char input[SERVER_MAX_LINE];
+    char output[SERVER_OUTPUT_BUFFER_SIZE];
+} ServerConnection;
+
+// Server table structure - a table and its seats
+// The round in progress is the engine's round state machine in table.round,
+// which the table feeds with answers as they arrive.
+struct ServerTable {
+    ServerLoop* loop;
+    Game game;
+    Table table;
+    int id;
+    ServerConnection* seats[MAX_PLAYERS];
+    uint8_t seat_states[MAX_PLAYERS];
+    int taken_count;            // Seats not SEAT_EMPTY
+    int round_chips[MAX_PLAYERS];   // Chips before the round, for the net result
+    uint32_t question_ids[MAX_PLAYERS];
+    uint32_t wait_generation;
+    int open_listed;
+    ServerTable* next_open;
+};
+
+// Server timer structure - a table's decision deadline
+// Every wait lasts decision_ms, so deadlines are queued in expiry order
+// and a plain FIFO does the job of a priority queue.
+typedef struct {
+    int64_t deadline_ms;
+    ServerTable* table;
+    uint32_t generation;
+} ServerTimer;
+
+// Server loop structure - one event loop thread
+struct ServerLoop {
+    const ServerConfig* config;
+    int index;
+    int epoll_fd;
+    const int* listen_fds;
+    int listen_count;
+    pthread_t thread;
+    ServerTable** tables;
+    int table_count;
+    int table_capacity;
+    ServerTable* open_tables;   // Tables with a free seat
+    ServerTimer* timers;
+    int timer_capacity;
+    int timer_head;
+    int timer_count;
+    ServerConnection* dirty_list;
+    ServerConnection* closing_list;
+    ServerStats stats;
+};
+
+static void start_betting(ServerTable* server_table);
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+static int64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void format_card_label(Card card, char* label) {
+    label[0] = RANK_LABELS[CARD_RANK(card) % NUM_RANKS];
+    label[1] = SUIT_LABELS[CARD_SUIT(card)];
+    label[2] = '\0';
+}
+
+static void format_cards(const Hand* hand, char* buffer, size_t buffer_size) {
+    size_t length = 0;
+    buffer[0] = '\0';
+    for (int i = 0; i < hand->card_count && length + 4 < buffer_size; i++) {
+        char label[3];
+        format_card_label(hand->cards[i], label);
+        length += (size_t)snprintf(buffer + length, buffer_size - length, " %s", label);
+    }
+}
+
+void init_server_config(ServerConfig* config, const Ruleset* ruleset) {
+    memset(config, 0, sizeof(*config));
+    config->ruleset = *ruleset;
+    config->host = "127.0.0.1";
+    config->port = SERVER_DEFAULT_PORT;
+    config->unix_path = NULL;
+    config->thread_count = 1;
+    config->seats_per_table = ruleset->maximum_player_count;
+    config->decision_ms = SERVER_DEFAULT_DECISION_MS;
+    config->starting_chips = SERVER_DEFAULT_CHIPS;
+    config->seed = (uint64_t)time(NULL);
+}
+
+void stop_server(void) {
+    // Async-signal-safe, loops notice within SERVER_IDLE_WAIT_MS
+    g_server_stopping = 1;
+}
+
+// ============================================================================
+// CONNECTION OPERATIONS
+// ============================================================================
+static void close_connection(ServerLoop* loop, ServerConnection* connection) {
+    if (connection->closing) {
+        return;
+    }
+    connection->closing = 1;
+    connection->next_closing = loop->closing_list;
+    loop->closing_list = connection;
+}
+
+static void send_line(ServerConnection* connection, ServerLoop* loop, const char* format, ...) {
+    if (!connection || connection->closing) {
+        return;
+    }
+    
+    size_t space = sizeof(connection->output) - (size_t)connection->output_length;
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(connection->output + connection->output_length, space, format, args);
+    va_end(args);
+    if (length < 0 || (size_t)length + 1 >= space) {
+        // The client stopped reading; drop it rather than buffer without end
+        loop->stats.dropped_count++;
+        close_connection(loop, connection);
+        return;
+    }
+    connection->output_length += length;
+    connection->output[connection->output_length++] = '\n';
+    
+    if (!connection->dirty) {
+        connection->dirty = 1;
+        connection->next_dirty = loop->dirty_list;
+        loop->dirty_list = connection;
+    }
+}
+
+static void flush_connection(ServerLoop* loop, ServerConnection* connection) {
+    int sent = 0;
+    while (sent < connection->output_length) {
+        ssize_t result = send(connection->fd, connection->output + sent,
+                              (size_t)(connection->output_length - sent), MSG_NOSIGNAL);
+        if (result > 0) {
+            sent += (int)result;
+        } else if (result < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                close_connection(loop, connection);
+            }
+            break;
+        }
+    }
+    
+    connection->output_length -= sent;
+    memmove(connection->output, connection->output + sent, (size_t)connection->output_length);
+    
+    // Wait for room in the socket only while something is left to send
+    int want_write = connection->output_length > 0 && !connection->closing;
+    if (want_write != connection->want_write) {
+        struct epoll_event event;
+        event.events = EPOLLIN | (want_write ? EPOLLOUT : 0);
+        event.data.ptr = connection;
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, connection->fd, &event);
+        connection->want_write = want_write;
+    }
+}
+
+// ============================================================================
+// TIMER OPERATIONS
+// ============================================================================
+static void arm_table_timer(ServerTable* server_table) {
+    ServerLoop* loop = server_table->loop;
+    if (loop->timer_count == loop->timer_capacity) {
+        // Grow the ring, unrolling it so the head is at 0 again
+        int capacity = loop->timer_capacity ? 2 * loop->timer_capacity : 1024;
+        ServerTimer* timers = malloc((size_t)capacity * sizeof(ServerTimer));
+        if (!timers) {
+            return;     // The table then waits for its answers without a deadline
+        }
+        for (int i = 0; i < loop->timer_count; i++) {
+            timers[i] = loop->timers[(loop->timer_head + i) % loop->timer_capacity];
+        }
+        free(loop->timers);
+        loop->timers = timers;
+        loop->timer_capacity = capacity;
+        loop->timer_head = 0;
+    }
+    
+    ServerTimer* timer = &loop->timers[(loop->timer_head + loop->timer_count) % loop->timer_capacity];
+    timer->deadline_ms = now_ms() + loop->config->decision_ms;
+    timer->table = server_table;
+    timer->generation = ++server_table->wait_generation;
+    loop->timer_count++;
+}
+
+static int get_timer_wait_ms(const ServerLoop* loop) {
+    if (loop->timer_count == 0) {
+        return SERVER_IDLE_WAIT_MS;
+    }
+    int64_t wait = loop->timers[loop->timer_head].deadline_ms - now_ms();
+    return wait <= 0 ? 0 : (int)(wait < SERVER_IDLE_WAIT_MS ? wait : SERVER_IDLE_WAIT_MS);
+}
+
+// ============================================================================
+// TABLE OPERATIONS
+// ============================================================================
+static uint32_t ask_seat(ServerTable* server_table, int seat_idx) {
+    return ++server_table->question_ids[seat_idx];
+}
+
+static void release_seat(ServerTable* server_table, int seat_idx) {
+    ServerLoop* loop = server_table->loop;
+    server_table->seats[seat_idx] = NULL;
+    server_table->seat_states[seat_idx] = SEAT_EMPTY;
+    server_table->taken_count--;
+    if (!server_table->open_listed) {
+        server_table->open_listed = 1;
+        server_table->next_open = loop->open_tables;
+        loop->open_tables = server_table;
+    }
+}
+
+static void start_betting(ServerTable* server_table) {
+    ServerLoop* loop = server_table->loop;
+    Table* table = &server_table->table;
+    int minimum = server_table->game.ruleset.minimum_wager;
+    
+    uint32_t seat_mask = 0;
+    for (int i = 0; i < loop->config->seats_per_table; i++) {
+        if (server_table->seat_states[i] == SEAT_TAKEN) {
+            seat_mask |= 1u << i;
+            server_table->round_chips[i] = table->players[i].chip_count;
+        }
+    }
+    if (seat_mask == 0) {
+        return;     // Idle until someone sits down
+    }
+    
+    start_round(&server_table->game, table, seat_mask);
+    for (int i = 0; i < loop->config->seats_per_table; i++) {
+        if (seat_mask & (1u << i)) {
+            send_line(server_table->seats[i], loop, "BET %u %d %d", ask_seat(server_table, i),
+                      minimum, table->players[i].chip_count);
+        }
+    }
+    arm_table_timer(server_table);
+}
+
+static void free_seats_after_round(ServerTable* server_table) {
+    // Seats left mid-round are free now, seats that went broke are closed
+    ServerLoop* loop = server_table->loop;
+    for (int i = 0; i < loop->config->seats_per_table; i++) {
+        if (server_table->seat_states[i] == SEAT_LEFT) {
+            release_seat(server_table, i);
+        } else if (server_table->seat_states[i] == SEAT_TAKEN &&
+                   server_table->table.players[i].chip_count < server_table->game.ruleset.minimum_wager) {
+            ServerConnection* connection = server_table->seats[i];
+            send_line(connection, loop, "BYE broke");
+            connection->table = NULL;
+            release_seat(server_table, i);
+            close_connection(loop, connection);
+        }
+    }
+}
+
+static void send_results(ServerTable* server_table) {
+    ServerLoop* loop = server_table->loop;
+    Table* table = &server_table->table;
+    char cards[MAX_STRING_LEN];
+    format_cards(&table->dealer.hand, cards, sizeof(cards));
+    int dealer_score = get_hand_score(&table->dealer.hand);
+    for (int i = 0; i < table->active_player_count; i++) {
+        int player_idx = table->active_player_indices[i];
+        int chip_count = table->players[player_idx].chip_count;
+        send_line(server_table->seats[player_idx], loop, "RESULT %d %d %d%s",
+                  chip_count - server_table->round_chips[player_idx], chip_count, dealer_score, cards);
+    }
+}
+
+static void send_deal(ServerTable* server_table) {
+    ServerLoop* loop = server_table->loop;
+    Table* table = &server_table->table;
+    char upcard[3];
+    format_card_label(table->dealer.hand.cards[0], upcard);
+    for (int i = 0; i < table->active_player_count; i++) {
+        int player_idx = table->active_player_indices[i];
+        char cards[MAX_STRING_LEN];
+        format_cards(&table->players[player_idx].hands[0], cards, sizeof(cards));
+        send_line(server_table->seats[player_idx], loop, "DEAL %s%s", upcard, cards);
+    }
+}
+
+static int find_left_awaited_seat(const ServerTable* server_table) {
+    for (int i = 0; i < server_table->loop->config->seats_per_table; i++) {
+        if (server_table->seat_states[i] == SEAT_LEFT && round_awaits_player(&server_table->table, i)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void continue_round(ServerTable* server_table, RoundState previous) {
+    // Called after an answer: tells the seats what it set in motion and asks
+    // the round's next question
+    ServerLoop* loop = server_table->loop;
+    Game* game = &server_table->game;
+    Table* table = &server_table->table;
+    Round* round = &table->round;
+    
+    // Seats that left sit out, decline insurance and stand
+    int dealt = 0;
+    while (1) {
+        if (previous == ROUND_WAGERS && round->state != ROUND_WAGERS && round->state != ROUND_IDLE) {
+            send_deal(server_table);
+            dealt = 1;
+        }
+        previous = round->state;
+        int seat_idx = find_left_awaited_seat(server_table);
+        if (seat_idx < 0) {
+            break;
+        }
+        if (round->state == ROUND_WAGERS) {
+            submit_wager(game, table, seat_idx, 0);
+        } else if (round->state == ROUND_INSURANCE) {
+            submit_insurance(game, table, seat_idx, 0);
+        } else {
+            submit_action(game, table, 's');
+        }
+    }
+    
+    if (round->state == ROUND_INSURANCE && dealt) {
+        // Insurance is asked of every eligible seat at once
+        for (int i = 0; i < table->active_player_count; i++) {
+            int player_idx = table->active_player_indices[i];
+            if (round_awaits_player(table, player_idx)) {
+                send_line(server_table->seats[player_idx], loop, "INSURANCE %u %d",
+                          ask_seat(server_table, player_idx), get_insurance_amount(game, table, player_idx));
+            }
+        }
+        arm_table_timer(server_table);
+    } else if (round->state == ROUND_DECISION) {
+        int player_idx = get_round_player(table);
+        Player* player = &table->players[player_idx];
+        const Hand* hand = get_active_hand(player);
+        char actions[8];
+        char cards[MAX_STRING_LEN];
+        get_allowed_actions(&game->ruleset, player, actions);
+        format_cards(hand, cards, sizeof(cards));
+        send_line(server_table->seats[player_idx], loop, "TURN %u %d %d %s%s",
+                  ask_seat(server_table, player_idx), player->active_hand + 1,
+                  get_hand_score(hand), actions, cards);
+        arm_table_timer(server_table);
+    } else if (round->state == ROUND_SETTLED || round->state == ROUND_IDLE) {
+        // Settled, or nobody wagered
+        if (round->state == ROUND_SETTLED) {
+            send_results(server_table);
+        }
+        end_round(game, table);
+        free_seats_after_round(server_table);
+        start_betting(server_table);
+    }
+}
+
+static void expire_table_wait(ServerTable* server_table) {
+    ServerLoop* loop = server_table->loop;
+    Game* game = &server_table->game;
+    Table* table = &server_table->table;
+    RoundState previous = table->round.state;
+    if (previous == ROUND_DECISION) {
+        loop->stats.timeout_count++;
+        submit_action(game, table, 's');
+        continue_round(server_table, previous);
+        return;
+    }
+    
+    // Unanswered wagers sit out, unanswered insurance is declined; the
+    // seats are listed first, as the last answer moves the round on
+    int late_seats[MAX_PLAYERS];
+    int late_count = 0;
+    for (int i = 0; i < loop->config->seats_per_table; i++) {
+        if (round_awaits_player(table, i)) {
+            late_seats[late_count++] = i;
+        }
+    }
+    for (int i = 0; i < late_count; i++) {
+        loop->stats.timeout_count++;
+        if (previous == ROUND_WAGERS) {
+            submit_wager(game, table, late_seats[i], 0);
+        } else {
+            submit_insurance(game, table, late_seats[i], 0);
+        }
+    }
+    continue_round(server_table, previous);
+}
+
+static void leave_seat(ServerLoop* loop, ServerConnection* connection) {
+    ServerTable* server_table = connection->table;
+    int seat_idx = connection->seat_idx;
+    connection->table = NULL;
+    
+    // A seat keeps its place in the round it may have wagered on
+    RoundState previous = server_table->table.round.state;
+    if (previous == ROUND_IDLE) {
+        release_seat(server_table, seat_idx);
+        return;
+    }
+    server_table->seats[seat_idx] = NULL;
+    server_table->seat_states[seat_idx] = SEAT_LEFT;
+    if (round_awaits_player(&server_table->table, seat_idx)) {
+        continue_round(server_table, previous);
+    }
+}
+
+static ServerTable* create_table(ServerLoop* loop) {
+    if (loop->table_count == loop->table_capacity) {
+        int capacity = loop->table_capacity ? 2 * loop->table_capacity : 64;
+        ServerTable** tables = realloc(loop->tables, (size_t)capacity * sizeof(ServerTable*));
+        if (!tables) {
+            return NULL;
+        }
+        loop->tables = tables;
+        loop->table_capacity = capacity;
+    }
+    ServerTable* server_table = calloc(1, sizeof(ServerTable));
+    if (!server_table) {
+        return NULL;
+    }
+    
+    // Every table deals from its own stream of the server seed
+    server_table->loop = loop;
+    server_table->id = loop->table_count;
+    init_game(&server_table->game, &loop->config->ruleset);
+    init_table(&server_table->table, &loop->config->ruleset,
+               loop->config->seed ^ ((uint64_t)loop->index << 40) ^ (uint64_t)server_table->id);
+    server_table->table.player_count = loop->config->seats_per_table;
+    loop->tables[loop->table_count++] = server_table;
+    loop->stats.table_count++;
+    return server_table;
+}
+
+static int take_seat(ServerLoop* loop, ServerConnection* connection) {
+    // Tables fill up one after the other, reusing seats freed by leavers
+    while (loop->open_tables && loop->open_tables->taken_count >= loop->config->seats_per_table) {
+        loop->open_tables->open_listed = 0;
+        loop->open_tables = loop->open_tables->next_open;
+    }
+    ServerTable* server_table = loop->open_tables;
+    if (!server_table) {
+        server_table = create_table(loop);
+        if (!server_table) {
+            return 0;
+        }
+        server_table->open_listed = 1;
+        server_table->next_open = NULL;
+        loop->open_tables = server_table;
+    }
+    
+    int seat_idx = 0;
+    while (server_table->seat_states[seat_idx] != SEAT_EMPTY) {
+        seat_idx++;
+    }
+    char name[MAX_NAME_LEN];
+    snprintf(name, sizeof(name), "Client %d.%d.%d", loop->index, server_table->id, seat_idx + 1);
+    init_player(&server_table->table.players[seat_idx], name, loop->config->starting_chips);
+    server_table->seats[seat_idx] = connection;
+    server_table->seat_states[seat_idx] = SEAT_TAKEN;
+    server_table->taken_count++;
+    connection->table = server_table;
+    connection->seat_idx = seat_idx;
+    
+    // Global table numbers interleave the loops
+    send_line(connection, loop, "WELCOME %d %d %d %d",
+              server_table->id * loop->config->thread_count + loop->index, seat_idx + 1,
+              loop->config->starting_chips, server_table->game.ruleset.minimum_wager);
+    if (server_table->table.round.state == ROUND_IDLE) {
+        start_betting(server_table);
+    }
+    return 1;
+}
+
+// ============================================================================
+// PROTOCOL OPERATIONS
+// ============================================================================
+static void handle_line(ServerLoop* loop, ServerConnection* connection, const char* line) {
+    char command[16];
+    unsigned int id = 0;
+    char argument[16] = "";
+    int word_count = sscanf(line, "%15s %u %15s", command, &id, argument);
+    if (word_count < 1) {
+        return;     // Blank line
+    }
+    
+    if (strcmp(command, "QUIT") == 0) {
+        send_line(connection, loop, "BYE quit");
+        close_connection(loop, connection);
+        return;
+    }
+    
+    int is_bet = strcmp(command, "BET") == 0;
+    int is_insure = strcmp(command, "INSURE") == 0;
+    int is_act = strcmp(command, "ACT") == 0;
+    if ((!is_bet && !is_insure && !is_act) || word_count < 3) {
+        loop->stats.protocol_error_count++;
+        send_line(connection, loop, "ERROR unknown message");
+        return;
+    }
+    
+    // Answers to anything but the current question are stale, not errors
+    ServerTable* server_table = connection->table;
+    int seat_idx = connection->seat_idx;
+    if (!server_table || id != server_table->question_ids[seat_idx]) {
+        return;
+    }
+    Game* game = &server_table->game;
+    Table* table = &server_table->table;
+    RoundState previous = table->round.state;
+    if (!round_awaits_player(table, seat_idx) || (is_bet && previous != ROUND_WAGERS) ||
+        (is_insure && previous != ROUND_INSURANCE) || (is_act && previous != ROUND_DECISION)) {
+        return;
+    }
+    
+    // An action the hand may not take is refused and the question stays open
+    if (is_act) {
+        char actions[8];
+        get_allowed_actions(&game->ruleset, &table->players[seat_idx], actions);
+        if (strchr(actions, tolower((unsigned char)argument[0])) == NULL) {
+            loop->stats.protocol_error_count++;
+            send_line(connection, loop, "ERROR action not allowed");
+            return;
+        }
+    }
+    
+    loop->stats.decision_count++;
+    if (is_act) {
+        submit_action(game, table, (char)tolower(argument[0]));
+    } else if (is_insure) {
+        submit_insurance(game, table, seat_idx, tolower(argument[0]) == 'y');
+    } else {
+        submit_wager(game, table, seat_idx, atoi(argument));
+    }
+    continue_round(server_table, previous);
+}
+
+static void read_connection(ServerLoop* loop, ServerConnection* connection) {
+    char buffer[SERVER_READ_SIZE];
+    ssize_t result = recv(connection->fd, buffer, sizeof(buffer), 0);
+    if (result <= 0) {
+        if (result == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            close_connection(loop, connection);
+        }
+        return;
+    }
+    
+    for (ssize_t i = 0; i < result && !connection->closing; i++) {
+        char c = buffer[i];
+        if (c == '\n') {
+            connection->input[connection->input_length] = '\0';
+            handle_line(loop, connection, connection->input);
+            connection->input_length = 0;
+        } else if (c != '\r' && connection->input_length < SERVER_MAX_LINE - 1) {
+            connection->input[connection->input_length++] = c;
+        } else if (c != '\r') {
+            loop->stats.protocol_error_count++;
+            send_line(connection, loop, "BYE line too long");
+            close_connection(loop, connection);
+        }
+    }
+}
+
+static void accept_connections(ServerLoop* loop, int listen_fd) {
+    for (int i = 0; i < SERVER_ACCEPT_BATCH; i++) {
+        int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;     // Nothing left, or out of descriptors until someone leaves
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));  // Fails harmlessly on Unix sockets
+        
+        ServerConnection* connection = calloc(1, sizeof(ServerConnection));
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = connection;
+        if (!connection || epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+            free(connection);
+            close(fd);
+            continue;
+        }
+        connection->fd = fd;
+        loop->stats.connection_count++;
+        if (!take_seat(loop, connection)) {
+            send_line(connection, loop, "BYE no table");
+            close_connection(loop, connection);
+        }
+    }
+}
+
+// ============================================================================
+// LOOP OPERATIONS
+// ============================================================================
+static void expire_timers(ServerLoop* loop) {
+    int64_t now = now_ms();
+    while (loop->timer_count > 0 && loop->timers[loop->timer_head].deadline_ms <= now) {
+        ServerTimer timer = loop->timers[loop->timer_head];
+        loop->timer_head = (loop->timer_head + 1) % loop->timer_capacity;
+        loop->timer_count--;
+        
+        // Waits answered in time left their timer behind, and it is ignored
+        ServerTable* server_table = timer.table;
+        if (timer.generation == server_table->wait_generation && server_table->table.round.state != ROUND_IDLE) {
+            expire_table_wait(server_table);
+        }
+    }
+}
+
+static void finish_loop_pass(ServerLoop* loop) {
+    // Leaving may move tables on, which writes to other connections,
+    // which may close them in turn, so both lists are drained together
+    ServerConnection* closed = NULL;
+    while (loop->closing_list || loop->dirty_list) {
+        while (loop->closing_list) {
+            ServerConnection* connection = loop->closing_list;
+            loop->closing_list = connection->next_closing;
+            if (connection->table) {
+                leave_seat(loop, connection);
+            }
+            connection->next_closing = closed;
+            closed = connection;
+        }
+        while (loop->dirty_list) {
+            ServerConnection* connection = loop->dirty_list;
+            loop->dirty_list = connection->next_dirty;
+            connection->dirty = 0;
+            flush_connection(loop, connection);
+        }
+    }
+    
+    while (closed) {
+        ServerConnection* connection = closed;
+        closed = connection->next_closing;
+        close(connection->fd);
+        free(connection);
+        loop->stats.disconnect_count++;
+    }
+}
+
+static void* server_loop_thread(void* argument) {
+    ServerLoop* loop = (ServerLoop*)argument;
+    struct epoll_event events[SERVER_EVENT_BATCH];
+    
+    while (!g_server_stopping) {
+        int event_count = epoll_wait(loop->epoll_fd, events, SERVER_EVENT_BATCH, get_timer_wait_ms(loop));
+        for (int i = 0; i < event_count; i++) {
+            void* owner = events[i].data.ptr;
+            if (owner >= (void*)loop->listen_fds && owner < (void*)(loop->listen_fds + loop->listen_count)) {
+                accept_connections(loop, *(const int*)owner);
+                continue;
+            }
+            ServerConnection* connection = (ServerConnection*)owner;
+            if (connection->closing) {
+                continue;
+            }
+            // Pending input is read first, the hangup shows up as end of file
+            if (events[i].events & EPOLLIN) {
+                read_connection(loop, connection);
+            } else if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                close_connection(loop, connection);
+            }
+            if ((events[i].events & EPOLLOUT) && !connection->closing) {
+                flush_connection(loop, connection);
+            }
+        }
+        expire_timers(loop);
+        finish_loop_pass(loop);
+    }
+    
+    // Say goodbye to whoever is still seated
+    for (int t = 0; t < loop->table_count; t++) {
+        ServerTable* server_table = loop->tables[t];
+        for (int i = 0; i < MAX_PLAYERS; i++) {
+            ServerConnection* connection = server_table->seats[i];
+            if (connection) {
+                send_line(connection, loop, "BYE shutdown");
+                connection->table = NULL;
+                close_connection(loop, connection);
+            }
+        }
+    }
+    finish_loop_pass(loop);
+    return NULL;
+}
+
+// ============================================================================
+// SERVER OPERATIONS
+// ============================================================================
+static int open_tcp_listener(const ServerConfig* config) {
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)config->port);
+    if (inet_pton(AF_INET, config->host, &address.sin_addr) != 1) {
+        fprintf(stderr, "Bad listen address \"%s\"\n", config->host);
+        return -1;
+    }
+    
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int on = 1;
+    if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0 ||
+        bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        fprintf(stderr, "Cannot listen on %s:%d: %s\n", config->host, config->port, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+static int open_unix_listener(const ServerConfig* config) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(config->unix_path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path \"%s\" is too long\n", config->unix_path);
+        return -1;
+    }
+    SAFE_STRCPY(address.sun_path, config->unix_path, sizeof(address.sun_path));
+    unlink(config->unix_path);
+    
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        fprintf(stderr, "Cannot listen on %s: %s\n", config->unix_path, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+static void free_server_loop(ServerLoop* loop) {
+    for (int t = 0; t < loop->table_count; t++) {
+        free(loop->tables[t]);
+    }
+    free(loop->tables);
+    free(loop->timers);
+    if (loop->epoll_fd > 0) {
+        close(loop->epoll_fd);
+    }
+}
+
+int run_server(const ServerConfig* config, ServerStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    init_game_stats(&stats->game_stats);
+    if (config->thread_count <= 0 || config->thread_count > SERVER_MAX_THREADS ||
+        config->seats_per_table <= 0 || config->seats_per_table > config->ruleset.maximum_player_count ||
+        config->decision_ms <= 0 || config->starting_chips < config->ruleset.minimum_wager ||
+        (config->port <= 0 && !config->unix_path)) {
+        return 0;
+    }
+    
+    // Every loop watches the same listeners; EPOLLEXCLUSIVE wakes one of them
+    int listen_fds[2];
+    int listen_count = 0;
+    if (config->port > 0) {
+        listen_fds[listen_count] = open_tcp_listener(config);
+        if (listen_fds[listen_count] >= 0) {
+            printf("Listening on %s:%d\n", config->host, config->port);
+            listen_count++;
+        }
+    }
+    if (config->unix_path) {
+        listen_fds[listen_count] = open_unix_listener(config);
+        if (listen_fds[listen_count] >= 0) {
+            printf("Listening on %s\n", config->unix_path);
+            listen_count++;
+        }
+    }
+    fflush(stdout);
+    if (listen_count < (config->port > 0) + (config->unix_path != NULL)) {
+        for (int i = 0; i < listen_count; i++) {
+            close(listen_fds[i]);
+        }
+        return 0;
+    }
+    
+    set_verbosity(VERBOSITY_SILENT);
+    g_server_stopping = 0;
+    ServerLoop* loops = calloc((size_t)config->thread_count, sizeof(ServerLoop));
+    int started = 0;
+    int ok = loops != NULL;
+    for (int i = 0; ok && i < config->thread_count; i++) {
+        ServerLoop* loop = &loops[i];
+        loop->config = config;
+        loop->index = i;
+        loop->listen_fds = listen_fds;
+        loop->listen_count = listen_count;
+        loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        for (int l = 0; loop->epoll_fd >= 0 && l < listen_count; l++) {
+            struct epoll_event event;
+            event.events = EPOLLIN | EPOLLEXCLUSIVE;
+            event.data.ptr = (void*)&listen_fds[l];
+            if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, listen_fds[l], &event) < 0) {
+                ok = 0;
+            }
+        }
+        if (loop->epoll_fd < 0 || !ok || pthread_create(&loop->thread, NULL, server_loop_thread, loop) != 0) {
+            ok = 0;
+            break;
+        }
+        started++;
+    }
+    if (!ok) {
+        stop_server();
+    }
+    
+    for (int i = 0; i < started; i++) {
+        ServerLoop* loop = &loops[i];
+        pthread_join(loop->thread, NULL);
+        for (int t = 0; t < loop->table_count; t++) {
+            merge_game_stats(&loop->stats.game_stats, &loop->tables[t]->game.stats);
+        }
+        stats->connection_count += loop->stats.connection_count;
+        stats->disconnect_count += loop->stats.disconnect_count;
+        stats->table_count += loop->stats.table_count;
+        stats->decision_count += loop->stats.decision_count;
+        stats->timeout_count += loop->stats.timeout_count;
+        stats->protocol_error_count += loop->stats.protocol_error_count;
+        stats->dropped_count += loop->stats.dropped_count;
+        merge_game_stats(&stats->game_stats, &loop->stats.game_stats);
+    }
+    for (int i = 0; loops && i < config->thread_count; i++) {
+        free_server_loop(&loops[i]);
+    }
+    free(loops);
+    for (int i = 0; i < listen_count; i++) {
+        close(listen_fds[i]);
+    }
+    if (config->unix_path) {
+        unlink(config->unix_path);
+    }
+    return ok;
+}
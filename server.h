@@ -0,0 +1,75 @@
+/*
+ * UNIJACK - Table server
+ * Hosts many tables at once for players connected over TCP or Unix
+ * sockets. Every event loop thread owns its tables and connections and
+ * never blocks: a table waiting for an answer simply leaves its round
+ * suspended until the answer or the decision timeout arrives.
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "blackjack.h"
+
+#include <pthread.h>
+
+// Protocol, one line of space separated words per message
+//
+// Server to client
+//   WELCOME table seat chips minimum      seated, plays from the next round
+//   BET id minimum maximum                wager for the round, 0 sits out
+//   DEAL upcard card card                 dealer upcard, then the seat's cards
+//   INSURANCE id amount                   dealer shows an ace
+//   TURN id hand score actions card...    decision for hand (1-based), actions
+//                                         are the PlayerPolicy letters allowed
+//   RESULT net chips dealer_score card... round settled, net over all hands
+//   ERROR text                            line not understood or action not
+//                                         allowed, ignored; the question stays open
+//   BYE reason                            the server closes the connection
+// Client to server
+//   BET id chips        INSURE id y|n       ACT id letter       QUIT
+// Answers carry the id of their question; a late answer to a question
+// already decided by its timeout is dropped. Cards are rank and suit,
+// "A23456789TJQK" and "shdc", e.g. Ts for the ten of spades.
+// Timed out questions default to sitting out, no insurance and stand.
+#define SERVER_DEFAULT_PORT 7021
+#define SERVER_DEFAULT_DECISION_MS 5000
+#define SERVER_DEFAULT_CHIPS 1000
+#define SERVER_MAX_THREADS 256
+#define SERVER_MAX_LINE 256
+
+// A connection that lets this much output pile up is dropped
+#define SERVER_OUTPUT_BUFFER_SIZE 8192
+
+// Server configuration structure
+typedef struct {
+    Ruleset ruleset;
+    const char* host;           // TCP address to listen on
+    int port;                   // 0 = no TCP listener
+    const char* unix_path;      // NULL = no Unix socket
+    int thread_count;
+    int seats_per_table;
+    int decision_ms;            // Time allowed for every answer
+    int starting_chips;
+    uint64_t seed;
+} ServerConfig;
+
+// Server statistics structure - totals over every event loop
+typedef struct {
+    long long connection_count;
+    long long disconnect_count;
+    long long table_count;
+    long long decision_count;   // Answers received in time
+    long long timeout_count;
+    long long protocol_error_count;
+    long long dropped_count;    // Connections too slow to read their output
+    GameStats game_stats;
+} ServerStats;
+
+// Function declarations - Server operations
+void init_server_config(ServerConfig* config, const Ruleset* ruleset);
+int run_server(const ServerConfig* config, ServerStats* stats);
+void stop_server(void);
+void format_card_label(Card card, char* label);
+
+#endif // SERVER_H
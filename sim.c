@@ -0,0 +1,980 @@
+/*
+ * UNIJACK - Headless simulation
+ * Implementation
+ */
+
+#include "sim.h"
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+// ============================================================================
+// BUILT-IN POLICIES
+// ============================================================================
+int flat_minimum_wager(void* context, const Game* game, const Table* table, int player_idx) {
+    (void)context;
+    (void)table;
+    (void)player_idx;
+    return game->ruleset.minimum_wager;
+}
+
+char mimic_dealer_action(void* context, const Game* game, const Table* table, int player_idx) {
+    (void)context;
+    (void)game;
+    return get_hand_score(get_active_hand(&table->players[player_idx])) < MINIMUM_DEALER_SCORE ? 'h' : 's';
+}
+
+char never_bust_action(void* context, const Game* game, const Table* table, int player_idx) {
+    (void)context;
+    (void)game;
+    // 11 or less cannot bust on the next card
+    return get_hand_score(get_active_hand(&table->players[player_idx])) <= 11 ? 'h' : 's';
+}
+
+char always_stand_action(void* context, const Game* game, const Table* table, int player_idx) {
+    (void)context;
+    (void)game;
+    (void)table;
+    (void)player_idx;
+    return 's';
+}
+
+// hit_below is the same decision as a threshold, for the batch engine
+static const struct {
+    const char* name;
+    PlayerPolicy policy;
+    int hit_below;
+} SIM_POLICIES[] = {
+    {"mimic", {flat_minimum_wager, mimic_dealer_action, NULL, NULL}, MINIMUM_DEALER_SCORE},
+    {"never-bust", {flat_minimum_wager, never_bust_action, NULL, NULL}, 12},
+    {"stand", {flat_minimum_wager, always_stand_action, NULL, NULL}, 0},
+};
+
+#define SIM_POLICY_COUNT ((int)(sizeof(SIM_POLICIES) / sizeof(SIM_POLICIES[0])))
+
+const PlayerPolicy* find_sim_policy(const char* name) {
+    for (int i = 0; i < SIM_POLICY_COUNT; i++) {
+        if (strcmp(SIM_POLICIES[i].name, name) == 0) {
+            return &SIM_POLICIES[i].policy;
+        }
+    }
+    return NULL;
+}
+
+int sim_policy_hit_below(const PlayerPolicy* policy) {
+    for (int i = 0; i < SIM_POLICY_COUNT; i++) {
+        if (policy == &SIM_POLICIES[i].policy) {
+            return SIM_POLICIES[i].hit_below;
+        }
+    }
+    return -1;  // Not a threshold policy
+}
+
+void list_sim_policies(FILE* stream) {
+    for (int i = 0; i < SIM_POLICY_COUNT; i++) {
+        fprintf(stream, "%s%s", i > 0 ? ", " : "", SIM_POLICIES[i].name);
+    }
+    fprintf(stream, "\n");
+}
+
+// ============================================================================
+// SIMULATION OPERATIONS
+// ============================================================================
+void init_sim_config(SimConfig* config, const Ruleset* ruleset) {
+    config->ruleset = *ruleset;
+    config->round_count = 1000000;
+    config->player_count = 1;
+    config->seed = (uint64_t)time(NULL);
+    config->policy = &SIM_POLICIES[0].policy;
+    config->thread_count = 1;
+    config->chunk_rounds = SIM_DEFAULT_CHUNK_ROUNDS;
+    config->batch_tables = 0;
+    config->verbosity = VERBOSITY_SILENT;
+    config->history = NULL;
+    config->checkpoint_path = NULL;
+    config->checkpoint_seconds = SIM_DEFAULT_CHECKPOINT_SECONDS;
+    config->resume = 0;
+    config->antithetic = 0;
+    config->target_edge_width = 0.0;
+    config->time_budget_seconds = 0.0;
+}
+
+double sim_clock_seconds(void) {
+#ifdef _WIN32
+    return (double)clock() / CLOCKS_PER_SEC;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+static void seat_sim_table(const SimConfig* config, Game* game, Table* table, const SimChunk* chunk,
+                           const RoundObserver* observer) {
+    init_table(table, &config->ruleset, 0);
+    table->shoe.antithetic = chunk->antithetic;
+    restart_shoe(&table->shoe, &chunk->rng);
+    
+    int player_count = safe_min(config->player_count, config->ruleset.maximum_player_count);
+    for (int i = 0; i < player_count; i++) {
+        char name[MAX_NAME_LEN];
+        snprintf(name, sizeof(name), "Seat %d", i + 1);
+        init_player(&table->players[i], name, SIM_STARTING_CHIPS);
+    }
+    table->player_count = player_count;
+    
+    init_game(game, &config->ruleset);
+    game->policy = config->policy;
+    game->observer = observer;
+}
+
+static void top_up_sim_seats(const SimConfig* config, Table* table) {
+    for (int i = 0; i < table->player_count; i++) {
+        if (table->players[i].chip_count < config->ruleset.minimum_wager) {
+            table->players[i].chip_count = SIM_STARTING_CHIPS;
+        }
+    }
+}
+
+static int play_sim_rounds(const SimConfig* config, Game* game, Table* table, SimChunk* chunk,
+                           const RoundObserver* observer, atomic_int* stopped) {
+    // Returns 0 when *stopped cut the chunk short; stopped NULL = never
+    seat_sim_table(config, game, table, chunk, observer);
+    init_round_moments(&chunk->moments);
+    long long net = 0, wagered = 0;
+    for (long long round = 0; round < chunk->round_count; round++) {
+        if (stopped && atomic_load_explicit(stopped, memory_order_acquire)) {
+            return 0;
+        }
+        top_up_sim_seats(config, table);
+        if (play_new_round(game, table) == 0) {
+            break;
+        }
+        // The round's net and wager are what it added to the running totals
+        long long next_net = game->stats.total_paid - game->stats.total_wagered;
+        add_round_moments(&chunk->moments, next_net - net, game->stats.total_wagered - wagered,
+                          config->ruleset.minimum_wager);
+        net = next_net;
+        wagered = game->stats.total_wagered;
+    }
+    chunk->stats = game->stats;
+    return 1;
+}
+
+void play_sim_chunk(const SimConfig* config, Game* game, Table* table, SimChunk* chunk,
+                    const RoundObserver* observer) {
+    play_sim_rounds(config, game, table, chunk, observer, NULL);
+}
+
+static int same_shoe_shape(const Shoe* first, const Shoe* second) {
+    return first->total_cards == second->total_cards && first->auto_shuffling == second->auto_shuffling &&
+           first->return_delay == second->return_delay && first->cut_card_index == second->cut_card_index;
+}
+
+static void play_paired_chunk(const SimConfig* config, const SimConfig* versus, Game games[2],
+                              Table* tables[2], SimChunk* chunk) {
+    // Common random numbers: the second side replays the shoe the first
+    // starts each round with, cards and random stream alike
+    seat_sim_table(config, &games[0], tables[0], chunk, NULL);
+    seat_sim_table(versus, &games[1], tables[1], chunk, NULL);
+    int shared = same_shoe_shape(&tables[0]->shoe, &tables[1]->shoe);
+    
+    for (long long round = 0; round < chunk->round_count; round++) {
+        top_up_sim_seats(config, tables[0]);
+        top_up_sim_seats(versus, tables[1]);
+        if (shared) {
+            tables[1]->shoe = tables[0]->shoe;
+        }
+        if (play_new_round(&games[0], tables[0]) == 0 || play_new_round(&games[1], tables[1]) == 0) {
+            break;
+        }
+    }
+    chunk->stats = games[0].stats;
+    chunk->versus_stats = games[1].stats;
+}
+
+// ============================================================================
+// PARALLEL RUNNER
+// ============================================================================
+// Every worker owns a range of chunk indices [head, tail). It takes work
+// from the head of its own range and, once empty, steals the upper half of
+// the busiest other range. Chunk results land in their own slots and are
+// summed in index order, so thread timing never changes the totals. A run
+// with a stopping rule puts every chunk in the first range and all workers
+// take from it, which plays chunks in index order; emptying that range
+// stops the run, and the stopped flag drops the chunks still being played,
+// which all lie past the finished prefix the results are taken from.
+
+typedef struct {
+    pthread_mutex_t lock;
+    long long head;
+    long long tail;
+} ChunkRange;
+
+typedef struct {
+    const SimConfig* config;
+    const SimConfig* versus;    // Second side of a comparison, NULL = none
+    SimChunk* chunks;
+    ChunkRange ranges[SIM_MAX_THREADS];
+    int thread_count;
+    long long steal_count;
+    pthread_mutex_t steal_lock;
+    pthread_mutex_t done_lock;  // Guards chunk done flags and running_workers
+    pthread_cond_t worker_exited;
+    int running_workers;
+    int shared_range;           // Every worker takes from ranges[0]
+    long long chunk_count;
+    long long prefix_count;     // Finished chunks before the first unfinished one
+    RoundMoments prefix_moments;
+    int stop_reason;
+    atomic_int stopped;         // Set with stop_reason, workers drop their chunks
+} SimRun;
+
+typedef struct {
+    SimRun* run;
+    int worker_idx;
+} SimWorker;
+
+static long long take_own_chunk(ChunkRange* range) {
+    long long chunk = -1;
+    pthread_mutex_lock(&range->lock);
+    if (range->head < range->tail) {
+        chunk = range->head++;
+    }
+    pthread_mutex_unlock(&range->lock);
+    return chunk;
+}
+
+static int steal_chunks(SimRun* run, int thief_idx) {
+    // Pick the victim with the most chunks left; counts are only a hint
+    int victim = -1;
+    long long most = 0;
+    for (int i = 0; i < run->thread_count; i++) {
+        long long left = run->ranges[i].tail - run->ranges[i].head;
+        if (i != thief_idx && left > most) {
+            most = left;
+            victim = i;
+        }
+    }
+    if (victim < 0) {
+        return 0;
+    }
+    
+    ChunkRange* from = &run->ranges[victim];
+    long long head = 0, tail = 0;
+    pthread_mutex_lock(&from->lock);
+    if (from->head < from->tail) {
+        tail = from->tail;
+        head = from->tail - (from->tail - from->head + 1) / 2;
+        from->tail = head;
+    }
+    pthread_mutex_unlock(&from->lock);
+    if (head == tail) {
+        return 1;  // Lost the race, look again
+    }
+    
+    ChunkRange* to = &run->ranges[thief_idx];
+    pthread_mutex_lock(&to->lock);
+    to->head = head;
+    to->tail = tail;
+    pthread_mutex_unlock(&to->lock);
+    
+    pthread_mutex_lock(&run->steal_lock);
+    run->steal_count++;
+    pthread_mutex_unlock(&run->steal_lock);
+    return 1;
+}
+
+static long long next_chunk(SimRun* run, int worker_idx) {
+    while (1) {
+        long long chunk = take_own_chunk(&run->ranges[run->shared_range ? 0 : worker_idx]);
+        if (chunk >= 0 && run->chunks[chunk].done) {
+            continue;  // Finished before a resume
+        }
+        if (chunk >= 0 || run->shared_range || !steal_chunks(run, worker_idx)) {
+            return chunk;
+        }
+    }
+}
+
+static void finish_chunk(SimRun* run, long long chunk) {
+    // The lock publishes the chunk's stats to the checkpoint writer
+    pthread_mutex_lock(&run->done_lock);
+    run->chunks[chunk].done = 1;
+    pthread_mutex_unlock(&run->done_lock);
+}
+
+static void run_scalar_worker(SimRun* run, int worker_idx) {
+    Table* table = malloc(sizeof(Table));
+    HistoryWriter* writer = run->config->history ? malloc(sizeof(HistoryWriter)) : NULL;
+    Game game;
+    if (!table || (run->config->history && (!writer || !init_history_writer(writer, run->config->history)))) {
+        free(table);
+        free(writer);
+        return;  // Others steal this worker's range
+    }
+    
+    long long chunk;
+    while ((chunk = next_chunk(run, worker_idx)) >= 0) {
+        if (writer) {
+            begin_history_chunk(writer, chunk);
+        }
+        if (!play_sim_rounds(run->config, &game, table, &run->chunks[chunk], writer ? &writer->observer : NULL,
+                             &run->stopped)) {
+            break;  // Left unfinished, outside the results
+        }
+        finish_chunk(run, chunk);
+    }
+    if (writer) {
+        close_history_writer(writer);
+    }
+    free(writer);
+    free(table);
+}
+
+static void run_paired_worker(SimRun* run, int worker_idx) {
+    Table* tables[2] = {malloc(sizeof(Table)), malloc(sizeof(Table))};
+    Game games[2];
+    long long chunk;
+    while (tables[0] && tables[1] && (chunk = next_chunk(run, worker_idx)) >= 0) {
+        play_paired_chunk(run->config, run->versus, games, tables, &run->chunks[chunk]);
+        finish_chunk(run, chunk);
+    }
+    free(tables[0]);
+    free(tables[1]);
+}
+
+static void run_batch_worker(SimRun* run, int worker_idx) {
+    // Every lane of the engine plays one chunk; a lane that finishes
+    // hands its stats over and picks up the next chunk right away
+    const SimConfig* config = run->config;
+    BatchEngine engine;
+    long long* lane_chunks = malloc(config->batch_tables * sizeof(long long));
+    if (!lane_chunks || !init_batch_engine(&engine, &config->ruleset, config->batch_tables,
+                                           config->player_count, sim_policy_hit_below(config->policy))) {
+        free(lane_chunks);
+        return;
+    }
+    
+    int running = 0;
+    for (int lane = 0; lane < engine.lane_count; lane++) {
+        lane_chunks[lane] = next_chunk(run, worker_idx);
+        if (lane_chunks[lane] < 0) {
+            break;
+        }
+        SimChunk* chunk = &run->chunks[lane_chunks[lane]];
+        load_batch_lane(&engine, lane, &chunk->rng, chunk->antithetic, chunk->round_count);
+        running++;
+    }
+    
+    while (running > 0 && !atomic_load_explicit(&run->stopped, memory_order_acquire)) {
+        if (play_batch_round(&engine) == 0) {
+            continue;
+        }
+        for (int lane = 0; lane < engine.lane_count; lane++) {
+            SimChunk* done = &run->chunks[lane_chunks[lane]];
+            if (!take_batch_lane_stats(&engine, lane, &done->stats, &done->moments)) {
+                continue;
+            }
+            finish_chunk(run, lane_chunks[lane]);
+            running--;
+            lane_chunks[lane] = next_chunk(run, worker_idx);
+            if (lane_chunks[lane] >= 0) {
+                SimChunk* chunk = &run->chunks[lane_chunks[lane]];
+                load_batch_lane(&engine, lane, &chunk->rng, chunk->antithetic, chunk->round_count);
+                running++;
+            }
+        }
+    }
+    
+    free_batch_engine(&engine);
+    free(lane_chunks);
+}
+
+static void* sim_worker_thread(void* argument) {
+    SimWorker* worker = (SimWorker*)argument;
+    if (worker->run->versus) {
+        run_paired_worker(worker->run, worker->worker_idx);
+    } else if (worker->run->config->batch_tables > 0) {
+        run_batch_worker(worker->run, worker->worker_idx);
+    } else {
+        run_scalar_worker(worker->run, worker->worker_idx);
+    }
+    pthread_mutex_lock(&worker->run->done_lock);
+    worker->run->running_workers--;
+    pthread_cond_signal(&worker->run->worker_exited);
+    pthread_mutex_unlock(&worker->run->done_lock);
+    return NULL;
+}
+
+// ============================================================================
+// CHECKPOINT OPERATIONS
+// ============================================================================
+// A checkpoint holds a header and the stats of every finished chunk:
+//   char[4] magic "UJCK"   u32 version   u64 run fingerprint
+//   u64 chunk count        u64 finished chunk count
+//   then per finished chunk: u64 chunk index, GameStats, RoundMoments
+// Chunks are independent and start from a fresh shoe, so their stats are
+// all the state a resumed run needs. Files are written under a temporary
+// name and renamed, so a crash never leaves a half-written checkpoint.
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t fingerprint;
+    uint64_t chunk_count;
+    uint64_t done_count;
+} SimCheckpointHeader;
+
+static uint64_t mix_fingerprint(uint64_t hash, uint64_t value) {
+    // FNV-1a over the value's bytes
+    for (int i = 0; i < 8; i++) {
+        hash ^= (value >> (8 * i)) & 0xFF;
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static uint64_t sim_fingerprint(const SimConfig* config, long long chunk_count) {
+    // Everything that decides a chunk's stats; threads and batching do not
+    const Ruleset* ruleset = &config->ruleset;
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    hash = mix_fingerprint(hash, config->seed);
+    hash = mix_fingerprint(hash, (uint64_t)config->round_count);
+    hash = mix_fingerprint(hash, (uint64_t)chunk_count);
+    hash = mix_fingerprint(hash, (uint64_t)config->player_count);
+    hash = mix_fingerprint(hash, (uint64_t)(int64_t)sim_policy_hit_below(config->policy));
+    hash = mix_fingerprint(hash, (uint64_t)ruleset->maximum_player_count);
+    hash = mix_fingerprint(hash, (uint64_t)ruleset->deck_count_in_shoe);
+    hash = mix_fingerprint(hash, (uint64_t)ruleset->auto_shuffling_shoe);
+    hash = mix_fingerprint(hash, (uint64_t)ruleset->minimum_wager);
+    hash = mix_fingerprint(hash, (uint64_t)ruleset->dealer_receives_hole_card);
+    hash = mix_fingerprint(hash, (uint64_t)ruleset->dealer_reveals_blackjack_hand);
+    hash = mix_fingerprint(hash, (uint64_t)(ruleset->blackjack_payout_numerator * 1000000LL /
+            ruleset->blackjack_payout_denominator));
+    hash = mix_fingerprint(hash, (uint64_t)ruleset->machine_return_delay);
+    hash = mix_fingerprint(hash, (uint64_t)(ruleset->cut_card_penetration * 1e6));
+    hash = mix_fingerprint(hash, (uint64_t)ruleset->double_down_allowed);
+    hash = mix_fingerprint(hash, (uint64_t)ruleset->double_after_split);
+    hash = mix_fingerprint(hash, (uint64_t)ruleset->max_split_hands);
+    hash = mix_fingerprint(hash, (uint64_t)ruleset->resplit_aces);
+    hash = mix_fingerprint(hash, (uint64_t)ruleset->hit_split_aces);
+    hash = mix_fingerprint(hash, (uint64_t)ruleset->late_surrender);
+    hash = mix_fingerprint(hash, (uint64_t)ruleset->insurance_offered);
+    hash = mix_fingerprint(hash, (uint64_t)config->antithetic);
+    return hash;
+}
+
+static int write_sim_checkpoint(SimRun* run, long long chunk_count, uint64_t fingerprint) {
+    // Copy under the lock, write outside it; workers never wait on the disk
+    size_t entry_size = sizeof(uint64_t) + sizeof(GameStats) + sizeof(RoundMoments);
+    uint8_t* entries = malloc((size_t)(chunk_count > 0 ? chunk_count : 1) * entry_size);
+    if (!entries) {
+        return 0;
+    }
+    SimCheckpointHeader header;
+    memcpy(header.magic, SIM_CHECKPOINT_MAGIC, 4);
+    header.version = SIM_CHECKPOINT_VERSION;
+    header.fingerprint = fingerprint;
+    header.chunk_count = (uint64_t)chunk_count;
+    header.done_count = 0;
+    
+    pthread_mutex_lock(&run->done_lock);
+    for (long long i = 0; i < chunk_count; i++) {
+        if (run->chunks[i].done) {
+            uint8_t* entry = &entries[header.done_count++ * entry_size];
+            uint64_t chunk_idx = (uint64_t)i;
+            memcpy(entry, &chunk_idx, sizeof(chunk_idx));
+            memcpy(entry + sizeof(chunk_idx), &run->chunks[i].stats, sizeof(GameStats));
+            memcpy(entry + sizeof(chunk_idx) + sizeof(GameStats), &run->chunks[i].moments,
+                   sizeof(RoundMoments));
+        }
+    }
+    pthread_mutex_unlock(&run->done_lock);
+    
+    char temp_path[MAX_STRING_LEN * 4];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", run->config->checkpoint_path);
+    FILE* file = fopen(temp_path, "wb");
+    int ok = file != NULL;
+    if (file) {
+        ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(entries, entry_size, header.done_count, file) == header.done_count &&
+             fflush(file) == 0 && fsync(fileno(file)) == 0;
+        ok = (fclose(file) == 0) && ok;
+    }
+    free(entries);
+    if (!ok || rename(temp_path, run->config->checkpoint_path) != 0) {
+        unlink(temp_path);
+        return 0;
+    }
+    return 1;
+}
+
+static int load_sim_checkpoint(const SimConfig* config, SimChunk* chunks, long long chunk_count,
+                               uint64_t fingerprint, SimResult* result) {
+    // A missing file is a fresh start; a file from another run is an error
+    FILE* file = fopen(config->checkpoint_path, "rb");
+    if (!file) {
+        return errno == ENOENT;
+    }
+    SimCheckpointHeader header;
+    int ok = fread(&header, sizeof(header), 1, file) == 1 &&
+             memcmp(header.magic, SIM_CHECKPOINT_MAGIC, 4) == 0 &&
+             header.version == SIM_CHECKPOINT_VERSION && header.fingerprint == fingerprint &&
+             header.chunk_count == (uint64_t)chunk_count && header.done_count <= header.chunk_count;
+    for (uint64_t i = 0; ok && i < header.done_count; i++) {
+        uint64_t chunk_idx;
+        GameStats stats;
+        RoundMoments moments;
+        ok = fread(&chunk_idx, sizeof(chunk_idx), 1, file) == 1 &&
+             fread(&stats, sizeof(stats), 1, file) == 1 && fread(&moments, sizeof(moments), 1, file) == 1 &&
+             chunk_idx < header.chunk_count && !chunks[chunk_idx].done;
+        if (ok) {
+            chunks[chunk_idx].stats = stats;
+            chunks[chunk_idx].moments = moments;
+            chunks[chunk_idx].done = 1;
+            result->resumed_chunk_count++;
+            result->resumed_round_count += stats.round_count;
+        }
+    }
+    fclose(file);
+    return ok;
+}
+
+int default_sim_thread_count(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? safe_min((int)count, SIM_MAX_THREADS) : 1;
+#else
+    return 1;
+#endif
+}
+
+static long long get_sim_chunk_count(const SimConfig* config) {
+    long long chunk_rounds = config->chunk_rounds > 0 ? config->chunk_rounds : SIM_DEFAULT_CHUNK_ROUNDS;
+    return (config->round_count + chunk_rounds - 1) / chunk_rounds;
+}
+
+static void wait_for_workers(SimRun* run, double seconds) {
+    // Returns once every worker is gone or the time is up; done_lock held
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    long long ns = deadline.tv_nsec + (long long)((seconds > 0.0 ? seconds : 0.0) * 1e9);
+    deadline.tv_sec += (time_t)(ns / 1000000000LL);
+    deadline.tv_nsec = (long)(ns % 1000000000LL);
+    int wait = 0;
+    while (run->running_workers > 0 && wait != ETIMEDOUT) {
+        wait = pthread_cond_timedwait(&run->worker_exited, &run->done_lock, &deadline);
+    }
+}
+
+static void check_stop_rules(SimRun* run, double elapsed_seconds) {
+    // Extends the prefix over the chunks finished since the last check,
+    // testing the precision after each one; done_lock held
+    const SimConfig* config = run->config;
+    while (run->stop_reason != SIM_STOP_PRECISION && run->prefix_count < run->chunk_count &&
+           run->chunks[run->prefix_count].done) {
+        merge_round_moments(&run->prefix_moments, &run->chunks[run->prefix_count++].moments);
+        if (config->target_edge_width > 0.0 &&
+            2.0 * 1.96 * get_player_edge_error(&run->prefix_moments) <= config->target_edge_width) {
+            run->stop_reason = SIM_STOP_PRECISION;
+        }
+    }
+    if (run->stop_reason == SIM_STOP_ROUNDS && run->prefix_count < run->chunk_count &&
+        config->time_budget_seconds > 0.0 && elapsed_seconds >= config->time_budget_seconds) {
+        run->stop_reason = SIM_STOP_TIME;
+    }
+    if (run->stop_reason != SIM_STOP_ROUNDS) {
+        // Hand out nothing more and drop the chunks being played
+        pthread_mutex_lock(&run->ranges[0].lock);
+        run->ranges[0].tail = run->ranges[0].head;
+        pthread_mutex_unlock(&run->ranges[0].lock);
+        atomic_store_explicit(&run->stopped, 1, memory_order_release);
+    }
+}
+
+static int run_chunks(const SimConfig* config, const SimConfig* versus, SimResult* result,
+                      SimChunk** kept_chunks) {
+    // Plays every chunk of config, side by side with versus when set; the
+    // caller takes over the chunks when it asks for them
+    long long chunk_rounds = config->chunk_rounds > 0 ? config->chunk_rounds : SIM_DEFAULT_CHUNK_ROUNDS;
+    long long chunk_count = get_sim_chunk_count(config);
+    
+    SimRun* run = calloc(1, sizeof(SimRun));
+    SimChunk* chunks = calloc((size_t)(chunk_count > 0 ? chunk_count : 1), sizeof(SimChunk));
+    if (!run || !chunks) {
+        free(run);
+        free(chunks);
+        return 0;
+    }
+    
+    // Chunk i gets the master stream jumped i times ahead; antithetic
+    // chunks come in pairs on one stream, the second mirroring the first
+    Rng master;
+    rng_seed(&master, config->seed);
+    for (long long i = 0; i < chunk_count; i++) {
+        if (config->antithetic && i % 2 == 1) {
+            chunks[i].rng = chunks[i - 1].rng;
+            chunks[i].antithetic = 1;
+        } else {
+            rng_split(&master, &chunks[i].rng);
+        }
+        long long left = config->round_count - i * chunk_rounds;
+        chunks[i].round_count = left < chunk_rounds ? left : chunk_rounds;
+    }
+    
+    result->resumed_chunk_count = 0;
+    result->resumed_round_count = 0;
+    result->checkpoint_count = 0;
+    uint64_t fingerprint = sim_fingerprint(config, chunk_count);
+    if (config->checkpoint_path && config->resume &&
+        !load_sim_checkpoint(config, chunks, chunk_count, fingerprint, result)) {
+        fprintf(stderr, "Cannot resume from \"%s\", it is damaged or from another run\n", config->checkpoint_path);
+        free(run);
+        free(chunks);
+        return 0;
+    }
+    
+    int thread_count = safe_max(1, safe_min(config->thread_count, SIM_MAX_THREADS));
+    if (thread_count > chunk_count) {
+        thread_count = chunk_count > 0 ? (int)chunk_count : 1;
+    }
+    int stopping = config->target_edge_width > 0.0 || config->time_budget_seconds > 0.0;
+    run->config = config;
+    run->versus = versus;
+    run->chunks = chunks;
+    run->thread_count = thread_count;
+    run->shared_range = stopping;
+    run->chunk_count = chunk_count;
+    run->stop_reason = SIM_STOP_ROUNDS;
+    atomic_init(&run->stopped, 0);
+    pthread_mutex_init(&run->steal_lock, NULL);
+    pthread_mutex_init(&run->done_lock, NULL);
+    pthread_cond_init(&run->worker_exited, NULL);
+    for (int i = 0; i < thread_count; i++) {
+        pthread_mutex_init(&run->ranges[i].lock, NULL);
+        run->ranges[i].head = stopping ? 0 : chunk_count * i / thread_count;
+        run->ranges[i].tail = stopping ? (i == 0 ? chunk_count : 0) : chunk_count * (i + 1) / thread_count;
+    }
+    
+    int verbosity = get_verbosity();
+    set_verbosity(config->verbosity);
+    
+    double start = sim_clock_seconds();
+    pthread_t threads[SIM_MAX_THREADS];
+    SimWorker workers[SIM_MAX_THREADS];
+    int started = 0;
+    run->running_workers = thread_count;
+    for (int i = 0; i < thread_count; i++) {
+        workers[i].run = run;
+        workers[i].worker_idx = i;
+        if (pthread_create(&threads[i], NULL, sim_worker_thread, &workers[i]) == 0) {
+            started++;
+        } else {
+            break;
+        }
+    }
+    pthread_mutex_lock(&run->done_lock);
+    run->running_workers -= thread_count - started;
+    pthread_mutex_unlock(&run->done_lock);
+    if (started == 0) {
+        run->running_workers = 1;
+        sim_worker_thread(&workers[0]);  // No threads available, run inline
+    }
+    
+    // Until every worker is gone, checkpoint on a timer and check the
+    // stopping rules; then checkpoint once more
+    int checkpoint_failed = 0;
+    if (config->checkpoint_path || stopping) {
+        double seconds = config->checkpoint_seconds > 0.001 ? config->checkpoint_seconds : 0.001;
+        double next_checkpoint = start + seconds;
+        pthread_mutex_lock(&run->done_lock);
+        while (run->running_workers > 0) {
+            double wait = config->checkpoint_path ? next_checkpoint - sim_clock_seconds() : 0.0;
+            wait_for_workers(run, stopping && (wait > SIM_STOP_POLL_SECONDS || !config->checkpoint_path)
+                                  ? SIM_STOP_POLL_SECONDS : wait);
+            if (stopping) {
+                check_stop_rules(run, sim_clock_seconds() - start);
+            }
+            if (config->checkpoint_path && run->running_workers > 0 &&
+                sim_clock_seconds() >= next_checkpoint) {
+                pthread_mutex_unlock(&run->done_lock);
+                checkpoint_failed |= !write_sim_checkpoint(run, chunk_count, fingerprint);
+                result->checkpoint_count++;
+                pthread_mutex_lock(&run->done_lock);
+                next_checkpoint = sim_clock_seconds() + seconds;
+            }
+        }
+        pthread_mutex_unlock(&run->done_lock);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    if (stopping) {
+        check_stop_rules(run, sim_clock_seconds() - start);
+    }
+    if (config->checkpoint_path) {
+        checkpoint_failed |= !write_sim_checkpoint(run, chunk_count, fingerprint);
+        result->checkpoint_count++;
+    }
+    if (checkpoint_failed) {
+        fprintf(stderr, "Cannot write checkpoint \"%s\"\n", config->checkpoint_path);
+    }
+    result->elapsed_seconds = sim_clock_seconds() - start;
+    
+    set_verbosity(verbosity);
+    
+    // A stopped run keeps its prefix, whatever else got played
+    result->stop_reason = run->stop_reason;
+    result->planned_chunk_count = chunk_count;
+    result->chunk_count = stopping ? run->prefix_count : chunk_count;
+    init_game_stats(&result->stats);
+    init_round_moments(&result->moments);
+    for (long long i = 0; i < result->chunk_count; i++) {
+        merge_game_stats(&result->stats, &chunks[i].stats);
+        merge_round_moments(&result->moments, &chunks[i].moments);
+    }
+    result->thread_count = safe_max(started, 1);
+    result->steal_count = run->steal_count;
+    
+    for (int i = 0; i < thread_count; i++) {
+        pthread_mutex_destroy(&run->ranges[i].lock);
+    }
+    pthread_mutex_destroy(&run->steal_lock);
+    pthread_mutex_destroy(&run->done_lock);
+    pthread_cond_destroy(&run->worker_exited);
+    if (kept_chunks) {
+        *kept_chunks = chunks;
+    } else {
+        free(chunks);
+    }
+    free(run);
+    return 1;
+}
+
+int run_simulation(const SimConfig* config, SimResult* result) {
+    return run_chunks(config, NULL, result, NULL);
+}
+
+static double percent_of(long long part, long long whole) {
+    return whole > 0 ? 100.0 * (double)part / (double)whole : 0.0;
+}
+
+double get_player_edge_error(const RoundMoments* moments) {
+    // Standard error of the edge, mean net over mean wager, in percent; it
+    // follows from how far each round's net strays from the edge times its wager
+    if (moments->round_count < 2 || moments->wagered_mean <= 0.0) {
+        return HUGE_VAL;
+    }
+    double n = (double)moments->round_count;
+    double edge = moments->net_mean / moments->wagered_mean;
+    double m2 = moments->net_m2 - 2.0 * edge * moments->co_m2 + edge * edge * moments->wagered_m2;
+    return 100.0 * sqrt((m2 > 0.0 ? m2 : 0.0) / (n * (n - 1.0))) / moments->wagered_mean;
+}
+
+void print_sim_result(const SimConfig* config, const SimResult* result) {
+    const GameStats* stats = &result->stats;
+    double rate = result->elapsed_seconds > 0.0
+        ? (double)(stats->round_count - result->resumed_round_count) / result->elapsed_seconds : 0.0;
+    long long net = stats->total_paid - stats->total_wagered;
+    
+    printf("Seed:          %llu\n", (unsigned long long)config->seed);
+    printf("Rounds:        %lld\n", stats->round_count);
+    if (config->target_edge_width > 0.0 || config->time_budget_seconds > 0.0) {
+        static const char* const reasons[] = {"round limit reached", "interval narrow enough",
+                                              "time budget ran out"};
+        printf("Stopped:       %s after %lld of %lld chunks\n", reasons[result->stop_reason],
+               result->chunk_count, result->planned_chunk_count);
+    }
+    printf("Hands:         %lld\n", stats->hand_count);
+    printf("Elapsed:       %.3f s\n", result->elapsed_seconds);
+    printf("Rounds/sec:    %.0f\n", rate);
+    printf("Threads:       %d (%lld steals)\n", result->thread_count, result->steal_count);
+    if (config->checkpoint_path) {
+        printf("Checkpoints:   %lld to %s\n", result->checkpoint_count, config->checkpoint_path);
+    }
+    if (result->resumed_chunk_count > 0) {
+        printf("Resumed:       %lld chunks (%lld rounds)\n", result->resumed_chunk_count,
+               result->resumed_round_count);
+    }
+    if (config->batch_tables > 0) {
+        printf("Batch:         %d tables per thread, %s kernels, %s round\n",
+               config->batch_tables, batch_kernel_name(), batch_variant_name(&config->ruleset));
+    }
+    printf("Wins:          %lld (%.3f%%)\n", stats->win_count,
+           percent_of(stats->win_count, stats->hand_count));
+    printf("Blackjacks:    %lld (%.3f%%)\n", stats->blackjack_count,
+           percent_of(stats->blackjack_count, stats->hand_count));
+    printf("Pushes:        %lld (%.3f%%)\n", stats->push_count,
+           percent_of(stats->push_count, stats->hand_count));
+    printf("Losses:        %lld (%.3f%%)\n", stats->loose_count,
+           percent_of(stats->loose_count, stats->hand_count));
+    printf("Busts:         %lld (%.3f%%)\n", stats->bust_count,
+           percent_of(stats->bust_count, stats->hand_count));
+    if (stats->surrender_count > 0) {
+        printf("Surrenders:    %lld (%.3f%%)\n", stats->surrender_count,
+               percent_of(stats->surrender_count, stats->hand_count));
+    }
+    if (stats->double_count > 0 || stats->split_count > 0) {
+        printf("Doubles:       %lld, splits: %lld\n", stats->double_count, stats->split_count);
+    }
+    if (stats->insurance_count > 0) {
+        printf("Insurance:     %lld\n", stats->insurance_count);
+    }
+    printf("Net chips:     %lld\n", net);
+    printf("Player edge:   %.4f%% of all wagers\n", percent_of(net, stats->total_wagered));
+    if (result->moments.round_count > 1) {
+        double edge = percent_of(net, stats->total_wagered);
+        double error = 1.96 * get_player_edge_error(&result->moments);
+        printf("95%% interval:  %.4f%% to %.4f%%\n", edge - error, edge + error);
+    }
+    if (stats->double_count > 0 || stats->split_count > 0) {
+        // Every seat bets the minimum; a split hand is the only extra hand,
+        // so this is the edge solve reports
+        long long initial_wagered = (stats->hand_count - stats->split_count) * config->ruleset.minimum_wager;
+        printf("Initial edge:  %.4f%% of initial wagers\n", percent_of(net, initial_wagered));
+    }
+}
+
+void print_net_histogram(const SimConfig* config, const SimResult* result) {
+    // A row for every bin some round fell in, bars scaled to the fullest
+    static const char bar[] = "########################################";
+    const RoundMoments* moments = &result->moments;
+    double unit = (double)config->ruleset.minimum_wager;
+    long long fullest = 1;
+    for (int bin = 0; bin < NET_HISTOGRAM_BINS; bin++) {
+        fullest = moments->histogram[bin] > fullest ? moments->histogram[bin] : fullest;
+    }
+    
+    double deviation = moments->round_count > 1
+        ? sqrt(moments->net_m2 / (double)(moments->round_count - 1)) : 0.0;
+    printf("Net per round: %+.5f units (SD %.4f), in minimum wagers:\n", moments->net_mean / unit,
+           deviation / unit);
+    for (int bin = 0; bin < NET_HISTOGRAM_BINS; bin++) {
+        long long count = moments->histogram[bin];
+        if (count == 0) {
+            continue;
+        }
+        double low = (double)(bin - 2 * NET_HISTOGRAM_UNITS) / 2.0;
+        char label[32];
+        if (bin == 0) {
+            snprintf(label, sizeof(label), "below %+.1f", low + 0.5);
+        } else if (bin == NET_HISTOGRAM_BINS - 1) {
+            snprintf(label, sizeof(label), "%+.1f and up", low);
+        } else {
+            snprintf(label, sizeof(label), "%+.1f to %+.1f", low, low + 0.5);
+        }
+        int width = (int)((double)(sizeof(bar) - 1) * (double)count / (double)fullest + 0.5);
+        printf("  %-14s %12lld %9.4f%%  %.*s\n", label, count, percent_of(count, moments->round_count),
+               width, bar);
+    }
+}
+
+// ============================================================================
+// PAIRED COMPARISON
+// ============================================================================
+static int same_pairing(const SimConfig* first, const SimConfig* second) {
+    // Both sides must cut the same streams into the same chunks
+    return first->seed == second->seed && first->round_count == second->round_count &&
+           first->chunk_rounds == second->chunk_rounds && first->antithetic == second->antithetic;
+}
+
+static void summarize_comparison(const SimConfig configs[2], const SimChunk* chunks,
+                                 long long chunk_count, SimComparison* comparison) {
+    // Every side's rate is its total net over its total rounds. Its error
+    // follows from each unit's residual, the unit's net minus what the rate
+    // predicts for its rounds; the difference pairs residuals unit by unit.
+    int unit_chunks = configs[0].antithetic ? 2 : 1;
+    double wagers[2], totals[2];
+    for (int side = 0; side < 2; side++) {
+        const GameStats* stats = &comparison->results[side].stats;
+        wagers[side] = (double)configs[side].ruleset.minimum_wager;
+        totals[side] = (double)(stats->round_count > 0 ? stats->round_count : 1);
+        comparison->units_per_round[side] =
+            (double)(stats->total_paid - stats->total_wagered) / wagers[side] / totals[side];
+    }
+    
+    double squares[2] = {0.0, 0.0};
+    double difference_squares = 0.0;
+    for (long long first = 0; first < chunk_count; first += unit_chunks) {
+        double residuals[2];
+        for (int side = 0; side < 2; side++) {
+            double net = 0.0, rounds = 0.0;
+            for (long long i = first; i < first + unit_chunks && i < chunk_count; i++) {
+                const GameStats* stats = side == 0 ? &chunks[i].stats : &chunks[i].versus_stats;
+                net += (double)(stats->total_paid - stats->total_wagered) / wagers[side];
+                rounds += (double)stats->round_count;
+            }
+            residuals[side] = (net - comparison->units_per_round[side] * rounds) / totals[side];
+            squares[side] += residuals[side] * residuals[side];
+        }
+        difference_squares += (residuals[0] - residuals[1]) * (residuals[0] - residuals[1]);
+        comparison->unit_count++;
+    }
+    
+    long long units = comparison->unit_count;
+    double scale = units > 1 ? (double)units / (double)(units - 1) : 0.0;
+    comparison->unit_rounds = (configs[0].chunk_rounds > 0 ? configs[0].chunk_rounds :
+                               SIM_DEFAULT_CHUNK_ROUNDS) * unit_chunks;
+    comparison->standard_errors[0] = sqrt(scale * squares[0]);
+    comparison->standard_errors[1] = sqrt(scale * squares[1]);
+    comparison->difference = comparison->units_per_round[0] - comparison->units_per_round[1];
+    comparison->difference_error = sqrt(scale * difference_squares);
+    comparison->variance_ratio = difference_squares > 0.0 ?
+        (squares[0] + squares[1]) / difference_squares : 0.0;
+}
+
+int run_sim_comparison(const SimConfig configs[2], SimComparison* comparison) {
+    // Histories, checkpoints, the batch engine and stopping rules only know one side
+    memset(comparison, 0, sizeof(*comparison));
+    if (!same_pairing(&configs[0], &configs[1]) || configs[0].history || configs[0].checkpoint_path ||
+        configs[0].batch_tables > 0 || configs[0].target_edge_width > 0.0 ||
+        configs[0].time_budget_seconds > 0.0) {
+        return 0;
+    }
+    SimChunk* chunks = NULL;
+    if (!run_chunks(&configs[0], &configs[1], &comparison->results[0], &chunks)) {
+        return 0;
+    }
+    
+    long long chunk_count = get_sim_chunk_count(&configs[0]);
+    comparison->results[1] = comparison->results[0];
+    init_game_stats(&comparison->results[1].stats);
+    for (long long i = 0; i < chunk_count; i++) {
+        merge_game_stats(&comparison->results[1].stats, &chunks[i].versus_stats);
+    }
+    summarize_comparison(configs, chunks, chunk_count, comparison);
+    free(chunks);
+    return 1;
+}
+
+void print_sim_comparison(const SimConfig configs[2], const char* const labels[2],
+                          const SimComparison* comparison) {
+    const SimResult* result = &comparison->results[0];
+    double low = comparison->difference - 1.96 * comparison->difference_error;
+    double high = comparison->difference + 1.96 * comparison->difference_error;
+    
+    printf("Seed:          %llu\n", (unsigned long long)configs[0].seed);
+    printf("Rounds:        %lld per side, %lld paired units of %lld rounds%s\n",
+           result->stats.round_count, comparison->unit_count, comparison->unit_rounds,
+           configs[0].antithetic ? " (antithetic pairs)" : "");
+    printf("Elapsed:       %.3f s\n", result->elapsed_seconds);
+    printf("Threads:       %d (%lld steals)\n", result->thread_count, result->steal_count);
+    for (int side = 0; side < 2; side++) {
+        const GameStats* stats = &comparison->results[side].stats;
+        long long net = stats->total_paid - stats->total_wagered;
+        printf("%c:             %s\n", 'A' + side, labels[side]);
+        printf("  Net:         %+.5f units per round (SE %.5f)\n",
+               comparison->units_per_round[side], comparison->standard_errors[side]);
+        printf("  Player edge: %.4f%%\n", percent_of(net, stats->total_wagered));
+    }
+    printf("A - B:         %+.5f units per round (SE %.5f)\n",
+           comparison->difference, comparison->difference_error);
+    printf("95%% interval:  %+.5f to %+.5f\n", low, high);
+    if (comparison->variance_ratio > 0.0) {
+        printf("Pairing gain:  %.1fx fewer rounds than independent runs\n", comparison->variance_ratio);
+    }
+}
@@ -0,0 +1,138 @@
+/*
+ * UNIJACK - Headless simulation
+ * Plays rounds through play_new_round with policy callbacks instead of
+ * the console, for measuring rulesets and strategies at high speed.
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include "blackjack.h"
+#include "batch.h"
+#include "history.h"
+
+// Chips given to every simulated seat, topped up whenever a seat can no
+// longer cover its wager so long runs never end with broke players
+#define SIM_STARTING_CHIPS 1000000
+
+// Rounds per unit of work; each chunk plays on a freshly shuffled shoe
+// with its own random stream, so results do not depend on which thread ran it
+#define SIM_DEFAULT_CHUNK_ROUNDS 65536
+#define SIM_MAX_THREADS 256
+
+// Checkpoints record every finished chunk; an interrupted run resumes by
+// playing only the chunks missing from the latest one
+#define SIM_CHECKPOINT_MAGIC "UJCK"
+#define SIM_CHECKPOINT_VERSION 3
+#define SIM_DEFAULT_CHECKPOINT_SECONDS 10.0
+
+// With a stopping rule the round count is only a limit; runs that set no
+// count of their own get this one. The rules are checked this often.
+// A stopped run drops the chunks still being played, so a time budget
+// defaults to smaller chunks.
+#define SIM_DEFAULT_ROUND_LIMIT 1000000000LL
+#define SIM_STOP_POLL_SECONDS 0.01
+#define SIM_BUDGET_CHUNK_ROUNDS 4096
+
+// Why a run ended. A run with a stopping rule hands chunks out in index
+// order and keeps the finished ones before the first that is not. The
+// precision rule is tested after every chunk of that prefix in turn, so it
+// stops at the same chunk with any number of threads; the time budget
+// keeps whatever prefix finished in time.
+#define SIM_STOP_ROUNDS 0       // Played every round
+#define SIM_STOP_PRECISION 1    // The player edge interval got narrow enough
+#define SIM_STOP_TIME 2         // The time budget ran out
+
+// Simulation configuration structure
+typedef struct {
+    Ruleset ruleset;
+    long long round_count;
+    int player_count;
+    uint64_t seed;
+    const PlayerPolicy* policy;
+    int thread_count;
+    long long chunk_rounds;
+    int batch_tables;           // Tables per batch engine, 0 = scalar engine
+    int verbosity;              // Round messages to print, VERBOSITY_SILENT for none
+    HistoryLog* history;        // Open log to record every round in, NULL = none
+    const char* checkpoint_path;    // NULL = no checkpoints
+    double checkpoint_seconds;
+    int resume;                 // Start from the chunks finished in checkpoint_path
+    int antithetic;             // Play chunks in pairs, the second on the mirrored shoe
+    double target_edge_width;   // Stop once the player edge's 95% interval is this many
+                                // percentage points wide, 0 = never
+    double time_budget_seconds; // Stop once this much time has passed, 0 = never
+} SimConfig;
+
+// Simulation chunk structure - one independent slice of a run
+typedef struct {
+    Rng rng;
+    int antithetic;
+    long long round_count;
+    GameStats stats;
+    GameStats versus_stats;     // Second side of a comparison
+    RoundMoments moments;
+    int done;
+} SimChunk;
+
+// Simulation result structure
+typedef struct {
+    GameStats stats;
+    RoundMoments moments;
+    int stop_reason;
+    long long chunk_count;      // Chunks in the results, of planned_chunk_count
+    long long planned_chunk_count;
+    double elapsed_seconds;
+    int thread_count;
+    long long steal_count;
+    long long resumed_chunk_count;
+    long long resumed_round_count;
+    long long checkpoint_count;
+} SimResult;
+
+// Chunks of a comparison; enough of them to estimate errors from in a short run
+#define SIM_COMPARE_CHUNK_ROUNDS 1024
+
+// Paired comparison structure - two configurations played on common shoes
+// Both sides play every chunk side by side from the same shuffle. When
+// their shoes have the same shape the second side replays the first
+// side's shoe at the start of every round, so both see the same cards
+// until their decisions differ; otherwise only each chunk's first shoe
+// is shared. Each paired unit is a chunk, or an antithetic pair of chunks,
+// and standard errors come from the spread of the units. Values are net
+// units (minimum wagers) per round.
+typedef struct {
+    SimResult results[2];
+    long long unit_count;
+    long long unit_rounds;
+    double units_per_round[2];
+    double standard_errors[2];
+    double difference;          // First minus second
+    double difference_error;
+    double variance_ratio;      // Variance of independent runs' difference over the paired one
+} SimComparison;
+
+// Function declarations - Simulation operations
+void init_sim_config(SimConfig* config, const Ruleset* ruleset);
+int run_simulation(const SimConfig* config, SimResult* result);
+int run_sim_comparison(const SimConfig configs[2], SimComparison* comparison);
+void print_sim_comparison(const SimConfig configs[2], const char* const labels[2],
+                          const SimComparison* comparison);
+void play_sim_chunk(const SimConfig* config, Game* game, Table* table, SimChunk* chunk,
+                    const RoundObserver* observer);
+int default_sim_thread_count(void);
+void print_sim_result(const SimConfig* config, const SimResult* result);
+void print_net_histogram(const SimConfig* config, const SimResult* result);
+double get_player_edge_error(const RoundMoments* moments);
+double sim_clock_seconds(void);
+
+// Function declarations - Built-in policies
+const PlayerPolicy* find_sim_policy(const char* name);
+int sim_policy_hit_below(const PlayerPolicy* policy);
+void list_sim_policies(FILE* stream);
+int flat_minimum_wager(void* context, const Game* game, const Table* table, int player_idx);
+char mimic_dealer_action(void* context, const Game* game, const Table* table, int player_idx);
+char never_bust_action(void* context, const Game* game, const Table* table, int player_idx);
+char always_stand_action(void* context, const Game* game, const Table* table, int player_idx);
+
+#endif // SIM_H
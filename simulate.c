@@ -0,0 +1,374 @@
+/*
+ * UNIJACK - Headless simulation entry point
+ * Plays rounds without console interaction, a fixed number of them or
+ * until the edge is known well enough, and reports throughput and
+ * outcome tallies.
+ */
+
+#include "sim.h"
+#include "solver.h"
+#include "instrument.h"
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --ruleset NAME   basic, european or american (default: american)\n"
+        "  --rounds N       number of rounds to play (default: 1000000)\n"
+        "  --players N      seats at the table (default: 1)\n"
+        "  --seed N         random seed (default: current time)\n"
+        "  --policy NAME    decision policy (default: mimic)\n"
+        "  --payout N:D     blackjack pays N to D instead of the ruleset's\n"
+        "  --threads N      worker threads (default: one per core)\n"
+        "  --chunk N        rounds per work unit (default: 65536)\n"
+        "  --batch N        play N tables per thread on the SIMD batch engine\n"
+        "  --verbosity N    print round messages, 0 (none) to 3 (default: 0)\n"
+        "  --history F      record every round to F (read it with history_dump)\n"
+        "  --checkpoint F   save finished work to F every few seconds\n"
+        "  --checkpoint-every S\n"
+        "                   seconds between checkpoints (default: 10)\n"
+        "  --resume         skip the work already saved in the --checkpoint file\n"
+        "  --histogram      print how many rounds won or lost how much\n"
+        "  --instrument F   write phase timings and counters to F as JSON\n"
+        "                   (needs a build with UNIJACK_INSTRUMENT)\n"
+        "  --cache DIR      solver cache for the optimal policy (default: $%s,\n"
+        "                   else ~/.cache/unijack)\n"
+        "  --no-cache       solve the optimal policy without the cache\n"
+        "Stopping early, --rounds becomes a limit (default: %lld):\n"
+        "  --target-width W stop once the player edge's 95%% interval is W%% wide\n"
+        "  --time-budget S  stop after S seconds (default --chunk: %d)\n"
+        "Comparing, on the same shuffled shoes chunk by chunk:\n"
+        "  --compare-ruleset NAME\n"
+        "                   play a second side with this ruleset\n"
+        "  --compare-policy NAME\n"
+        "                   play a second side with this policy\n"
+        "  --compare-payout N:D\n"
+        "                   play a second side with this blackjack payout\n"
+        "  --antithetic     play chunks in pairs, the second on the mirrored shoe\n"
+        "A comparison defaults to %d rounds per chunk, the units its errors\n"
+        "are estimated from, and runs on the scalar engine.\n",
+        program, SOLVER_CACHE_DIR_ENV, SIM_DEFAULT_ROUND_LIMIT, SIM_BUDGET_CHUNK_ROUNDS,
+        SIM_COMPARE_CHUNK_ROUNDS);
+    fprintf(stderr, "Policies: optimal, ");
+    list_sim_policies(stderr);
+}
+
+static int parse_payout(const char* text, int payout[2]) {
+    char extra;
+    return sscanf(text, "%d:%d%c", &payout[0], &payout[1], &extra) == 2 &&
+           payout[0] > 0 && payout[1] > 0;
+}
+
+static int use_optimal_policy(SimConfig* config, CachedSolution* solved, PlayerPolicy* policy,
+                              const char* cache) {
+    // The optimal policy plays the solver's strategy for the config's ruleset,
+    // mapped from the cache when it was solved before
+    if (!open_cached_solution(solved, cache, &config->ruleset, config->thread_count)) {
+        fprintf(stderr, "Solver failed\n");
+        return 0;
+    }
+    policy->choose_wager = solver_wager;
+    policy->choose_action = solver_action;
+    policy->context = (void*)solved->result;
+    policy->choose_insurance = NULL;
+    config->policy = policy;
+    return 1;
+}
+
+static void write_instrument_file(const char* path) {
+#if INSTR_ENABLED
+    FILE* report = fopen(path, "w");
+    if (!report || !write_instrument_report(report)) {
+        fprintf(stderr, "Cannot write \"%s\"\n", path);
+    }
+    if (report) {
+        fclose(report);
+    }
+#endif
+}
+
+static int run_comparison(SimConfig configs[2], const char* const labels[2]) {
+    SimComparison comparison;
+    if (!run_sim_comparison(configs, &comparison)) {
+        fprintf(stderr, "Simulation failed\n");
+        return 0;
+    }
+    print_sim_comparison(configs, labels, &comparison);
+    return 1;
+}
+
+int main(int argc, char** argv) {
+#ifdef UNIVAC
+    init_bss();
+#endif
+
+    Ruleset ruleset;
+    init_american_ruleset(&ruleset);
+    
+    SimConfig config;
+    init_sim_config(&config, &ruleset);
+    config.thread_count = default_sim_thread_count();
+    int use_solver = 0;
+    const char* ruleset_name = "american";
+    const char* policy_name = "mimic";
+    const char* compare_ruleset_name = NULL;
+    const char* compare_policy_name = NULL;
+    int payout[2] = {0, 0};
+    int compare_payout[2] = {0, 0};
+    int chunk_set = 0;
+    int rounds_set = 0;
+    int histogram = 0;
+    const char* instrument_path = NULL;
+    const char* history_path = NULL;
+    char cache_dir[MAX_STRING_LEN * 2];
+    const char* cache = get_solver_cache_dir(cache_dir, sizeof(cache_dir)) ? cache_dir : NULL;
+    
+    for (int i = 1; i < argc; i++) {
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        
+        if (strcmp(argv[i], "--ruleset") == 0 && value) {
+            if (!init_ruleset_by_name(&config.ruleset, value)) {
+                fprintf(stderr, "Unknown ruleset \"%s\"\n", value);
+                return 1;
+            }
+            ruleset_name = value;
+            i++;
+        } else if (strcmp(argv[i], "--rounds") == 0 && value) {
+            config.round_count = atoll(value);
+            rounds_set = 1;
+            i++;
+        } else if (strcmp(argv[i], "--players") == 0 && value) {
+            config.player_count = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--seed") == 0 && value) {
+            config.seed = strtoull(value, NULL, 10);
+            i++;
+        } else if (strcmp(argv[i], "--threads") == 0 && value) {
+            config.thread_count = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--chunk") == 0 && value) {
+            config.chunk_rounds = atoll(value);
+            chunk_set = 1;
+            i++;
+        } else if (strcmp(argv[i], "--batch") == 0 && value) {
+            config.batch_tables = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--verbosity") == 0 && value) {
+            config.verbosity = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--instrument") == 0 && value) {
+            if (!INSTR_ENABLED) {
+                fprintf(stderr, "This build has no instrumentation, rebuild with make INSTRUMENT=1\n");
+                return 1;
+            }
+            instrument_path = value;
+            i++;
+        } else if (strcmp(argv[i], "--checkpoint") == 0 && value) {
+            config.checkpoint_path = value;
+            i++;
+        } else if (strcmp(argv[i], "--checkpoint-every") == 0 && value) {
+            config.checkpoint_seconds = atof(value);
+            i++;
+        } else if (strcmp(argv[i], "--resume") == 0) {
+            config.resume = 1;
+        } else if (strcmp(argv[i], "--history") == 0 && value) {
+            history_path = value;
+            i++;
+        } else if (strcmp(argv[i], "--cache") == 0 && value) {
+            cache = value;
+            i++;
+        } else if (strcmp(argv[i], "--no-cache") == 0) {
+            cache = NULL;
+        } else if (strcmp(argv[i], "--policy") == 0 && strcmp(value ? value : "", "optimal") == 0) {
+            use_solver = 1;
+            policy_name = value;
+            i++;
+        } else if (strcmp(argv[i], "--policy") == 0 && value) {
+            use_solver = 0;
+            config.policy = find_sim_policy(value);
+            if (!config.policy) {
+                fprintf(stderr, "Unknown policy \"%s\"\n", value);
+                return 1;
+            }
+            policy_name = value;
+            i++;
+        } else if (strcmp(argv[i], "--compare-ruleset") == 0 && value) {
+            Ruleset ruleset_check;
+            if (!init_ruleset_by_name(&ruleset_check, value)) {
+                fprintf(stderr, "Unknown ruleset \"%s\"\n", value);
+                return 1;
+            }
+            compare_ruleset_name = value;
+            i++;
+        } else if (strcmp(argv[i], "--compare-policy") == 0 && value) {
+            if (strcmp(value, "optimal") != 0 && !find_sim_policy(value)) {
+                fprintf(stderr, "Unknown policy \"%s\"\n", value);
+                return 1;
+            }
+            compare_policy_name = value;
+            i++;
+        } else if (strcmp(argv[i], "--payout") == 0 && value) {
+            if (!parse_payout(value, payout)) {
+                fprintf(stderr, "Payout \"%s\" is not N:D\n", value);
+                return 1;
+            }
+            i++;
+        } else if (strcmp(argv[i], "--compare-payout") == 0 && value) {
+            if (!parse_payout(value, compare_payout)) {
+                fprintf(stderr, "Payout \"%s\" is not N:D\n", value);
+                return 1;
+            }
+            i++;
+        } else if (strcmp(argv[i], "--antithetic") == 0) {
+            config.antithetic = 1;
+        } else if (strcmp(argv[i], "--target-width") == 0 && value) {
+            config.target_edge_width = atof(value);
+            i++;
+        } else if (strcmp(argv[i], "--time-budget") == 0 && value) {
+            config.time_budget_seconds = atof(value);
+            i++;
+        } else if (strcmp(argv[i], "--histogram") == 0) {
+            histogram = 1;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (config.round_count <= 0 || config.player_count <= 0 || config.thread_count <= 0 ||
+        config.batch_tables < 0 || config.batch_tables > BATCH_MAX_TABLES ||
+        config.verbosity < VERBOSITY_SILENT || config.verbosity > VERBOSITY_FULL ||
+        config.checkpoint_seconds <= 0.0 || (config.resume && !config.checkpoint_path) ||
+        config.target_edge_width < 0.0 || config.time_budget_seconds < 0.0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    int stopping = config.target_edge_width > 0.0 || config.time_budget_seconds > 0.0;
+    if (stopping && !rounds_set) {
+        config.round_count = SIM_DEFAULT_ROUND_LIMIT;
+    }
+    if (config.time_budget_seconds > 0.0 && !chunk_set) {
+        config.chunk_rounds = SIM_BUDGET_CHUNK_ROUNDS;
+    }
+    if (stopping && history_path) {
+        fprintf(stderr, "A run that stops early cannot record a hand history\n");
+        return 1;
+    }
+    
+    if (payout[0] > 0) {
+        config.ruleset.blackjack_payout_numerator = payout[0];
+        config.ruleset.blackjack_payout_denominator = payout[1];
+    }
+    
+    // A comparison plays a second side that differs in ruleset, payout or policy
+    int comparing = compare_ruleset_name || compare_policy_name || compare_payout[0] > 0;
+    SimConfig versus = config;
+    int versus_solver = use_solver;
+    if (comparing) {
+        if (compare_ruleset_name) {
+            init_ruleset_by_name(&versus.ruleset, compare_ruleset_name);
+        }
+        if (compare_payout[0] > 0) {
+            versus.ruleset.blackjack_payout_numerator = compare_payout[0];
+            versus.ruleset.blackjack_payout_denominator = compare_payout[1];
+        }
+        if (compare_policy_name) {
+            versus_solver = strcmp(compare_policy_name, "optimal") == 0;
+            versus.policy = versus_solver ? config.policy : find_sim_policy(compare_policy_name);
+        }
+        if (!chunk_set) {
+            config.chunk_rounds = SIM_COMPARE_CHUNK_ROUNDS;
+            versus.chunk_rounds = SIM_COMPARE_CHUNK_ROUNDS;
+        }
+        if (history_path || config.checkpoint_path || config.batch_tables > 0 || stopping) {
+            fprintf(stderr, "A comparison cannot record a hand history or checkpoints, "
+                            "use the batch engine or stop early\n");
+            return 1;
+        }
+    }
+    
+    // The batch engine only knows hit-below-a-score decisions
+    if (config.batch_tables > 0 && (use_solver || sim_policy_hit_below(config.policy) < 0)) {
+        fprintf(stderr, "The batch engine cannot play the \"optimal\" policy\n");
+        return 1;
+    }
+    if (config.batch_tables > 0 && history_path) {
+        fprintf(stderr, "The batch engine cannot record a hand history\n");
+        return 1;
+    }
+    if (config.resume && history_path) {
+        fprintf(stderr, "A resumed run cannot record a hand history, it would miss the saved chunks\n");
+        return 1;
+    }
+    
+    CachedSolution solved;
+    CachedSolution versus_solved;
+    memset(&solved, 0, sizeof(solved));
+    memset(&versus_solved, 0, sizeof(versus_solved));
+    PlayerPolicy solver_policy;
+    PlayerPolicy versus_solver_policy;
+    if (use_solver && !use_optimal_policy(&config, &solved, &solver_policy, cache)) {
+        return 1;
+    }
+    if (comparing) {
+        int ok = !versus_solver ||
+                 use_optimal_policy(&versus, &versus_solved, &versus_solver_policy, cache);
+        char labels[2][MAX_STRING_LEN];
+        snprintf(labels[0], sizeof(labels[0]), "%s ruleset, %s policy, blackjack pays %d:%d",
+                 ruleset_name, policy_name, config.ruleset.blackjack_payout_numerator,
+                 config.ruleset.blackjack_payout_denominator);
+        snprintf(labels[1], sizeof(labels[1]), "%s ruleset, %s policy, blackjack pays %d:%d",
+                 compare_ruleset_name ? compare_ruleset_name : ruleset_name,
+                 compare_policy_name ? compare_policy_name : policy_name,
+                 versus.ruleset.blackjack_payout_numerator, versus.ruleset.blackjack_payout_denominator);
+        const char* const label_names[2] = {labels[0], labels[1]};
+        SimConfig configs[2] = {config, versus};
+        ok = ok && run_comparison(configs, label_names);
+        if (ok && instrument_path) {
+            write_instrument_file(instrument_path);
+        }
+        close_cached_solution(&versus_solved);
+        close_cached_solution(&solved);
+        return ok ? 0 : 1;
+    }
+    if (use_solver) {
+        printf("Solver edge:   %.4f%% of initial wagers\n", 100.0 * solved.result->player_edge);
+    }
+    
+    HistoryLog history;
+    if (history_path) {
+        if (!open_history_log(&history, history_path, &config.ruleset, config.seed, config.thread_count)) {
+            fprintf(stderr, "Cannot write \"%s\"\n", history_path);
+            close_cached_solution(&solved);
+            return 1;
+        }
+        config.history = &history;
+    }
+    
+    SimResult result;
+    int ran = run_simulation(&config, &result);
+    if (history_path && !close_history_log(&history)) {
+        fprintf(stderr, "Cannot write \"%s\"\n", history_path);
+        close_cached_solution(&solved);
+        return 1;
+    }
+    if (!ran) {
+        fprintf(stderr, "Simulation failed\n");
+        close_cached_solution(&solved);
+        return 1;
+    }
+    print_sim_result(&config, &result);
+    if (histogram) {
+        print_net_histogram(&config, &result);
+    }
+    if (history_path) {
+        printf("History:       %lld bytes in %s\n", history.bytes_written, history_path);
+    }
+    
+    if (instrument_path) {
+        write_instrument_file(instrument_path);
+    }
+    
+    close_cached_solution(&solved);
+    return 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * UNIJACK - Strategy solver entry point
+ * Prints the optimal strategy and the house edge of a ruleset.
+ */
+
+#include "solver.h"
+#include "sim.h"
+
+#include <unistd.h>
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --ruleset NAME   basic, european or american (default: american)\n"
+        "  --threads N      worker threads (default: one per core)\n"
+        "  --compositions   also print EVs of every two-card hand\n"
+        "  --cache DIR      solver cache directory (default: $%s,\n"
+        "                   else ~/.cache/unijack)\n"
+        "  --no-cache       always solve, without reading or writing the cache\n",
+        program, SOLVER_CACHE_DIR_ENV);
+}
+
+int main(int argc, char** argv) {
+    Ruleset ruleset;
+    init_american_ruleset(&ruleset);
+    int thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int show_compositions = 0;
+    char cache_dir[MAX_STRING_LEN * 2];
+    const char* cache = get_solver_cache_dir(cache_dir, sizeof(cache_dir)) ? cache_dir : NULL;
+    
+    for (int i = 1; i < argc; i++) {
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        
+        if (strcmp(argv[i], "--ruleset") == 0 && value) {
+            if (!init_ruleset_by_name(&ruleset, value)) {
+                fprintf(stderr, "Unknown ruleset \"%s\"\n", value);
+                return 1;
+            }
+            i++;
+        } else if (strcmp(argv[i], "--threads") == 0 && value) {
+            thread_count = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--compositions") == 0) {
+            show_compositions = 1;
+        } else if (strcmp(argv[i], "--cache") == 0 && value) {
+            cache = value;
+            i++;
+        } else if (strcmp(argv[i], "--no-cache") == 0) {
+            cache = NULL;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    CachedSolution solution;
+    double start = sim_clock_seconds();
+    if (!open_cached_solution(&solution, cache, &ruleset, thread_count)) {
+        fprintf(stderr, "Solver failed\n");
+        return 1;
+    }
+    double elapsed = sim_clock_seconds() - start;
+    const SolverResult* result = solution.result;
+    
+    print_strategy_table(stdout, result);
+    if (show_compositions) {
+        print_composition_table(stdout, result);
+    }
+    if (solution.source == SOLUTION_MAPPED) {
+        printf("Loaded from %s in %.3f ms (solved in %.3f s)\n", cache, elapsed * 1e3,
+               result->elapsed_seconds);
+    } else {
+        printf("Solved in %.3f s\n", result->elapsed_seconds);
+    }
+    
+    close_cached_solution(&solution);
+    return 0;
+}
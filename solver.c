@@ -0,0 +1,802 @@
+/*
+ * UNIJACK - Strategy solver
+ * Implementation
+ */
+
+#include "solver.h"
+#include "sim.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PLAYER_KEY_BITS 5
+#define PLAYER_MEMO_CAPACITY 8192       // Player card multisets below 22 number about 3000
+
+// Player memo entry - best EV for one multiset of player cards
+typedef struct {
+    uint64_t key;           // Packed player counts, 0 = empty slot
+    double best_ev;
+} PlayerMemoEntry;
+
+// Per-thread solver state
+typedef struct {
+    const Ruleset* ruleset;
+    const DealerDrawTable* dealer_tables;
+    PlayerMemoEntry memo[PLAYER_MEMO_CAPACITY];
+    int counts[CARD_VALUE_COUNT];   // Unseen cards for the current player hand
+    int remaining;
+    int upcard;
+} SolverWorker;
+
+// Work shared by all threads
+typedef struct {
+    const Ruleset* ruleset;
+    SolverResult* result;
+    DealerDrawTable dealer_tables[CARD_VALUE_COUNT];
+    pthread_mutex_t lock;
+    int next_upcard;
+    int solved_count;
+} SolverJob;
+
+static const int VALUE_POINTS[CARD_VALUE_COUNT] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+
+static int hand_score(int hard, int has_ace) {
+    return (has_ace && hard + SOFT_ACE_BONUS <= TARGET_SCORE) ? hard + SOFT_ACE_BONUS : hard;
+}
+
+// ============================================================================
+// EXPECTED VALUES
+// ============================================================================
+static double stand_ev(SolverWorker* worker, int score) {
+    DealerOdds odds;
+    compute_dealer_odds_from_table(&worker->dealer_tables[worker->upcard], worker->counts, 1, &odds);
+    
+    double ev = odds.p[DEALER_BUST];
+    for (int o = DEALER_17; o <= DEALER_21; o++) {
+        int dealer_score = MINIMUM_DEALER_SCORE + o;
+        if (score > dealer_score) {
+            ev += odds.p[o];
+        } else if (score < dealer_score) {
+            ev -= odds.p[o];
+        }
+    }
+    return ev;
+}
+
+static double best_ev(SolverWorker* worker, uint64_t key, int hard, int has_ace);
+
+static double hit_ev(SolverWorker* worker, uint64_t key, int hard, int has_ace) {
+    double ev = 0.0;
+    double inverse_remaining = 1.0 / worker->remaining;
+    
+    for (int v = 0; v < CARD_VALUE_COUNT; v++) {
+        int count = worker->counts[v];
+        if (count == 0) {
+            continue;
+        }
+        
+        double weight = count * inverse_remaining;
+        int next_hard = hard + VALUE_POINTS[v];
+        if (next_hard > TARGET_SCORE) {
+            ev -= weight;
+            continue;
+        }
+        
+        worker->counts[v]--;
+        worker->remaining--;
+        ev += weight * best_ev(worker, key + ((uint64_t)1 << (v * PLAYER_KEY_BITS)),
+                               next_hard, has_ace | (v == 0));
+        worker->counts[v]++;
+        worker->remaining++;
+    }
+    
+    return ev;
+}
+
+static double best_ev(SolverWorker* worker, uint64_t key, int hard, int has_ace) {
+    int score = hand_score(hard, has_ace);
+    if (score == TARGET_SCORE || worker->remaining == 0) {
+        return stand_ev(worker, score);  // Hitting 21 never helps
+    }
+    
+    size_t slot = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 40) & (PLAYER_MEMO_CAPACITY - 1);
+    while (worker->memo[slot].key != 0) {
+        if (worker->memo[slot].key == key) {
+            return worker->memo[slot].best_ev;
+        }
+        slot = (slot + 1) & (PLAYER_MEMO_CAPACITY - 1);
+    }
+    
+    double stand = stand_ev(worker, score);
+    double hit = hit_ev(worker, key, hard, has_ace);
+    double best = hit > stand ? hit : stand;
+    
+    // Recursion filled other slots, probe again before storing
+    slot = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 40) & (PLAYER_MEMO_CAPACITY - 1);
+    while (worker->memo[slot].key != 0) {
+        slot = (slot + 1) & (PLAYER_MEMO_CAPACITY - 1);
+    }
+    worker->memo[slot].key = key;
+    worker->memo[slot].best_ev = best;
+    return best;
+}
+
+static double double_ev(SolverWorker* worker, int hard, int has_ace) {
+    // One more card, then stand, on twice the wager
+    double ev = 0.0;
+    double inverse_remaining = 1.0 / worker->remaining;
+    
+    for (int v = 0; v < CARD_VALUE_COUNT; v++) {
+        int count = worker->counts[v];
+        if (count == 0) {
+            continue;
+        }
+        
+        double weight = count * inverse_remaining;
+        int next_hard = hard + VALUE_POINTS[v];
+        if (next_hard > TARGET_SCORE) {
+            ev -= weight;
+            continue;
+        }
+        
+        worker->counts[v]--;
+        worker->remaining--;
+        ev += weight * stand_ev(worker, hand_score(next_hard, has_ace | (v == 0)));
+        worker->counts[v]++;
+        worker->remaining++;
+    }
+    
+    return 2.0 * ev;
+}
+
+static double split_ev(SolverWorker* worker, int value) {
+    // Each hand draws its second card with the pair out of the shoe, then
+    // plays on as the dealt hand of the same two cards, with the other card
+    // of the pair back in the shoe, so it reuses that hand's memo entries
+    const Ruleset* ruleset = worker->ruleset;
+    int aces_locked = value == 0 && !ruleset->hit_split_aces;
+    int doubles = ruleset->double_down_allowed && ruleset->double_after_split && !aces_locked;
+    uint64_t pair_key = (uint64_t)1 << (value * PLAYER_KEY_BITS);
+    double ev = 0.0;
+    double inverse_remaining = 1.0 / worker->remaining;
+    
+    for (int v = 0; v < CARD_VALUE_COUNT; v++) {
+        int count = worker->counts[v];
+        if (count == 0) {
+            continue;
+        }
+        
+        worker->counts[v]--;
+        worker->counts[value]++;
+        int hard = VALUE_POINTS[value] + VALUE_POINTS[v];
+        int has_ace = value == 0 || v == 0;
+        double hand_ev = aces_locked ? stand_ev(worker, hand_score(hard, has_ace)) :
+            best_ev(worker, pair_key + ((uint64_t)1 << (v * PLAYER_KEY_BITS)), hard, has_ace);
+        if (doubles) {
+            double doubled = double_ev(worker, hard, has_ace);
+            hand_ev = doubled > hand_ev ? doubled : hand_ev;
+        }
+        ev += count * inverse_remaining * hand_ev;
+        worker->counts[value]--;
+        worker->counts[v]++;
+    }
+    
+    return 2.0 * ev;
+}
+
+// ============================================================================
+// SOLVER OPERATIONS
+// ============================================================================
+static void solve_upcard(SolverWorker* worker, SolverResult* result, int upcard) {
+    int full_counts[CARD_VALUE_COUNT];
+    count_values_in_full_shoe(worker->ruleset->deck_count_in_shoe, full_counts);
+    int full_total = 0;
+    for (int v = 0; v < CARD_VALUE_COUNT; v++) {
+        full_total += full_counts[v];
+    }
+    
+    double upcard_probability = (double)full_counts[upcard] / full_total;
+    full_counts[upcard]--;
+    full_total--;
+    
+    worker->upcard = upcard;
+    memset(worker->memo, 0, sizeof(worker->memo));
+    
+    for (int low = 0; low < CARD_VALUE_COUNT; low++) {
+        for (int high = low; high < CARD_VALUE_COUNT; high++) {
+            SolverHand* hand = &result->hands[upcard][low][high];
+            
+            // Probability of this unordered pair given the upcard
+            double pair_probability = (double)full_counts[low] / full_total;
+            if (low == high) {
+                pair_probability *= (double)(full_counts[high] - 1) / (full_total - 1);
+            } else {
+                pair_probability *= 2.0 * full_counts[high] / (full_total - 1);
+            }
+            hand->probability = upcard_probability * pair_probability;
+            if (hand->probability <= 0.0) {
+                continue;
+            }
+            
+            memcpy(worker->counts, full_counts, sizeof(full_counts));
+            worker->counts[low]--;
+            worker->counts[high]--;
+            worker->remaining = full_total - 2;
+            
+            uint64_t key = ((uint64_t)1 << (low * PLAYER_KEY_BITS)) + ((uint64_t)1 << (high * PLAYER_KEY_BITS));
+            int hard = VALUE_POINTS[low] + VALUE_POINTS[high];
+            int has_ace = (low == 0);
+            
+            hand->stand_ev = stand_ev(worker, hand_score(hard, has_ace));
+            hand->hit_ev = hit_ev(worker, key, hard, has_ace);
+            hand->double_ev = double_ev(worker, hard, has_ace);
+            hand->split_ev = low == high ? split_ev(worker, low) : 0.0;
+            hand->surrender_ev = -0.5;
+        }
+    }
+}
+
+static void* solver_thread(void* argument) {
+    SolverJob* job = (SolverJob*)argument;
+    SolverWorker* worker = malloc(sizeof(SolverWorker));
+    if (!worker) {
+        return NULL;  // Other threads pick up the remaining upcards
+    }
+    worker->ruleset = job->ruleset;
+    worker->dealer_tables = job->dealer_tables;
+    
+    while (1) {
+        pthread_mutex_lock(&job->lock);
+        int upcard = job->next_upcard++;
+        pthread_mutex_unlock(&job->lock);
+        if (upcard >= CARD_VALUE_COUNT) {
+            break;
+        }
+        solve_upcard(worker, job->result, upcard);
+        
+        pthread_mutex_lock(&job->lock);
+        job->solved_count++;
+        pthread_mutex_unlock(&job->lock);
+    }
+    
+    free(worker);
+    return NULL;
+}
+
+// First decisions of a dealt hand, in the order ties are broken
+static const char FIRST_ACTIONS[] = {
+    SOLVER_ACTION_STAND, SOLVER_ACTION_HIT, SOLVER_ACTION_DOUBLE, SOLVER_ACTION_SURRENDER, SOLVER_ACTION_SPLIT
+};
+
+#define FIRST_ACTION_COUNT ((int)sizeof(FIRST_ACTIONS))
+#define FIRST_TOTAL_ACTION_COUNT (FIRST_ACTION_COUNT - 1)  // Totals never split
+
+static int first_action_allowed(const Ruleset* ruleset, char action, int low, int high) {
+    // As get_allowed_actions offers them to a dealt hand with chips to cover
+    if (action == SOLVER_ACTION_DOUBLE) {
+        return ruleset->double_down_allowed;
+    }
+    if (action == SOLVER_ACTION_SPLIT) {
+        return low == high && ruleset->max_split_hands >= 2;
+    }
+    if (action == SOLVER_ACTION_SURRENDER) {
+        return ruleset->late_surrender;
+    }
+    return 1;
+}
+
+static double first_action_ev(const Ruleset* ruleset, const SolverHand* hand, char action,
+                              double dealer_blackjack) {
+    // A dealer blackjack takes the wager; without a peek it shows up only
+    // after the player doubled or split, and takes the extra wager too
+    double ev = hand->stand_ev;
+    double stake = 1.0;
+    if (action == SOLVER_ACTION_HIT) {
+        ev = hand->hit_ev;
+    } else if (action == SOLVER_ACTION_DOUBLE) {
+        ev = hand->double_ev;
+        stake = 2.0;
+    } else if (action == SOLVER_ACTION_SPLIT) {
+        ev = hand->split_ev;
+        stake = 2.0;
+    } else if (action == SOLVER_ACTION_SURRENDER) {
+        ev = hand->surrender_ev;
+    }
+    if (dealer_peeks_for_blackjack(ruleset)) {
+        stake = 1.0;
+    }
+    return -dealer_blackjack * stake + (1.0 - dealer_blackjack) * ev;
+}
+
+static void build_strategy(SolverResult* result, const DealerDrawTable dealer_tables[CARD_VALUE_COUNT]) {
+    double hard_gain[TARGET_SCORE + 1][CARD_VALUE_COUNT];
+    double soft_gain[TARGET_SCORE + 1][CARD_VALUE_COUNT];
+    memset(hard_gain, 0, sizeof(hard_gain));
+    memset(soft_gain, 0, sizeof(soft_gain));
+    memset(result->hard_strategy, SOLVER_ACTION_STAND, sizeof(result->hard_strategy));
+    memset(result->soft_strategy, SOLVER_ACTION_STAND, sizeof(result->soft_strategy));
+    
+    // Weigh each composition's gain from hitting by how often it is dealt
+    for (int upcard = 0; upcard < CARD_VALUE_COUNT; upcard++) {
+        for (int low = 0; low < CARD_VALUE_COUNT; low++) {
+            for (int high = low; high < CARD_VALUE_COUNT; high++) {
+                const SolverHand* hand = &result->hands[upcard][low][high];
+                int hard = VALUE_POINTS[low] + VALUE_POINTS[high];
+                double gain = hand->probability * (hand->hit_ev - hand->stand_ev);
+                
+                if (low == 0) {
+                    soft_gain[hand_score(hard, 1)][upcard] += gain;
+                } else {
+                    hard_gain[hard][upcard] += gain;
+                }
+            }
+        }
+    }
+    
+    double player_edge = 0.0;
+    for (int upcard = 0; upcard < CARD_VALUE_COUNT; upcard++) {
+        for (int total = 0; total <= TARGET_SCORE; total++) {
+            if (hard_gain[total][upcard] > 0.0) {
+                result->hard_strategy[total][upcard] = SOLVER_ACTION_HIT;
+            }
+            if (soft_gain[total][upcard] > 0.0) {
+                result->soft_strategy[total][upcard] = SOLVER_ACTION_HIT;
+            }
+        }
+    }
+    
+    // Settle the round with composition-dependent play; the first decision
+    // tables take the action worth most over every hand of their total
+    const Ruleset* ruleset = &result->ruleset;
+    double first_hard_evs[TARGET_SCORE + 1][CARD_VALUE_COUNT][FIRST_TOTAL_ACTION_COUNT];
+    double first_soft_evs[TARGET_SCORE + 1][CARD_VALUE_COUNT][FIRST_TOTAL_ACTION_COUNT];
+    memset(first_hard_evs, 0, sizeof(first_hard_evs));
+    memset(first_soft_evs, 0, sizeof(first_soft_evs));
+    int full_counts[CARD_VALUE_COUNT];
+    count_values_in_full_shoe(ruleset->deck_count_in_shoe, full_counts);
+    
+    for (int upcard = 0; upcard < CARD_VALUE_COUNT; upcard++) {
+        for (int low = 0; low < CARD_VALUE_COUNT; low++) {
+            for (int high = low; high < CARD_VALUE_COUNT; high++) {
+                SolverHand* hand = &result->hands[upcard][low][high];
+                hand->action = SOLVER_ACTION_STAND;
+                if (hand->probability <= 0.0) {
+                    continue;
+                }
+                
+                // Dealer blackjack chance once the three known cards are out
+                int counts[CARD_VALUE_COUNT];
+                memcpy(counts, full_counts, sizeof(counts));
+                counts[upcard]--;
+                counts[low]--;
+                counts[high]--;
+                DealerOdds odds;
+                compute_dealer_odds_from_table(&dealer_tables[upcard], counts, 0, &odds);
+                double dealer_blackjack = odds.p[DEALER_BLACKJACK];
+                
+                double ev;
+                if (low == 0 && high == TEN_VALUE_INDEX) {
+                    ev = (1.0 - dealer_blackjack) * ruleset->blackjack_payout_numerator /
+                            ruleset->blackjack_payout_denominator;
+                } else {
+                    int hard = VALUE_POINTS[low] + VALUE_POINTS[high];
+                    double* total_evs = low == 0 ? first_soft_evs[hand_score(hard, 1)][upcard] :
+                                                   first_hard_evs[hard][upcard];
+                    ev = first_action_ev(ruleset, hand, SOLVER_ACTION_STAND, dealer_blackjack);
+                    for (int a = 0; a < FIRST_ACTION_COUNT; a++) {
+                        if (!first_action_allowed(ruleset, FIRST_ACTIONS[a], low, high)) {
+                            continue;
+                        }
+                        double action_ev = first_action_ev(ruleset, hand, FIRST_ACTIONS[a], dealer_blackjack);
+                        if (a < FIRST_TOTAL_ACTION_COUNT) {
+                            total_evs[a] += hand->probability * action_ev;
+                        }
+                        if (action_ev > ev) {
+                            ev = action_ev;
+                            hand->action = FIRST_ACTIONS[a];
+                        }
+                    }
+                }
+                player_edge += hand->probability * ev;
+            }
+        }
+    }
+    
+    memset(result->first_hard_strategy, SOLVER_ACTION_STAND, sizeof(result->first_hard_strategy));
+    memset(result->first_soft_strategy, SOLVER_ACTION_STAND, sizeof(result->first_soft_strategy));
+    for (int upcard = 0; upcard < CARD_VALUE_COUNT; upcard++) {
+        for (int total = 0; total <= TARGET_SCORE; total++) {
+            for (int a = 1; a < FIRST_TOTAL_ACTION_COUNT; a++) {
+                if (!first_action_allowed(ruleset, FIRST_ACTIONS[a], 0, 1)) {
+                    continue;
+                }
+                if (first_hard_evs[total][upcard][a] > first_hard_evs[total][upcard][0]) {
+                    first_hard_evs[total][upcard][0] = first_hard_evs[total][upcard][a];
+                    result->first_hard_strategy[total][upcard] = FIRST_ACTIONS[a];
+                }
+                if (first_soft_evs[total][upcard][a] > first_soft_evs[total][upcard][0]) {
+                    first_soft_evs[total][upcard][0] = first_soft_evs[total][upcard][a];
+                    result->first_soft_strategy[total][upcard] = FIRST_ACTIONS[a];
+                }
+            }
+        }
+    }
+    
+    result->player_edge = player_edge;
+}
+
+int solve_ruleset(const Ruleset* ruleset, int thread_count, SolverResult* result) {
+    memset(result, 0, sizeof(*result));
+    result->ruleset = *ruleset;
+    double start = sim_clock_seconds();
+    
+    SolverJob job;
+    job.ruleset = &result->ruleset;
+    job.result = result;
+    job.next_upcard = 0;
+    job.solved_count = 0;
+    
+    int tables_ready = 1;
+    for (int v = 0; v < CARD_VALUE_COUNT; v++) {
+        tables_ready &= init_dealer_draw_table(&job.dealer_tables[v], v);
+    }
+    if (!tables_ready) {
+        for (int v = 0; v < CARD_VALUE_COUNT; v++) {
+            free_dealer_draw_table(&job.dealer_tables[v]);
+        }
+        return 0;
+    }
+    pthread_mutex_init(&job.lock, NULL);
+    
+    thread_count = safe_max(1, safe_min(thread_count, CARD_VALUE_COUNT));
+    pthread_t threads[CARD_VALUE_COUNT];
+    int started = 0;
+    for (int i = 0; i < thread_count; i++) {
+        if (pthread_create(&threads[i], NULL, solver_thread, &job) == 0) {
+            started++;
+        }
+    }
+    if (started == 0) {
+        solver_thread(&job);  // No threads available, solve inline
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&job.lock);
+    
+    if (job.solved_count == CARD_VALUE_COUNT) {
+        build_strategy(result, job.dealer_tables);
+    }
+    for (int v = 0; v < CARD_VALUE_COUNT; v++) {
+        free_dealer_draw_table(&job.dealer_tables[v]);
+    }
+    if (job.solved_count < CARD_VALUE_COUNT) {
+        return 0;
+    }
+    
+    result->elapsed_seconds = sim_clock_seconds() - start;
+    return 1;
+}
+
+char solver_action_for_hand(const SolverResult* result, int upcard_value, const Hand* hand,
+                            const char* allowed_actions) {
+    int score = score_from_hand(hand);
+    if (score >= TARGET_SCORE) {
+        return SOLVER_ACTION_STAND;
+    }
+    
+    // Two-card hands follow their exact composition
+    if (hand->card_count == 2) {
+        int low = RANK_VALUE_INDEX(CARD_RANK(hand->cards[0]));
+        int high = RANK_VALUE_INDEX(CARD_RANK(hand->cards[1]));
+        if (low > high) {
+            int temp = low;
+            low = high;
+            high = temp;
+        }
+        const SolverHand* solved = &result->hands[upcard_value][low][high];
+        if (strchr(allowed_actions, tolower((unsigned char)solved->action)) != NULL) {
+            return solved->action;
+        }
+        
+        // A split hand cannot surrender, nor double without the rule for it
+        char action = solved->hit_ev > solved->stand_ev ? SOLVER_ACTION_HIT : SOLVER_ACTION_STAND;
+        return strchr(allowed_actions, 'h') != NULL ? action : SOLVER_ACTION_STAND;
+    }
+    
+    if (hand_is_soft(hand)) {
+        return result->soft_strategy[score][upcard_value];
+    }
+    return result->hard_strategy[score][upcard_value];
+}
+
+int solver_wager(void* context, const Game* game, const Table* table, int player_idx) {
+    (void)context;
+    (void)table;
+    (void)player_idx;
+    return game->ruleset.minimum_wager;
+}
+
+char solver_action(void* context, const Game* game, const Table* table, int player_idx) {
+    const SolverResult* result = (const SolverResult*)context;
+    const Player* player = &table->players[player_idx];
+    char allowed_actions[8];
+    get_allowed_actions(&game->ruleset, player, allowed_actions);
+    int upcard_value = RANK_VALUE_INDEX(CARD_RANK(table->dealer.hand.cards[0]));
+    char action = solver_action_for_hand(result, upcard_value, get_active_hand(player), allowed_actions);
+    return (char)tolower((unsigned char)action);
+}
+
+// ============================================================================
+// CACHE OPERATIONS
+// ============================================================================
+static uint64_t mix_key(uint64_t hash, uint64_t value) {
+    // FNV-1a over the value's bytes
+    for (int i = 0; i < 8; i++) {
+        hash ^= (value >> (8 * i)) & 0xFF;
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static uint64_t checksum_bytes(const uint8_t* data, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+uint64_t get_solver_ruleset_key(const Ruleset* ruleset) {
+    // Every rule, so a cached result always carries the ruleset asked for
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    hash = mix_key(hash, (uint64_t)ruleset->maximum_player_count);
+    hash = mix_key(hash, (uint64_t)ruleset->deck_count_in_shoe);
+    hash = mix_key(hash, (uint64_t)ruleset->auto_shuffling_shoe);
+    hash = mix_key(hash, (uint64_t)ruleset->minimum_wager);
+    hash = mix_key(hash, (uint64_t)ruleset->dealer_receives_hole_card);
+    hash = mix_key(hash, (uint64_t)ruleset->dealer_reveals_blackjack_hand);
+    hash = mix_key(hash, (uint64_t)ruleset->blackjack_payout_numerator);
+    hash = mix_key(hash, (uint64_t)ruleset->blackjack_payout_denominator);
+    hash = mix_key(hash, (uint64_t)ruleset->machine_return_delay);
+    hash = mix_key(hash, (uint64_t)(ruleset->cut_card_penetration * 1e6));
+    hash = mix_key(hash, (uint64_t)ruleset->double_down_allowed);
+    hash = mix_key(hash, (uint64_t)ruleset->double_after_split);
+    hash = mix_key(hash, (uint64_t)ruleset->max_split_hands);
+    hash = mix_key(hash, (uint64_t)ruleset->resplit_aces);
+    hash = mix_key(hash, (uint64_t)ruleset->hit_split_aces);
+    hash = mix_key(hash, (uint64_t)ruleset->late_surrender);
+    hash = mix_key(hash, (uint64_t)ruleset->insurance_offered);
+    return hash;
+}
+
+int get_solver_cache_dir(char* buffer, size_t buffer_size) {
+    // $UNIJACK_CACHE_DIR, else the XDG cache directory; 0 when neither is known
+    const char* directory = getenv(SOLVER_CACHE_DIR_ENV);
+    const char* base = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+    int length;
+    if (directory && directory[0]) {
+        length = snprintf(buffer, buffer_size, "%s", directory);
+    } else if (base && base[0]) {
+        length = snprintf(buffer, buffer_size, "%s/unijack", base);
+    } else if (home && home[0]) {
+        length = snprintf(buffer, buffer_size, "%s/.cache/unijack", home);
+    } else {
+        return 0;
+    }
+    return length > 0 && (size_t)length < buffer_size;
+}
+
+static int make_cache_dir(const char* directory) {
+    // mkdir -p; another process creating the same directory is fine
+    char path[MAX_STRING_LEN * 4];
+    if (snprintf(path, sizeof(path), "%s", directory) >= (int)sizeof(path)) {
+        return 0;
+    }
+    for (char* p = path + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+                return 0;
+            }
+            *p = '/';
+        }
+    }
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+static int map_solver_cache(CachedSolution* solution, const char* path, uint64_t key) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    size_t size = SOLVER_CACHE_HEADER_SIZE + sizeof(SolverResult);
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size != size) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return 0;
+    }
+    void* data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return 0;
+    }
+    
+    const uint8_t* bytes = (const uint8_t*)data;
+    const SolverResult* result = (const SolverResult*)(bytes + SOLVER_CACHE_HEADER_SIZE);
+    uint32_t version;
+    uint64_t fields[3];     // Key, payload size, checksum
+    memcpy(&version, bytes + 4, sizeof(version));
+    memcpy(fields, bytes + 8, sizeof(fields));
+    if (memcmp(bytes, SOLVER_CACHE_MAGIC, 4) != 0 || version != SOLVER_CACHE_VERSION ||
+        fields[0] != key || fields[1] != sizeof(SolverResult) ||
+        fields[2] != checksum_bytes((const uint8_t*)result, sizeof(SolverResult)) ||
+        get_solver_ruleset_key(&result->ruleset) != key) {
+        munmap(data, size);
+        return 0;
+    }
+    solution->result = result;
+    solution->data = data;
+    solution->size = size;
+    return 1;
+}
+
+static int write_solver_cache(const char* path, uint64_t key, const SolverResult* result) {
+    // Written under a per-process name and renamed, so a reader never maps
+    // a half-written file and racing writers simply replace each other
+    char temp_path[MAX_STRING_LEN * 4 + 32];
+    snprintf(temp_path, sizeof(temp_path), "%s.%ld.tmp", path, (long)getpid());
+    FILE* file = fopen(temp_path, "wb");
+    if (!file) {
+        return 0;
+    }
+    
+    uint8_t header[SOLVER_CACHE_HEADER_SIZE];
+    uint32_t version = SOLVER_CACHE_VERSION;
+    uint64_t fields[3] = {key, sizeof(SolverResult), checksum_bytes((const uint8_t*)result, sizeof(*result))};
+    memset(header, 0, sizeof(header));
+    memcpy(header, SOLVER_CACHE_MAGIC, 4);
+    memcpy(header + 4, &version, sizeof(version));
+    memcpy(header + 8, fields, sizeof(fields));
+    
+    int ok = fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+             fwrite(result, 1, sizeof(*result), file) == sizeof(*result);
+    ok &= fclose(file) == 0;
+    if (!ok || rename(temp_path, path) != 0) {
+        unlink(temp_path);
+        return 0;
+    }
+    return 1;
+}
+
+int open_cached_solution(CachedSolution* solution, const char* directory,
+                         const Ruleset* ruleset, int thread_count) {
+    memset(solution, 0, sizeof(*solution));
+    uint64_t key = get_solver_ruleset_key(ruleset);
+    char path[MAX_STRING_LEN * 4];
+    int cached = directory &&
+                 snprintf(path, sizeof(path), "%s/solver-%016llx.bin", directory,
+                          (unsigned long long)key) < (int)sizeof(path);
+    if (cached && map_solver_cache(solution, path, key)) {
+        solution->source = SOLUTION_MAPPED;
+        return 1;
+    }
+    
+    // Missing, stale or corrupt: solve, then share the result through the cache
+    SolverResult* result = malloc(sizeof(SolverResult));
+    if (!result || !solve_ruleset(ruleset, thread_count, result)) {
+        free(result);
+        return 0;
+    }
+    if (cached && make_cache_dir(directory) && write_solver_cache(path, key, result) &&
+        map_solver_cache(solution, path, key)) {
+        free(result);
+        solution->source = SOLUTION_REBUILT;
+        return 1;
+    }
+    solution->result = result;
+    solution->data = result;
+    solution->source = SOLUTION_UNCACHED;
+    return 1;
+}
+
+void close_cached_solution(CachedSolution* solution) {
+    if (solution->size > 0) {
+        munmap(solution->data, solution->size);
+    } else {
+        free(solution->data);
+    }
+    memset(solution, 0, sizeof(*solution));
+}
+
+// ============================================================================
+// REPORTS
+// ============================================================================
+static const char* UPCARD_LABELS[CARD_VALUE_COUNT] = {
+    "A", "2", "3", "4", "5", "6", "7", "8", "9", "10"
+};
+
+static void print_upcard_header(FILE* stream, const char* label) {
+    fprintf(stream, "%-8s", label);
+    for (int i = 1; i <= CARD_VALUE_COUNT; i++) {
+        fprintf(stream, "%3s", UPCARD_LABELS[i % CARD_VALUE_COUNT]);
+    }
+    fprintf(stream, "\n");
+}
+
+static void print_strategy_cell(FILE* stream, char first_action, char later_action) {
+    // A double or surrender names the play for when it is not offered
+    char cell[3] = {first_action, '\0', '\0'};
+    if (first_action == SOLVER_ACTION_DOUBLE || first_action == SOLVER_ACTION_SURRENDER) {
+        cell[1] = (char)tolower((unsigned char)later_action);
+    }
+    fprintf(stream, "%3s", cell);
+}
+
+void print_strategy_table(FILE* stream, const SolverResult* result) {
+    // Totals with two cards are dealt hands; with more, only hits are left
+    print_upcard_header(stream, "Hard");
+    for (int total = 4; total <= 20; total++) {
+        fprintf(stream, "%-8d", total);
+        for (int i = 1; i <= CARD_VALUE_COUNT; i++) {
+            int upcard = i % CARD_VALUE_COUNT;
+            print_strategy_cell(stream, result->first_hard_strategy[total][upcard],
+                                result->hard_strategy[total][upcard]);
+        }
+        fprintf(stream, "\n");
+    }
+    
+    print_upcard_header(stream, "Soft");
+    for (int total = 12; total <= 20; total++) {
+        fprintf(stream, "%-8d", total);
+        for (int i = 1; i <= CARD_VALUE_COUNT; i++) {
+            int upcard = i % CARD_VALUE_COUNT;
+            print_strategy_cell(stream, result->first_soft_strategy[total][upcard],
+                                result->soft_strategy[total][upcard]);
+        }
+        fprintf(stream, "\n");
+    }
+    
+    print_upcard_header(stream, "Pair");
+    for (int value = 0; value < CARD_VALUE_COUNT; value++) {
+        char label[8];
+        snprintf(label, sizeof(label), "%s,%s", UPCARD_LABELS[value], UPCARD_LABELS[value]);
+        fprintf(stream, "%-8s", label);
+        for (int i = 1; i <= CARD_VALUE_COUNT; i++) {
+            int upcard = i % CARD_VALUE_COUNT;
+            const SolverHand* hand = &result->hands[upcard][value][value];
+            print_strategy_cell(stream, hand->action,
+                                hand->hit_ev > hand->stand_ev ? SOLVER_ACTION_HIT : SOLVER_ACTION_STAND);
+        }
+        fprintf(stream, "\n");
+    }
+    
+    fprintf(stream, "Player edge: %.4f%%  House edge: %.4f%%\n",
+            100.0 * result->player_edge, -100.0 * result->player_edge);
+}
+
+void print_composition_table(FILE* stream, const SolverResult* result) {
+    fprintf(stream, "Hand    Up   Probability     Stand EV       Hit EV    Double EV     Split EV  Best\n");
+    for (int low = 0; low < CARD_VALUE_COUNT; low++) {
+        for (int high = low; high < CARD_VALUE_COUNT; high++) {
+            for (int i = 1; i <= CARD_VALUE_COUNT; i++) {
+                int upcard = i % CARD_VALUE_COUNT;
+                const SolverHand* hand = &result->hands[upcard][low][high];
+                char label[16];
+                snprintf(label, sizeof(label), "%s,%s", UPCARD_LABELS[low], UPCARD_LABELS[high]);
+                char split[16] = "-";
+                if (low == high) {
+                    snprintf(split, sizeof(split), "%.6f", hand->split_ev);
+                }
+                fprintf(stream, "%-7s %-3s %12.8f %12.6f %12.6f %12.6f %12s  %c\n",
+                        label, UPCARD_LABELS[upcard], hand->probability,
+                        hand->stand_ev, hand->hit_ev, hand->double_ev, split, hand->action);
+            }
+        }
+    }
+}
@@ -0,0 +1,97 @@
+/*
+ * UNIJACK - Strategy solver
+ * Composition-dependent expected values of hitting, standing, doubling,
+ * splitting and surrendering for every two-card hand against every dealer
+ * upcard, the basic strategy they imply and the resulting house edge for
+ * a Ruleset.
+ */
+
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "odds.h"
+
+#define SOLVER_ACTION_HIT 'H'
+#define SOLVER_ACTION_STAND 'S'
+#define SOLVER_ACTION_DOUBLE 'D'
+#define SOLVER_ACTION_SPLIT 'P'
+#define SOLVER_ACTION_SURRENDER 'R'
+
+// Two-card hand evaluation against one upcard
+// EVs are per unit of the original wager, given that the dealer does not
+// hold blackjack. A split draws both hands' second cards from the shoe
+// without the pair, plays them on as dealt hands of the same two cards and
+// leaves resplits out. The action is the best one the ruleset allows once
+// a dealer blackjack is counted in; without a peek, that blackjack also
+// takes the extra wager of a double or a split.
+typedef struct {
+    double probability;     // Joint probability of this upcard and both cards
+    double stand_ev;
+    double hit_ev;
+    double double_ev;
+    double split_ev;        // Pairs only
+    double surrender_ev;
+    char action;
+} SolverHand;
+
+// Solver result structure
+typedef struct {
+    Ruleset ruleset;
+    SolverHand hands[CARD_VALUE_COUNT][CARD_VALUE_COUNT][CARD_VALUE_COUNT];  // [upcard][low card][high card]
+    char hard_strategy[TARGET_SCORE + 1][CARD_VALUE_COUNT];     // [hard total][upcard], hit or stand
+    char soft_strategy[TARGET_SCORE + 1][CARD_VALUE_COUNT];     // [soft total][upcard], hit or stand
+    char first_hard_strategy[TARGET_SCORE + 1][CARD_VALUE_COUNT];   // [two-card hard total][upcard]
+    char first_soft_strategy[TARGET_SCORE + 1][CARD_VALUE_COUNT];   // [two-card soft total][upcard]
+    double player_edge;     // Expected net units per unit wagered
+    double elapsed_seconds;
+} SolverResult;
+
+// Solver cache file format, native byte order, one file per ruleset named
+// solver-KEY.bin after the hex ruleset key, in the cache directory
+//
+// Header (SOLVER_CACHE_HEADER_SIZE bytes)
+//   char[4] magic "UJSC"       u32 version
+//   u64 ruleset key            u64 payload size, sizeof(SolverResult)
+//   u64 payload checksum (FNV-1a)
+// Payload, the SolverResult itself, used in place through the mapping
+// A file with another version, key or size, a bad checksum or a payload
+// solved for other rules is stale: the ruleset is solved again and the
+// file replaced. Bump the version whenever the solver's results change.
+#define SOLVER_CACHE_MAGIC "UJSC"
+#define SOLVER_CACHE_VERSION 3
+#define SOLVER_CACHE_HEADER_SIZE 64
+#define SOLVER_CACHE_DIR_ENV "UNIJACK_CACHE_DIR"
+
+// Cached solution sources
+#define SOLUTION_MAPPED 0       // Mapped from an up to date cache file
+#define SOLUTION_REBUILT 1      // Solved, written to the cache, then mapped
+#define SOLUTION_UNCACHED 2     // Solved in memory, no cache file usable
+
+// Cached solution structure - a read-only SolverResult, shared through the
+// page cache by every process that maps the same file
+typedef struct {
+    const SolverResult* result;
+    void* data;             // Mapping, or the result itself when solved in memory
+    size_t size;            // Mapping size, 0 when solved in memory
+    int source;
+} CachedSolution;
+
+// Function declarations - Solver operations
+int solve_ruleset(const Ruleset* ruleset, int thread_count, SolverResult* result);
+char solver_action_for_hand(const SolverResult* result, int upcard_value, const Hand* hand,
+                            const char* allowed_actions);
+
+// Function declarations - Cache operations (directory NULL = no cache)
+int get_solver_cache_dir(char* buffer, size_t buffer_size);
+uint64_t get_solver_ruleset_key(const Ruleset* ruleset);
+int open_cached_solution(CachedSolution* solution, const char* directory,
+                         const Ruleset* ruleset, int thread_count);
+void close_cached_solution(CachedSolution* solution);
+
+// Function declarations - Policy callbacks (context is a solved SolverResult)
+int solver_wager(void* context, const Game* game, const Table* table, int player_idx);
+char solver_action(void* context, const Game* game, const Table* table, int player_idx);
+void print_strategy_table(FILE* stream, const SolverResult* result);
+void print_composition_table(FILE* stream, const SolverResult* result);
+
+#endif // SOLVER_H
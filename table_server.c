@@ -0,0 +1,123 @@
+/*
+ * UNIJACK - Table server entry point
+ * Serves tables to players connecting over TCP or a Unix socket until
+ * interrupted, then reports what was played.
+ */
+
+#include "server.h"
+
+#include <signal.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+        "Usage: %s [options]\n"
+        "  --ruleset NAME   basic, european or american (default: american)\n"
+        "  --host A         TCP address to listen on (default: 127.0.0.1)\n"
+        "  --port N         TCP port, 0 for none (default: %d)\n"
+        "  --unix PATH      also listen on a Unix socket\n"
+        "  --threads N      event loops (default: one per core)\n"
+        "  --seats N        players per table (default: the ruleset maximum)\n"
+        "  --decision-ms N  time allowed for every answer (default: %d)\n"
+        "  --chips N        chips given to every new player (default: %d)\n"
+        "  --seed N         random seed (default: current time)\n"
+        "Stop with Ctrl-C. See server.h for the protocol.\n",
+        program, SERVER_DEFAULT_PORT, SERVER_DEFAULT_DECISION_MS, SERVER_DEFAULT_CHIPS);
+}
+
+static void on_stop_signal(int signal_number) {
+    stop_server();
+}
+
+static void raise_descriptor_limit(void) {
+    // Every seat is a socket, so take every descriptor the system allows
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+int main(int argc, char** argv) {
+#ifdef UNIVAC
+    init_bss();
+#endif
+    
+    Ruleset ruleset;
+    init_american_ruleset(&ruleset);
+    
+    ServerConfig config;
+    init_server_config(&config, &ruleset);
+    long core_count = sysconf(_SC_NPROCESSORS_ONLN);
+    config.thread_count = core_count > 0 ? safe_min((int)core_count, SERVER_MAX_THREADS) : 1;
+    int seats = 0;
+    
+    for (int i = 1; i < argc; i++) {
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        
+        if (strcmp(argv[i], "--ruleset") == 0 && value) {
+            if (!init_ruleset_by_name(&config.ruleset, value)) {
+                fprintf(stderr, "Unknown ruleset \"%s\"\n", value);
+                return 1;
+            }
+            i++;
+        } else if (strcmp(argv[i], "--host") == 0 && value) {
+            config.host = value;
+            i++;
+        } else if (strcmp(argv[i], "--port") == 0 && value) {
+            config.port = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--unix") == 0 && value) {
+            config.unix_path = value;
+            i++;
+        } else if (strcmp(argv[i], "--threads") == 0 && value) {
+            config.thread_count = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--seats") == 0 && value) {
+            seats = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--decision-ms") == 0 && value) {
+            config.decision_ms = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--chips") == 0 && value) {
+            config.starting_chips = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--seed") == 0 && value) {
+            config.seed = strtoull(value, NULL, 10);
+            i++;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    config.seats_per_table = seats > 0 ? seats : config.ruleset.maximum_player_count;
+    
+    if (config.thread_count <= 0 || config.thread_count > SERVER_MAX_THREADS ||
+        config.seats_per_table > config.ruleset.maximum_player_count || config.decision_ms <= 0 ||
+        config.starting_chips < config.ruleset.minimum_wager || config.port < 0 || config.port > 65535 ||
+        (config.port == 0 && !config.unix_path)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    raise_descriptor_limit();
+    signal(SIGINT, on_stop_signal);
+    signal(SIGTERM, on_stop_signal);
+    
+    ServerStats stats;
+    if (!run_server(&config, &stats)) {
+        fprintf(stderr, "Server failed\n");
+        return 1;
+    }
+    
+    const GameStats* game_stats = &stats.game_stats;
+    printf("Connections:   %lld (%lld dropped as too slow)\n", stats.connection_count, stats.dropped_count);
+    printf("Tables:        %lld\n", stats.table_count);
+    printf("Rounds:        %lld\n", game_stats->round_count);
+    printf("Hands:         %lld\n", game_stats->hand_count);
+    printf("Answers:       %lld (%lld timed out)\n", stats.decision_count, stats.timeout_count);
+    printf("Bad messages:  %lld\n", stats.protocol_error_count);
+    printf("Net chips:     %lld\n", game_stats->total_paid - game_stats->total_wagered);
+    return 0;
+}